@@ -0,0 +1,246 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Param.h"
+#include "Synet/MappedFile.h"
+
+#ifndef SYNET_KERNEL_VERSION
+#define SYNET_KERNEL_VERSION 1
+#endif
+
+namespace Synet
+{
+    namespace Detail
+    {
+        const char CACHE_MAGIC[8] = { 'S', 'Y', 'N', 'E', 'T', 'P', 'R', 'C' };
+        const size_t CACHE_ALIGN = 64;
+
+        struct CacheHeader
+        {
+            char magic[8];
+            uint64_t model, shape, isa, version, count;
+        };
+
+        struct CacheRecord
+        {
+            uint64_t layer, offset, size;
+        };
+
+        SYNET_INLINE uint64_t IsaHash()
+        {
+            String isa = "base";
+#if defined(__SSE4_1__)
+            isa += "-sse41";
+#endif
+#if defined(__AVX__)
+            isa += "-avx";
+#endif
+#if defined(__AVX2__)
+            isa += "-avx2";
+#endif
+#if defined(__FMA__)
+            isa += "-fma";
+#endif
+#if defined(__F16C__)
+            isa += "-f16c";
+#endif
+#if defined(__AVX512F__)
+            isa += "-avx512f";
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+            isa += "-neon";
+#endif
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            isa += "-simd";
+#endif
+            return Hash64(isa.data(), isa.size());
+        }
+
+        SYNET_INLINE uint64_t FileStamp(const String & path, uint64_t hash)
+        {
+            uint64_t stamp[3] = { 0, 0, 0 };
+#ifdef _MSC_VER
+            WIN32_FILE_ATTRIBUTE_DATA info;
+            if (::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+            {
+                stamp[0] = (uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+                stamp[1] = (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+            }
+#else
+            struct stat info;
+            if (::stat(path.c_str(), &info) == 0)
+            {
+                stamp[0] = (uint64_t)info.st_size;
+                stamp[1] = (uint64_t)info.st_mtime;
+#if defined(__linux__)
+                stamp[2] = (uint64_t)info.st_mtim.tv_nsec;
+#endif
+            }
+#endif
+            hash = Hash64(path.data(), path.size(), hash);
+            return Hash64(stamp, sizeof(stamp), hash);
+        }
+
+        SYNET_INLINE bool ReplaceFile(const String & src, const String & dst)
+        {
+#ifdef _MSC_VER
+            return ::MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            return ::rename(src.c_str(), dst.c_str()) == 0;
+#endif
+        }
+
+        SYNET_INLINE String TempPath(const String & path)
+        {
+#ifdef _MSC_VER
+            size_t pid = ::GetCurrentProcessId();
+#else
+            size_t pid = ::getpid();
+#endif
+            return path + ".tmp." + ValueToString(pid);
+        }
+    }
+
+    class PreparedCache
+    {
+    public:
+        struct Key
+        {
+            uint64_t model, shape, isa, version;
+        };
+
+        typedef std::pair<size_t, String> Record;
+        typedef std::vector<Record> Records;
+
+        static Key MakeKey(uint64_t model, uint64_t shape)
+        {
+            Key key;
+            key.model = model;
+            key.shape = shape;
+            key.isa = Detail::IsaHash();
+            key.version = SYNET_KERNEL_VERSION;
+            return key;
+        }
+
+        bool Load(const String & path, const Key & key)
+        {
+            _records.clear();
+            if (!_mapped.Open(path))
+                return false;
+            const uint8_t * data = _mapped.Data();
+            size_t size = _mapped.Size();
+            const Detail::CacheHeader * header = (const Detail::CacheHeader*)data;
+            if (size < sizeof(Detail::CacheHeader) || memcmp(header->magic, Detail::CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+                header->model != key.model || header->shape != key.shape || header->isa != key.isa || header->version != key.version ||
+                header->count > (size - sizeof(Detail::CacheHeader)) / sizeof(Detail::CacheRecord))
+            {
+                _mapped.Close();
+                return false;
+            }
+            const Detail::CacheRecord * records = (const Detail::CacheRecord*)(header + 1);
+            for (size_t i = 0; i < header->count; ++i)
+            {
+                if (records[i].offset > size || records[i].size > size - records[i].offset)
+                {
+                    _records.clear();
+                    _mapped.Close();
+                    return false;
+                }
+                _records.push_back(records[i]);
+            }
+            return true;
+        }
+
+        const uint8_t * Find(size_t layer, size_t & size) const
+        {
+            for (size_t i = 0; i < _records.size(); ++i)
+            {
+                if (_records[i].layer == layer)
+                {
+                    size = (size_t)_records[i].size;
+                    return _mapped.Data() + _records[i].offset;
+                }
+            }
+            return NULL;
+        }
+
+        void Close()
+        {
+            _records.clear();
+            _mapped.Close();
+        }
+
+        // Writes a temporary file next to path and renames it over the target: processes that share
+        // the path never see a truncated cache, and those that have it mapped keep the old file.
+        static bool Save(const String & path, const Key & key, const Records & records)
+        {
+            String temp = Detail::TempPath(path);
+            if (!Write(temp, key, records) || !Detail::ReplaceFile(temp, path))
+            {
+                ::remove(temp.c_str());
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        MappedFile _mapped;
+        std::vector<Detail::CacheRecord> _records;
+
+        static bool Write(const String & path, const Key & key, const Records & records)
+        {
+            std::ofstream ofs(path.c_str(), std::ofstream::binary);
+            if (!ofs.is_open())
+                return false;
+            Detail::CacheHeader header;
+            memcpy(header.magic, Detail::CACHE_MAGIC, sizeof(header.magic));
+            header.model = key.model;
+            header.shape = key.shape;
+            header.isa = key.isa;
+            header.version = key.version;
+            header.count = records.size();
+            ofs.write((const char*)&header, sizeof(header));
+            uint64_t offset = sizeof(header) + records.size() * sizeof(Detail::CacheRecord);
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                offset = (offset + Detail::CACHE_ALIGN - 1) / Detail::CACHE_ALIGN * Detail::CACHE_ALIGN;
+                Detail::CacheRecord record = { records[i].first, offset, records[i].second.size() };
+                ofs.write((const char*)&record, sizeof(record));
+                offset += record.size;
+            }
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                size_t pos = (size_t)ofs.tellp(), pad = (Detail::CACHE_ALIGN - pos % Detail::CACHE_ALIGN) % Detail::CACHE_ALIGN;
+                ofs.write(String(pad, 0).data(), pad);
+                ofs.write(records[i].second.data(), records[i].second.size());
+            }
+            ofs.close();
+            return !ofs.fail();
+        }
+    };
+}
@@ -26,6 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Params.h"
+#include "Synet/Container.h"
 
 #if defined(SYNET_CAFFE_ENABLE)
 
@@ -69,6 +70,9 @@ namespace Synet
             if (!ConvertWeight(srcWeight, holder(), weight))
                 return false;
 
+            if (dstWeightPath.empty())
+                return SaveContainer(holder, weight, dstModelPath);
+
             if (!holder.Save(dstModelPath, false))
                 return false;
 
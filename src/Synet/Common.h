@@ -33,6 +33,7 @@
 //#define SYNET_GEMM_COMPARE
 //#define SYNET_PROTOBUF_ENABLE
 //#define SYNET_SIZE_STATISTIC
+//#define SYNET_FAST_MATH_ENABLE
 
 //#define SYNET_CAFFE_ENABLE
 //#define SYNET_YOLO_ENABLE
@@ -40,6 +41,7 @@
 //#define SYNET_OPENCV_ENABLE
 
 //#define SYNET_DEBUG_PRINT_ENABLE
+//#define SYNET_SHAPE_INFERENCE_STRICT
 
 #include <stddef.h>
 #include <assert.h>
@@ -66,6 +68,7 @@
 #include <map>
 #include <set>
 #include <cmath>
+#include <limits>
 
 #if defined(SYNET_SIMD_LIBRARY_ENABLE) || defined(SYNET_SIMD_LIBRARY_GEMM_ENABLE)
 #include "Simd/SimdLib.h"
@@ -144,6 +147,31 @@ namespace Synet
         return result;
     }
 
+    SYNET_INLINE uint64_t Hash64(const void * data, size_t size, uint64_t hash = 0xCBF29CE484222325ULL)
+    {
+        const uint8_t * bytes = (const uint8_t*)data;
+        size_t size8 = size & (~size_t(7)), i = 0;
+        for (; i < size8; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            hash = (hash ^ word) * 0x100000001B3ULL;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    namespace Detail
+    {
+        inline size_t & ThreadNumber()
+        {
+            static size_t threadNumber = 1;
+            return threadNumber;
+        }
+    }
+
     inline size_t GetThreadNumber()
     {
 #if defined(SYNET_SIMD_LIBRARY_ENABLE)
@@ -151,7 +179,7 @@ namespace Synet
 #elif defined(SYNET_OPEN_BLAS_ENABLE)
         return ::openblas_get_num_threads();
 #else
-        return 1;
+        return Detail::ThreadNumber();
 #endif
     }
 
@@ -164,6 +192,7 @@ namespace Synet
         ::openblas_set_num_threads((int)threadNumber);
         ::goto_set_num_threads((int)threadNumber);
 #endif
+        Detail::ThreadNumber() = std::max<size_t>(threadNumber, 1);
     }
 
     inline bool GetFlushToZero()
@@ -51,6 +51,11 @@ namespace Synet
             dst[0]->Share(this->Weight()[0]);
         }
 
+        virtual bool Const() const
+        {
+            return true;
+        }
+
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
@@ -0,0 +1,249 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/Tensor.h"
+
+#include <tuple>
+
+#ifndef SYNET_CONTAINER_ALIGN
+#define SYNET_CONTAINER_ALIGN 64
+#endif
+
+namespace Synet
+{
+    enum ContainerSectionType
+    {
+        ContainerSectionWeight = 0,
+        ContainerSectionPrepared = 1,
+    };
+
+    namespace Detail
+    {
+        const char CONTAINER_MAGIC[8] = { 'S', 'Y', 'N', 'E', 'T', 'M', 'D', 'L' };
+        const uint32_t CONTAINER_VERSION = 1;
+        const size_t CONTAINER_RANK_MAX = 6;
+
+        struct ContainerHeader
+        {
+            char magic[8];
+            uint32_t version, align;
+            uint64_t paramOffset, paramSize, tocOffset, tocSize;
+        };
+
+        struct ContainerSection
+        {
+            uint32_t layer, index, kind, type;
+            uint64_t offset, size;
+            uint32_t rank, reserved;
+            uint64_t dim[CONTAINER_RANK_MAX];
+        };
+
+        SYNET_INLINE uint32_t ContainerType(TensorType type)
+        {
+            return uint32_t(type == TensorTypeUnknown ? TensorType32f : type);
+        }
+    }
+
+    class ContainerWriter
+    {
+    public:
+        ContainerWriter(size_t align = SYNET_CONTAINER_ALIGN)
+            : _align(std::max<size_t>(align, 8))
+        {
+        }
+
+        bool Open(const String & path, const String & param)
+        {
+            _sections.clear();
+            _ofs.open(path.c_str(), std::ofstream::binary);
+            if (!_ofs.is_open())
+                return false;
+            memset(&_header, 0, sizeof(_header));
+            memcpy(_header.magic, Detail::CONTAINER_MAGIC, sizeof(_header.magic));
+            _header.version = Detail::CONTAINER_VERSION;
+            _header.align = (uint32_t)_align;
+            _ofs.write((const char*)&_header, sizeof(_header));
+            _header.paramOffset = Pad();
+            _header.paramSize = param.size();
+            _ofs.write(param.c_str(), param.size());
+            return (bool)_ofs;
+        }
+
+        bool Write(size_t layer, size_t index, ContainerSectionType kind, TensorType type, const Shape & shape, const void * data, size_t size)
+        {
+            if (!_ofs.is_open() || shape.size() > Detail::CONTAINER_RANK_MAX)
+                return false;
+            Detail::ContainerSection section;
+            memset(&section, 0, sizeof(section));
+            section.layer = (uint32_t)layer;
+            section.index = (uint32_t)index;
+            section.kind = (uint32_t)kind;
+            section.type = Detail::ContainerType(type);
+            section.offset = Pad();
+            section.size = size;
+            section.rank = (uint32_t)shape.size();
+            for (size_t i = 0; i < shape.size(); ++i)
+                section.dim[i] = shape[i];
+            _ofs.write((const char*)data, size);
+            _sections.push_back(section);
+            return (bool)_ofs;
+        }
+
+        bool Close()
+        {
+            if (!_ofs.is_open())
+                return false;
+            _header.tocOffset = Pad();
+            _header.tocSize = _sections.size();
+            if (_sections.size())
+                _ofs.write((const char*)_sections.data(), _sections.size() * sizeof(Detail::ContainerSection));
+            _ofs.seekp(0);
+            _ofs.write((const char*)&_header, sizeof(_header));
+            bool result = (bool)_ofs;
+            _ofs.close();
+            return result;
+        }
+
+    private:
+        size_t _align;
+        std::ofstream _ofs;
+        Detail::ContainerHeader _header;
+        std::vector<Detail::ContainerSection> _sections;
+
+        uint64_t Pad()
+        {
+            size_t pos = (size_t)_ofs.tellp();
+            size_t pad = (_align - pos % _align) % _align;
+            static const char zero[4096] = { 0 };
+            for (; pad > 0; pad -= std::min(pad, sizeof(zero)))
+                _ofs.write(zero, std::min(pad, sizeof(zero)));
+            return (uint64_t)_ofs.tellp();
+        }
+    };
+
+    class ContainerReader
+    {
+    public:
+        ContainerReader()
+            : _data(NULL)
+            , _size(0)
+            , _header(NULL)
+            , _sections(NULL)
+        {
+        }
+
+        bool Open(const uint8_t * data, size_t size)
+        {
+            _data = data;
+            _size = size;
+            _header = (const Detail::ContainerHeader*)data;
+            _index.clear();
+            if (!IsContainer(data, size) || _header->version != Detail::CONTAINER_VERSION)
+                return false;
+            if (_header->paramOffset > size || _header->paramSize > size - _header->paramOffset)
+                return false;
+            if (_header->tocOffset > size || _header->tocSize > (size - _header->tocOffset) / sizeof(Detail::ContainerSection))
+                return false;
+            _sections = (const Detail::ContainerSection*)(data + _header->tocOffset);
+            for (size_t i = 0; i < _header->tocSize; ++i)
+            {
+                const Detail::ContainerSection & section = _sections[i];
+                if (section.offset > size || section.size > size - section.offset || section.rank > Detail::CONTAINER_RANK_MAX)
+                    return false;
+                _index.insert(SectionIndexMap::value_type(SectionKey(section.layer, section.index, section.kind), i));
+            }
+            return true;
+        }
+
+        String Param() const
+        {
+            return String((const char*)_data + _header->paramOffset, (size_t)_header->paramSize);
+        }
+
+        const uint8_t * Find(size_t layer, size_t index, ContainerSectionType kind, TensorType type, const Shape & shape, size_t & size) const
+        {
+            SectionIndexMap::const_iterator it = _index.find(SectionKey(uint32_t(layer), uint32_t(index), uint32_t(kind)));
+            if (it == _index.end())
+                return NULL;
+            const Detail::ContainerSection & section = _sections[it->second];
+            if (section.type != Detail::ContainerType(type) || section.rank != shape.size())
+                return NULL;
+            for (size_t j = 0; j < shape.size(); ++j)
+                if (section.dim[j] != shape[j])
+                    return NULL;
+            size = (size_t)section.size;
+            return _data + section.offset;
+        }
+
+        static bool IsContainer(const uint8_t * data, size_t size)
+        {
+            return size >= sizeof(Detail::ContainerHeader) && memcmp(data, Detail::CONTAINER_MAGIC, sizeof(Detail::CONTAINER_MAGIC)) == 0;
+        }
+
+        static bool IsContainer(const String & path)
+        {
+            char magic[sizeof(Detail::CONTAINER_MAGIC)];
+            std::ifstream ifs(path.c_str(), std::ifstream::binary);
+            return ifs.read(magic, sizeof(magic)) && memcmp(magic, Detail::CONTAINER_MAGIC, sizeof(magic)) == 0;
+        }
+
+    private:
+        typedef std::tuple<uint32_t, uint32_t, uint32_t> SectionKey;
+        typedef std::map<SectionKey, size_t> SectionIndexMap;
+
+        const uint8_t * _data;
+        size_t _size;
+        const Detail::ContainerHeader * _header;
+        const Detail::ContainerSection * _sections;
+        SectionIndexMap _index;
+    };
+
+    inline bool SaveContainer(const NetworkParamHolder & holder, const std::vector<Synet::Tensor<float>> & weight, const String & path, size_t align = SYNET_CONTAINER_ALIGN)
+    {
+        std::stringstream param;
+        if (!holder.Save(param, false, true))
+            return false;
+        ContainerWriter writer(align);
+        if (!writer.Open(path, param.str()))
+            return false;
+        const std::vector<LayerParam> & layers = holder().layers();
+        for (size_t i = 0, w = 0; i < layers.size(); ++i)
+        {
+            for (size_t j = 0; j < layers[i].weight().size(); ++j, ++w)
+            {
+                const ShapeParam & shape = layers[i].weight()[j];
+                if (w >= weight.size() || weight[w].Shape() != shape.dim())
+                    return false;
+                if (!writer.Write(i, j, ContainerSectionWeight, shape.type(), shape.dim(), weight[w].CpuData(), weight[w].Size() * sizeof(float)))
+                    return false;
+            }
+        }
+        return writer.Close();
+    }
+}
@@ -30,6 +30,7 @@
 #include "Synet/ImgToCol.h"
 #include "Synet/Winograd.h"
 #include "Synet/Convolution.h"
+#include "Synet/Sparse.h"
 
 namespace Synet
 {
@@ -43,6 +44,7 @@ namespace Synet
 
         ConvolutionLayer(const LayerParam & param)
             : Base(param)
+            , _sparseChecked(false)
         {
         }
 
@@ -136,6 +138,20 @@ namespace Synet
                 assert(this->Weight()[1].Shape() == biasShape);
             _kernelSize = this->Weight()[0].Size(1);
             _weightOffset = _dstChannels * _kernelSize / _group;
+            if (_sparse.Enable() && !(_is1x1 && _group == 1 && _sparse.Rows() == _dstChannels && _sparse.Cols() == _kernelSize))
+            {
+                _sparse.Clear();
+                _sparseChecked = false;
+            }
+            if (!_sparseChecked)
+            {
+                if (_is1x1 && _group == 1)
+                {
+                    std::vector<Type> buffer;
+                    _sparse.Init(this->UnpackedWeight(0, buffer), _dstChannels, _kernelSize);
+                }
+                _sparseChecked = true;
+            }
         }
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
@@ -167,27 +183,59 @@ namespace Synet
                 colBufferShape.push_back(_dstShape[i]);
             _srcSize = src[0]->Size(_axis);
             _dstSize = dst[0]->Size(_axis);
+            if (_sparse.Enable())
+                return;
             _convolution.Init(_srcConvShape[0], _srcConvShape[1], _srcConvShape[2], _dstChannels, _kernelShape[0], _kernelShape[1],
                 _dilationShape[0], _dilationShape[1], _strideShape[0], _strideShape[1], _padShape[0], _padShape[1], _padShape[2], _padShape[3], _group);
             if (_convolution.Enable())
             {
+                this->UnpackWeight(0);
                 buf[0]->Extend({ _convolution.BufferSize() });
                 _convolution.SetWeight(this->Weight()[0].CpuData(), _biasTerm ? this->Weight()[1].CpuData() : NULL);
             }
             else
             {
                 buf[0]->Extend(colBufferShape);
+                _panel = this->PanelRows(_dstChannels / _group, _kernelSize);
+                if (this->Packed(0))
+                    buf[1]->Extend({ _panel * _kernelSize });
             }
         }
 
+        virtual bool SaveState(std::ostream & os) const
+        {
+            if (!_sparseChecked)
+                return false;
+            _sparse.Save(os);
+            return true;
+        }
+
+        virtual bool LoadState(const uint8_t * data, size_t size)
+        {
+            const typename Base::Tensors & weight = this->Weight();
+            if (!_sparse.Load(data, size) || size != 0 || (_sparse.Enable() && (weight.empty() || 
+                weight[0].Count() < 2 || _sparse.Rows() != weight[0].Axis(0) || _sparse.Cols() != weight[0].Size(1))))
+            {
+                _sparse.Clear();
+                return false;
+            }
+            _sparseChecked = true;
+            return true;
+        }
+
     protected:
+        virtual bool PackedWeight(size_t index) const
+        {
+            return index == 0;
+        }
+
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             SYNET_PERF_FUNC();
 
             for (int i = 0; i < src.size(); ++i)
                 for (int n = 0; n < this->_num; ++n)
-                    ForwardCpu(src[i]->CpuData() + _srcSize * n, buf[0]->CpuData(), buf[1]->CpuData(), dst[i]->CpuData() + _dstSize * n);
+                    ForwardCpu(src[i]->CpuData() + _srcSize * n, buf[0]->CpuData(), this->Packed(0) ? buf[1]->CpuData() : NULL, dst[i]->CpuData() + _dstSize * n);
         }
 
         void ForwardCpu(const T * src, T * buf0, T * buf1, T * dst)
@@ -199,20 +247,37 @@ namespace Synet
 #else
             SYNET_PERF_FUNC();
 #endif
-            if (_convolution.Enable())
+            if (_sparse.Enable())
+            {
+                _sparse.Mul(src, _dstSpatialSize, dst);
+                if (_biasTerm)
+                    CpuAddBias(this->Weight()[1].CpuData(), _dstChannels, _dstSpatialSize, dst);
+            }
+            else if (_convolution.Enable())
                 _convolution.Forward(src, buf0, dst);
             else
             {
-                const Type * weight = this->Weight()[0].CpuData();
                 if (!_is1x1)
                 {
                     ImgToCol(src, buf0);
                     src = buf0;
                 }
+                size_t M = _dstChannels / _group;
                 for (size_t g = 0; g < _group; ++g)
                 {
-                    CpuGemm<Type>(CblasNoTrans, CblasNoTrans, _dstChannels / _group, _dstSpatialSize, _kernelSize,
-                        Type(1.0), weight + _weightOffset * g, src + _colOffset * g, Type(0.0), dst + _dstOffset * g);
+                    if (this->Packed(0))
+                    {
+                        for (size_t m = 0; m < M; m += _panel)
+                        {
+                            size_t rows = std::min(_panel, M - m);
+                            this->UnpackWeight(0, _weightOffset * g + _kernelSize * m, _kernelSize * rows, buf1);
+                            CpuGemm<Type>(CblasNoTrans, CblasNoTrans, rows, _dstSpatialSize, _kernelSize,
+                                Type(1.0), buf1, src + _colOffset * g, Type(0.0), dst + _dstOffset * g + _dstSpatialSize * m);
+                        }
+                    }
+                    else
+                        CpuGemm<Type>(CblasNoTrans, CblasNoTrans, M, _dstSpatialSize, _kernelSize,
+                            Type(1.0), this->Weight()[0].CpuData() + _weightOffset * g, src + _colOffset * g, Type(0.0), dst + _dstOffset * g);
                 }
                 if (_biasTerm)
                     CpuAddBias(this->Weight()[1].CpuData(), _dstChannels, _dstSpatialSize, dst);            
@@ -232,10 +297,11 @@ namespace Synet
 
     private:
         Shape _srcShape, _kernelShape, _strideShape, _dilationShape, _padShape, _dstShape, _srcConvShape;
-        bool _is1x1, _biasTerm;
+        bool _is1x1, _biasTerm, _sparseChecked;
         size_t _axis, _group, _spatialAxisNum, _srcChannels, _dstChannels, _weightOffset, _kernelSize;
-        size_t _channelAxis, _num, _dstSpatialSize, _colOffset, _dstOffset, _srcSize, _dstSize;
+        size_t _channelAxis, _num, _dstSpatialSize, _colOffset, _dstOffset, _srcSize, _dstSize, _panel;
 
         Convolution<Type> _convolution;
+        SparseMatrix<Type> _sparse;
     };
 }
\ No newline at end of file
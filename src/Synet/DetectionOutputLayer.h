@@ -26,6 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Math.h"
 
 namespace Synet
 {
@@ -63,38 +64,23 @@ namespace Synet
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            assert(src[0]->Shape() == src[1]->Shape());
-            _bboxPreds.Reshape(src[0]->Shape());
-            if (_shareLocation)
-                _bboxPermute.Reshape(src[0]->Shape());
-            _confPermute.Reshape(src[1]->Shape());
             _numPriors = src[2]->Axis(2) / 4;
-            assert(_numPriors * _numLocClasses * 4 == src[0]->Axis(1));
-            assert(_numPriors * _numLocClasses * 4 == src[1]->Axis(1));
+            assert(_numPriors * _numLocClasses * 4 == src[0]->Size(1));
+            assert(_numPriors * _numClasses == src[1]->Size(1));
+            _priors.Resize(_numPriors);
+            _variances.resize(_numPriors * 4);
+            _boxes.Resize(_numPriors * _numLocClasses);
+            _maxClass.resize(_numPriors);
+            size_t candidates = _topK > -1 ? std::min<size_t>(_topK, _numPriors) : _numPriors;
+            _scores.reserve(_numPriors);
+            _candidates.Resize(candidates);
+            _overlap.resize(candidates);
             Shape shape(2, 1);
             shape.push_back(1);
             shape.push_back(7);
             dst[0]->Reshape(shape);
         }
 
-        struct NormalizedBBox
-        {
-            float xmin;
-            float ymin;
-            float xmax;
-            float ymax;
-            int32_t label;
-            bool difficult;
-            float score;
-            float size;
-
-            NormalizedBBox()
-                : xmin(0), ymin(0), xmax(0), ymax(0)
-                , label(0), difficult(false), score(0), size(0)
-            {
-            }
-        };
-
         void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst)
         {
             SYNET_PERF_FUNC();
@@ -125,476 +111,305 @@ namespace Synet
 
             const Type * pLoc = src[0]->CpuData();
             const Type * pConf = src[1]->CpuData();
-            const Type * pPrior = src[2]->CpuData();
             size_t num = src[0]->Axis(0);
 
-            LabelBBoxes allLocPreds;
-            GetLocPredictions(pLoc, num, _numPriors, _numLocClasses, _shareLocation, allLocPreds);
+            SetPriors(src[2]->CpuData());
 
-            LabelPreds allConfScores;
-            GetConfidenceScores(pConf, num, _numPriors, _numClasses, allConfScores, false);
-
-            if (_keepMaxClassScoresOnly)
+            _detections.clear();
+            _images.assign(1, 0);
+            for (size_t i = 0; i < num; ++i)
             {
-                for (size_t i = 0; i < num; ++i) 
+                for (size_t c = 0; c < _numLocClasses; ++c)
                 {
-                    LabelPred & labelScores = allConfScores[i];
-                    for (size_t p = 0; p < _numPriors; ++p)
-                    {
-                        float maxScore = 0.0f;
-                        int maxScoreIdx = -1;
-                        for (size_t c = 0; c < _numClasses; ++c)
-                        {
-                            if (labelScores[(int)c][p] >= maxScore && c != _backgroundLabelId)
-                            {
-                                maxScoreIdx = (int)c;
-                                maxScore = labelScores[(int)c][p];
-                            }
-                        }
-                        for (size_t c = 0; c < _numClasses; ++c)
-                            if (c != maxScoreIdx && c != _backgroundLabelId)
-                                labelScores[(int)c][p] = 0.0f;
-                    }
+                    if (!_shareLocation && (ptrdiff_t)c == _backgroundLabelId)
+                        continue;
+                    DecodeBoxes(pLoc, c);
                 }
-            }
-
-            NormalizedBBoxes priorBboxes;
-            Variances priorVariances;
-            GetPriorBBoxes(pPrior, _numPriors, priorBboxes, priorVariances);
-
-            LabelBBoxes allDecodeBboxes;
-            DecodeBBoxesAll(allLocPreds, priorBboxes, priorVariances, num, _shareLocation, _numLocClasses, 
-                _backgroundLabelId, _codeType, _varianceEncodedInTarget, _clip, allDecodeBboxes);
-
-            size_t numKept = 0;
-            IndexMaps allIndices;
-            for (size_t i = 0; i < num; ++i) 
-            {
-                const LabelBBox & decodeBboxes = allDecodeBboxes[i];
-                const LabelPred & confScores = allConfScores[i];
-                IndexMap indices;
-                size_t numDet = 0;
+                if (_keepMaxClassScoresOnly)
+                    SetMaxClass(pConf);
                 for (size_t c = 0; c < _numClasses; ++c)
                 {
-                    if (c == _backgroundLabelId)
+                    if ((ptrdiff_t)c == _backgroundLabelId)
                         continue;
-                    assert(confScores.find((int)c) != confScores.end());
-                    const Floats & scores = confScores.find((int)c)->second;
-                    int label = _shareLocation ? -1 : (int)c;
-                    assert(decodeBboxes.find(label) != decodeBboxes.end());
-                    const NormalizedBBoxes & bboxes = decodeBboxes.find(label)->second;
-                    ApplyNMSFast(bboxes, scores, _confidenceThreshold, _nmsThreshold, _eta, _topK, indices[(int)c]);
-                    numDet += indices[(int)c].size();
-                }
-                if (_keepTopK > -1 && numDet > (size_t)_keepTopK)
-                {
-                    ScoreIndexPairs scoreIndexPairs;
-                    for (IndexMap::iterator it = indices.begin(); it != indices.end(); ++it) 
-                    {
-                        int label = it->first;
-                        const Index & labelIndices = it->second;
-                        assert(confScores.find(label) != confScores.end());
-                        const Floats & scores = confScores.find(label)->second;
-                        for (size_t j = 0; j < labelIndices.size(); ++j) 
-                        {
-                            size_t idx = labelIndices[j];
-                            scoreIndexPairs.push_back(ScoreIndexPair(scores[idx], IndexPair(label, idx)));
-                        }
-                    }
-                    std::sort(scoreIndexPairs.begin(), scoreIndexPairs.end(), [](const ScoreIndexPair & a, const ScoreIndexPair & b) { return a.first > b.first; });
-                    scoreIndexPairs.resize(_keepTopK);
-                    IndexMap newIndices;
-                    for (size_t j = 0; j < scoreIndexPairs.size(); ++j)
-                    {
-                        size_t label = scoreIndexPairs[j].second.first;
-                        size_t idx = scoreIndexPairs[j].second.second;
-                        newIndices[(int)label].push_back(idx);
-                    }
-                    allIndices.push_back(newIndices);
-                    numKept += _keepTopK;
-                }
-                else 
-                {
-                    allIndices.push_back(indices);
-                    numKept += numDet;
+                    SelectCandidates(pConf, c);
+                    ApplyNms(c);
                 }
+                KeepTopK(_images.back());
+                _images.push_back(_detections.size());
+                pLoc += _numPriors * _numLocClasses * 4;
+                pConf += _numPriors * _numClasses;
             }
 
+            size_t numKept = _detections.size();
             Shape shape(2, 1);
-            shape.push_back(numKept);
+            shape.push_back(numKept ? numKept : num);
             shape.push_back(7);
-            Type * pDst;
-            if (numKept == 0) 
+            dst[0]->Reshape(shape);
+            Type * pDst = dst[0]->CpuData();
+            if (numKept == 0)
             {
-                shape[2] = num;
-                dst[0]->Reshape(shape);
-                pDst = dst[0]->CpuData();
                 CpuSet(dst[0]->Size(), Type(-1), pDst);
-                for (size_t i = 0; i < num; ++i) 
+                for (size_t i = 0; i < num; ++i, pDst += 7)
+                    pDst[0] = Type(i);
+                return;
+            }
+            for (size_t i = 0; i < num; ++i)
+            {
+                for (size_t d = _images[i]; d < _images[i + 1]; ++d, pDst += 7)
                 {
+                    const Detection & detection = _detections[d];
                     pDst[0] = Type(i);
-                    pDst += 7;
+                    pDst[1] = Type(detection.label);
+                    pDst[2] = detection.score;
+                    pDst[3] = detection.xmin;
+                    pDst[4] = detection.ymin;
+                    pDst[5] = detection.xmax;
+                    pDst[6] = detection.ymax;
                 }
             }
-            else 
+        }
+
+    private:
+        struct Boxes
+        {
+            Floats xmin, ymin, xmax, ymax, area;
+
+            void Resize(size_t size)
             {
-                dst[0]->Reshape(shape);
-                pDst = dst[0]->CpuData();
+                xmin.resize(size);
+                ymin.resize(size);
+                xmax.resize(size);
+                ymax.resize(size);
+                area.resize(size);
             }
+        };
 
-            size_t count = 0;
-            for (size_t i = 0; i < num; ++i) 
+        struct ScoreIndex
+        {
+            float score;
+            size_t index;
+
+            ScoreIndex(float s = 0, size_t i = 0) : score(s), index(i) {}
+
+            SYNET_INLINE bool operator > (const ScoreIndex & other) const
             {
-                const LabelPred & confScores = allConfScores[i];
-                const LabelBBox & decodeBboxes = allDecodeBboxes[i];
-                for (IndexMap::iterator it = allIndices[i].begin(); it != allIndices[i].end(); ++it) 
-                {
-                    int label = it->first;
-                    assert(confScores.find(label) != confScores.end());
-                    const Floats & scores = confScores.find(label)->second;
-                    int locLabel = _shareLocation ? -1 : label;
-                    assert(decodeBboxes.find(locLabel) != decodeBboxes.end());
-                    const NormalizedBBoxes & bboxes = decodeBboxes.find(locLabel)->second;
-                    Index & indices = it->second;
-                    for (size_t j = 0; j < indices.size(); ++j) 
-                    {
-                        size_t idx = indices[j];
-                        pDst[count * 7 + 0] = Type(i);
-                        pDst[count * 7 + 1] = Type(label);
-                        pDst[count * 7 + 2] = scores[idx];
-                        const NormalizedBBox & bbox = bboxes[idx];
-                        pDst[count * 7 + 3] = bbox.xmin;
-                        pDst[count * 7 + 4] = bbox.ymin;
-                        pDst[count * 7 + 5] = bbox.xmax;
-                        pDst[count * 7 + 6] = bbox.ymax;
-                        ++count;
-                    }
-                }
+                return score > other.score || (score == other.score && index < other.index);
             }
-        }
-    private:
-        typedef typename Base::Tensor Tensor;
-        typedef std::map<int, std::vector<NormalizedBBox>> LabelBBox;
-        typedef std::vector<LabelBBox> LabelBBoxes;
-        typedef std::map<int, Floats> LabelPred;
-        typedef std::vector<LabelPred> LabelPreds;
-        typedef std::vector<NormalizedBBox> NormalizedBBoxes;
-        typedef std::vector<Floats> Variances;
-        typedef std::map<int, Index> IndexMap;
-        typedef std::vector<IndexMap> IndexMaps;
-        typedef std::pair<float, size_t> ScoreIndex;
-        typedef std::vector<ScoreIndex> ScoreIndeces;
-        typedef std::pair<size_t, size_t> IndexPair;
-        typedef std::pair<float, IndexPair> ScoreIndexPair;
-        typedef std::vector<ScoreIndexPair> ScoreIndexPairs;
+        };
+        typedef std::vector<ScoreIndex> ScoreIndices;
+
+        struct Detection
+        {
+            float score, xmin, ymin, xmax, ymax;
+            size_t label;
+        };
+        typedef std::vector<Detection> Detections;
 
         bool _shareLocation, _varianceEncodedInTarget, _keepMaxClassScoresOnly, _clip;
         size_t _numClasses, _numLocClasses, _numPriors;
         ptrdiff_t _backgroundLabelId, _keepTopK, _topK;
         PriorBoxCodeType _codeType;
         float _confidenceThreshold, _nmsThreshold, _eta;
-        Tensor _bboxPreds, _bboxPermute, _confPermute;
 
-        void GetLocPredictions(const Type * pLoc, size_t num, size_t numPredsPerClass, size_t numLocClasses, bool shareLocation, LabelBBoxes & locPreds)
+        Boxes _priors, _boxes, _candidates;
+        Floats _variances, _overlap;
+        Ints _maxClass;
+        ScoreIndices _scores;
+        Detections _detections;
+        Index _images;
+
+        void SetPriors(const Type * prior)
         {
-            locPreds.clear();
-            locPreds.resize(num);
-            for (size_t i = 0; i < num; ++i) 
+            size_t n = _numPriors;
+            float * xmin = _priors.xmin.data(), * ymin = _priors.ymin.data();
+            float * xmax = _priors.xmax.data(), * ymax = _priors.ymax.data();
+            for (size_t p = 0; p < n; ++p, prior += 4)
             {
-                LabelBBox & labelBbox = locPreds[i];
-                for (size_t p = 0; p < numPredsPerClass; ++p)
-                {
-                    size_t startIdx = p * numLocClasses * 4;
-                    for (size_t c = 0; c < numLocClasses; ++c)
-                    {
-                        int label = shareLocation ? -1 : (int)c;
-                        if (labelBbox.find(label) == labelBbox.end())
-                            labelBbox[label].resize(numPredsPerClass);
-                        labelBbox[label][p].xmin = pLoc[startIdx + c * 4 + 0];
-                        labelBbox[label][p].ymin = pLoc[startIdx + c * 4 + 1];
-                        labelBbox[label][p].xmax = pLoc[startIdx + c * 4 + 2];
-                        labelBbox[label][p].ymax = pLoc[startIdx + c * 4 + 3];
-                    }
-                }
-                pLoc += numPredsPerClass * numLocClasses * 4;
+                xmin[p] = prior[0];
+                ymin[p] = prior[1];
+                xmax[p] = prior[2];
+                ymax[p] = prior[3];
             }
+            for (size_t p = 0; p < n; ++p, prior += 4)
+                for (size_t k = 0; k < 4; ++k)
+                    _variances[k * n + p] = _varianceEncodedInTarget ? 1.0f : prior[k];
         }
 
-        void GetConfidenceScores(const Type * pConf, size_t num, size_t numPredsPerClass, size_t numClasses, LabelPreds & confPreds, bool keepMaxScoreOnly)
+        void SetMaxClass(const Type * conf)
         {
-            confPreds.clear();
-            confPreds.resize(num);
-            for (size_t i = 0; i < num; ++i) 
+            for (size_t p = 0; p < _numPriors; ++p, conf += _numClasses)
             {
-                LabelPred & labelScores = confPreds[i];
-                for (size_t p = 0; p < numPredsPerClass; ++p)
+                float maxScore = 0.0f;
+                int maxClass = -1;
+                for (size_t c = 0; c < _numClasses; ++c)
                 {
-                    size_t startIdx = p * numClasses;
-                    size_t maxClassScoreIdx = 0;
-                    float maxClassScore = 0;
-                    for (size_t c = 0; c < numClasses; ++c)
-                    {
-                        labelScores[(int)c].push_back(pConf[startIdx + c]);
-                        if (pConf[startIdx + c] >= maxClassScore)
-                        {
-                            maxClassScoreIdx = c;
-                            maxClassScore = pConf[startIdx + c];
-                        }
-                    }
-                    if (keepMaxScoreOnly)
+                    if (conf[c] >= maxScore && (ptrdiff_t)c != _backgroundLabelId)
                     {
-                        for (size_t c = 0; c < numClasses; ++c)
-                            if (c != maxClassScoreIdx)
-                                labelScores[(int)c].back() = 0.0;
+                        maxClass = (int)c;
+                        maxScore = conf[c];
                     }
                 }
-                pConf += numPredsPerClass * numClasses;
+                _maxClass[p] = maxClass;
             }
         }
 
-        void GetPriorBBoxes(const Type * pPrior, size_t numPriors, NormalizedBBoxes & priorBboxes, Variances & priorVariances)
+        void DecodeBoxes(const Type * loc, size_t c)
         {
-            priorBboxes.clear();
-            priorVariances.clear();
-            for (size_t i = 0; i < numPriors; ++i)
+            size_t n = _numPriors, step = _numLocClasses * 4;
+            const float * pXmin = _priors.xmin.data(), * pYmin = _priors.ymin.data();
+            const float * pXmax = _priors.xmax.data(), * pYmax = _priors.ymax.data();
+            const float * v0 = _variances.data(), * v1 = v0 + n, * v2 = v1 + n, * v3 = v2 + n;
+            float * xmin = _boxes.xmin.data() + c * n, * ymin = _boxes.ymin.data() + c * n;
+            float * xmax = _boxes.xmax.data() + c * n, * ymax = _boxes.ymax.data() + c * n;
+            float * area = _boxes.area.data() + c * n;
+            loc += c * 4;
+            if (_codeType == PriorBoxCodeTypeCorner)
             {
-                size_t startIdx = i * 4;
-                NormalizedBBox bbox;
-                bbox.xmin = pPrior[startIdx + 0];
-                bbox.ymin = pPrior[startIdx + 1];
-                bbox.xmax = pPrior[startIdx + 2];
-                bbox.ymax = pPrior[startIdx + 3];
-                float bboxSize = BBoxSize(bbox, true);
-                bbox.size = bboxSize;
-                priorBboxes.push_back(bbox);
-            }
-            for (size_t i = 0; i < numPriors; ++i)
-            {
-                size_t startIdx = (numPriors + i) * 4;
-                Floats var;
-                for (int j = 0; j < 4; ++j)
-                    var.push_back(pPrior[startIdx + j]);
-                priorVariances.push_back(var);
-            }
-        }
-
-        float BBoxSize(const NormalizedBBox & bbox, bool normalized) 
-        {
-            if (bbox.xmax < bbox.xmin || bbox.ymax < bbox.ymin) 
-                return 0;
-            else 
-            {
-                float w = bbox.xmax - bbox.xmin;
-                float h = bbox.ymax - bbox.ymin;
-                if (normalized)
-                    return w * h;
-                else 
-                    return (w + 1) * (h + 1);
-            }
-        }
-
-        void ClipBBox(const NormalizedBBox & src, NormalizedBBox & dst) 
-        {
-            dst.xmin = std::max(std::min(src.xmin, 1.f), 0.f);
-            dst.ymin = std::max(std::min(src.ymin, 1.f), 0.f);
-            dst.xmax = std::max(std::min(src.xmax, 1.f), 0.f);
-            dst.ymax = std::max(std::min(src.ymax, 1.f), 0.f);
-            dst.size = BBoxSize(src, true);
-            dst.difficult = src.difficult;
-        }
-
-        void DecodeBBox(const NormalizedBBox & priorBbox, const Floats & priorVariance, PriorBoxCodeType codeType, bool varianceEncodedInTarget,
-            bool clipBbox, const NormalizedBBox & bbox, NormalizedBBox & decodeBbox) 
-        {
-            if (codeType == PriorBoxCodeTypeCorner)
-            {
-                if (varianceEncodedInTarget)
+                for (size_t p = 0; p < n; ++p)
                 {
-                    decodeBbox.xmin = priorBbox.xmin + bbox.xmin;
-                    decodeBbox.ymin = priorBbox.ymin + bbox.ymin;
-                    decodeBbox.xmax = priorBbox.xmax + bbox.xmax;
-                    decodeBbox.ymax = priorBbox.ymax + bbox.ymax;
-                }
-                else
-                {
-
-                    decodeBbox.xmin = priorBbox.xmin + priorVariance[0] * bbox.xmin;
-                    decodeBbox.ymin = priorBbox.ymin + priorVariance[1] * bbox.ymin;
-                    decodeBbox.xmax = priorBbox.xmax + priorVariance[2] * bbox.xmax;
-                    decodeBbox.ymax = priorBbox.ymax + priorVariance[3] * bbox.ymax;
+                    const Type * l = loc + p * step;
+                    xmin[p] = pXmin[p] + v0[p] * l[0];
+                    ymin[p] = pYmin[p] + v1[p] * l[1];
+                    xmax[p] = pXmax[p] + v2[p] * l[2];
+                    ymax[p] = pYmax[p] + v3[p] * l[3];
                 }
             }
-            else if (codeType == PriorBoxCodeTypeCenterSize)
+            else if (_codeType == PriorBoxCodeTypeCenterSize)
             {
-                float priorW = priorBbox.xmax - priorBbox.xmin;
-                float priorH = priorBbox.ymax - priorBbox.ymin;
-                float priorX = (priorBbox.xmin + priorBbox.xmax) / 2.0f;
-                float priorY = (priorBbox.ymin + priorBbox.ymax) / 2.0f;
-                float bboxX, bboxY, bboxW, bboxH;
-                if (varianceEncodedInTarget)
+                for (size_t p = 0; p < n; ++p)
                 {
-                    bboxX = bbox.xmin * priorW + priorX;
-                    bboxY = bbox.ymin * priorH + priorY;
-                    bboxW = ::exp(bbox.xmax) * priorW;
-                    bboxH = ::exp(bbox.ymax) * priorH;
+                    const Type * l = loc + p * step;
+                    xmin[p] = v0[p] * l[0] * (pXmax[p] - pXmin[p]) + (pXmin[p] + pXmax[p]) / 2.0f;
+                    ymin[p] = v1[p] * l[1] * (pYmax[p] - pYmin[p]) + (pYmin[p] + pYmax[p]) / 2.0f;
+                    xmax[p] = v2[p] * l[2];
+                    ymax[p] = v3[p] * l[3];
                 }
-                else
+                CpuExp(xmax, n, xmax);
+                CpuExp(ymax, n, ymax);
+                for (size_t p = 0; p < n; ++p)
                 {
-                    bboxX = priorVariance[0] * bbox.xmin * priorW + priorX;
-                    bboxY = priorVariance[1] * bbox.ymin * priorH + priorY;
-                    bboxW = ::exp(priorVariance[2] * bbox.xmax) * priorW;
-                    bboxH = ::exp(priorVariance[3] * bbox.ymax) * priorH;
+                    float halfW = xmax[p] * (pXmax[p] - pXmin[p]) / 2.0f;
+                    float halfH = ymax[p] * (pYmax[p] - pYmin[p]) / 2.0f;
+                    float x = xmin[p], y = ymin[p];
+                    xmin[p] = x - halfW;
+                    ymin[p] = y - halfH;
+                    xmax[p] = x + halfW;
+                    ymax[p] = y + halfH;
                 }
-                decodeBbox.xmin = bboxX - bboxW / 2.0f;
-                decodeBbox.ymin = bboxY - bboxH / 2.0f;
-                decodeBbox.xmax = bboxX + bboxW / 2.0f;
-                decodeBbox.ymax = bboxY + bboxH / 2.0f;
             }
-            else if (codeType == PriorBoxCodeTypeCornerSize)
+            else if (_codeType == PriorBoxCodeTypeCornerSize)
             {
-                float priorW = priorBbox.xmax - priorBbox.xmin;
-                float priorH = priorBbox.ymax - priorBbox.ymin;
-                if (varianceEncodedInTarget)
+                for (size_t p = 0; p < n; ++p)
                 {
-                    decodeBbox.xmin = priorBbox.xmin + bbox.xmin * priorW;
-                    decodeBbox.ymin = priorBbox.ymin + bbox.ymin * priorH;
-                    decodeBbox.xmax = priorBbox.xmax + bbox.xmax * priorW;
-                    decodeBbox.ymax = priorBbox.ymax + bbox.ymax * priorH;
-                }
-                else
-                {
-                    decodeBbox.xmin = priorBbox.xmin + priorVariance[0] * bbox.xmin * priorW;
-                    decodeBbox.ymin = priorBbox.ymin + priorVariance[1] * bbox.ymin * priorH;
-                    decodeBbox.xmax = priorBbox.xmax + priorVariance[2] * bbox.xmax * priorW;
-                    decodeBbox.ymax = priorBbox.ymax + priorVariance[3] * bbox.ymax * priorH;
+                    const Type * l = loc + p * step;
+                    float w = pXmax[p] - pXmin[p], h = pYmax[p] - pYmin[p];
+                    xmin[p] = pXmin[p] + v0[p] * l[0] * w;
+                    ymin[p] = pYmin[p] + v1[p] * l[1] * h;
+                    xmax[p] = pXmax[p] + v2[p] * l[2] * w;
+                    ymax[p] = pYmax[p] + v3[p] * l[3] * h;
                 }
             }
             else
                 assert(0);
-            decodeBbox.size = BBoxSize(decodeBbox, true);
-            if (clipBbox)
-                ClipBBox(decodeBbox, decodeBbox);
-        }
-
-        void DecodeBBoxes(const NormalizedBBoxes & priorBboxes, const Variances & priorVariances, PriorBoxCodeType codeType, bool varianceEncodedInTarget,
-            bool clipBbox, const NormalizedBBoxes & bboxes, NormalizedBBoxes & decodeBboxes) 
-        {
-            size_t numBboxes = priorBboxes.size();
-            if (numBboxes >= 1)
-                assert(priorVariances[0].size() == 4);
-            decodeBboxes.clear();
-            for (size_t i = 0; i < numBboxes; ++i) 
-            {
-                NormalizedBBox decodeBbox;
-                DecodeBBox(priorBboxes[i], priorVariances[i], codeType, varianceEncodedInTarget, clipBbox, bboxes[i], decodeBbox);
-                decodeBboxes.push_back(decodeBbox);
-            }
-        }
-
-        void DecodeBBoxesAll(const LabelBBoxes & allLocPreds, const NormalizedBBoxes & priorBboxes, const Variances & priorVariances, size_t num, 
-            bool shareLocation, size_t numLocClasses, size_t backgroundLabelId, PriorBoxCodeType codeType, bool varianceEncodedInTarget, bool clip, LabelBBoxes & allDecodeBboxes)
-        {
-            allDecodeBboxes.clear();
-            allDecodeBboxes.resize(num);
-            for (size_t i = 0; i < num; ++i) 
+            if (_clip)
             {
-                LabelBBox & decodeBboxes = allDecodeBboxes[i];
-                for (size_t c = 0; c < numLocClasses; ++c) 
+                for (size_t p = 0; p < n; ++p)
                 {
-                    int label = shareLocation ? -1 : (int)c;
-                    if (label == backgroundLabelId)
-                        continue;
-                    assert(allLocPreds[i].find(label) != allLocPreds[i].end());
-                    const NormalizedBBoxes & labelLocPreds = allLocPreds[i].find(label)->second;
-                    DecodeBBoxes(priorBboxes, priorVariances, codeType, varianceEncodedInTarget, clip, labelLocPreds, decodeBboxes[label]);
+                    xmin[p] = std::max(std::min(xmin[p], 1.0f), 0.0f);
+                    ymin[p] = std::max(std::min(ymin[p], 1.0f), 0.0f);
+                    xmax[p] = std::max(std::min(xmax[p], 1.0f), 0.0f);
+                    ymax[p] = std::max(std::min(ymax[p], 1.0f), 0.0f);
                 }
             }
+            for (size_t p = 0; p < n; ++p)
+                area[p] = std::max(xmax[p] - xmin[p], 0.0f) * std::max(ymax[p] - ymin[p], 0.0f);
         }
 
-        void GetMaxScoreIndex(const Floats & scores, float threshold, ptrdiff_t topK, ScoreIndeces & scoreIndeces)
-        {
-            scoreIndeces.clear();
-            for (size_t i = 0; i < scores.size(); ++i) 
-            {
-                if (scores[i] > threshold)
-                    scoreIndeces.push_back(ScoreIndex(scores[i], i));
-            }
-            std::stable_sort(scoreIndeces.begin(), scoreIndeces.end(), [](const ScoreIndex & a, const ScoreIndex & b) { return a.first > b.first; });
-            if (topK > -1 && (size_t)topK < scoreIndeces.size())
-                scoreIndeces.resize(topK);
-        }
-
-        void IntersectBBox(const NormalizedBBox & bbox1, const NormalizedBBox & bbox2, NormalizedBBox & intersect) 
+        void SelectCandidates(const Type * conf, size_t c)
         {
-            if (bbox2.xmin > bbox1.xmax || bbox2.xmax < bbox1.xmin || bbox2.ymin > bbox1.ymax || bbox2.ymax < bbox1.ymin)
+            _scores.resize(_numPriors);
+            size_t count = 0;
+            for (size_t p = 0; p < _numPriors; ++p, conf += _numClasses)
             {
-                intersect.xmin = 0;
-                intersect.ymin = 0;
-                intersect.xmax = 0;
-                intersect.ymax = 0;
+                float score = conf[c];
+                if (_keepMaxClassScoresOnly && _maxClass[p] != (int)c)
+                    score = 0.0f;
+                _scores[count] = ScoreIndex(score, p);
+                count += score > _confidenceThreshold ? 1 : 0;
             }
-            else 
+            _scores.resize(count);
+            if (_topK > -1 && (size_t)_topK < _scores.size())
             {
-                intersect.xmin = std::max(bbox1.xmin, bbox2.xmin);
-                intersect.ymin = std::max(bbox1.ymin, bbox2.ymin);
-                intersect.xmax = std::min(bbox1.xmax, bbox2.xmax);
-                intersect.ymax = std::min(bbox1.ymax, bbox2.ymax);
+                std::nth_element(_scores.begin(), _scores.begin() + _topK, _scores.end(), std::greater<ScoreIndex>());
+                _scores.resize(_topK);
             }
+            std::sort(_scores.begin(), _scores.end(), std::greater<ScoreIndex>());
         }
 
-        float JaccardOverlap(const NormalizedBBox & bbox1, const NormalizedBBox & bbox2, bool normalized) 
+        void ApplyNms(size_t c)
         {
-            NormalizedBBox intersect;
-            IntersectBBox(bbox1, bbox2, intersect);
-            float intersectW, intersectH;
-            if (normalized) 
+            size_t n = _scores.size(), offset = _shareLocation ? 0 : c * _numPriors;
+            if (_candidates.xmin.size() < n)
             {
-                intersectW = intersect.xmax - intersect.xmin;
-                intersectH = intersect.ymax - intersect.ymin;
+                _candidates.Resize(n);
+                _overlap.resize(n);
             }
-            else 
+            float * xmin = _candidates.xmin.data(), * ymin = _candidates.ymin.data();
+            float * xmax = _candidates.xmax.data(), * ymax = _candidates.ymax.data();
+            float * area = _candidates.area.data(), * overlap = _overlap.data();
+            for (size_t i = 0; i < n; ++i)
             {
-                intersectW = intersect.xmax - intersect.xmin + 1;
-                intersectH = intersect.ymax - intersect.ymin + 1;
+                size_t index = offset + _scores[i].index;
+                xmin[i] = _boxes.xmin[index];
+                ymin[i] = _boxes.ymin[index];
+                xmax[i] = _boxes.xmax[index];
+                ymax[i] = _boxes.ymax[index];
+                area[i] = _boxes.area[index];
+                overlap[i] = 0.0f;
             }
-            if (intersectW > 0 && intersectH > 0) 
+            float threshold = _nmsThreshold;
+            for (size_t i = 0; i < n; ++i)
             {
-                float intersectS = intersectW * intersectH;
-                float bbox1Size = BBoxSize(bbox1, true);
-                float bbox2Size = BBoxSize(bbox2, true);
-                return intersectS / (bbox1Size + bbox2Size - intersectS);
+                if (!(overlap[i] <= threshold))
+                    continue;
+                Detection detection;
+                detection.score = _scores[i].score;
+                detection.label = c;
+                detection.xmin = xmin[i];
+                detection.ymin = ymin[i];
+                detection.xmax = xmax[i];
+                detection.ymax = ymax[i];
+                _detections.push_back(detection);
+                for (size_t j = i + 1; j < n; ++j)
+                {
+                    float w = std::max(std::min(xmax[i], xmax[j]) - std::max(xmin[i], xmin[j]), 0.0f);
+                    float h = std::max(std::min(ymax[i], ymax[j]) - std::max(ymin[i], ymin[j]), 0.0f);
+                    float intersection = w * h;
+                    float iou = w > 0.0f && h > 0.0f ? intersection / (area[i] + area[j] - intersection) : 0.0f;
+                    overlap[j] = std::max(overlap[j], iou);
+                }
+                if (_eta < 1.0f && threshold > 0.5f)
+                    threshold *= _eta;
             }
-            else
-                return 0;
         }
 
-        void ApplyNMSFast(const NormalizedBBoxes & bboxes, const Floats & scores, float scoreThreshold, float nmsThreshold, float eta, ptrdiff_t topK, Index & indices)
+        void KeepTopK(size_t begin)
         {
-            ScoreIndeces scoreIndeces;
-            GetMaxScoreIndex(scores, scoreThreshold, topK, scoreIndeces);
-            float adaptiveThreshold = nmsThreshold;
-            indices.clear();
-            while (scoreIndeces.size() != 0)
+            size_t size = _detections.size() - begin;
+            if (_keepTopK < 0 || size <= (size_t)_keepTopK)
+                return;
+            _scores.clear();
+            for (size_t i = 0; i < size; ++i)
+                _scores.push_back(ScoreIndex(_detections[begin + i].score, i));
+            std::nth_element(_scores.begin(), _scores.begin() + _keepTopK, _scores.end(), std::greater<ScoreIndex>());
+            const ScoreIndex & last = _scores[_keepTopK];
+            size_t kept = begin;
+            for (size_t i = 0; i < size; ++i)
             {
-                size_t idx = scoreIndeces.front().second;
-                bool keep = true;
-                for (int k = 0; k < indices.size(); ++k) 
-                {
-                    if (keep)
-                    {
-                        size_t keptIdx = indices[k];
-                        float overlap = JaccardOverlap(bboxes[idx], bboxes[keptIdx], true);
-                        keep = overlap <= adaptiveThreshold;
-                    }
-                    else
-                        break;
-                }
-                if (keep)
-                    indices.push_back(idx);
-                scoreIndeces.erase(scoreIndeces.begin());
-                if (keep && eta < 1 && adaptiveThreshold > 0.5)
-                    adaptiveThreshold *= eta;
+                if (ScoreIndex(_detections[begin + i].score, i) > last)
+                    _detections[kept++] = _detections[begin + i];
             }
+            _detections.resize(kept);
         }
     };
-}
\ No newline at end of file
+}
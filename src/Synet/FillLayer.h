@@ -48,7 +48,13 @@ namespace Synet
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            dst[0]->Share(*src[0]);
+            dst[0]->Reshape(src[0]->Shape());
+            CpuSet(dst[0]->Size(), _value, dst[0]->CpuData());
+        }
+
+        virtual bool Const() const
+        {
+            return true;
         }
 
     protected:
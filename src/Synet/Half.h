@@ -0,0 +1,225 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+
+#if defined(__F16C__) && !defined(SYNET_SIMD_LIBRARY_ENABLE)
+#include <immintrin.h>
+#endif
+
+#ifndef SYNET_HALF_PANEL_SIZE
+#define SYNET_HALF_PANEL_SIZE 0x10000
+#endif
+
+namespace Synet
+{
+    typedef std::vector<uint16_t> Halfs;
+
+    SYNET_INLINE bool IsHalf(TensorType type)
+    {
+        return type == TensorType16f || type == TensorType16b;
+    }
+
+    namespace Detail
+    {
+        union Bits32
+        {
+            uint32_t i;
+            float f;
+        };
+
+        SYNET_INLINE uint16_t Fp32ToFp16(float value)
+        {
+            Bits32 bits;
+            bits.f = value;
+            uint32_t sign = bits.i & 0x80000000;
+            bits.i ^= sign;
+            uint16_t half;
+            if (bits.i >= 0x47800000)
+                half = bits.i > 0x7F800000 ? 0x7E00 : 0x7C00;
+            else if (bits.i < 0x38800000)
+            {
+                Bits32 denorm;
+                denorm.i = 0x3F000000;
+                bits.f += denorm.f;
+                half = uint16_t(bits.i - denorm.i);
+            }
+            else
+            {
+                uint32_t odd = (bits.i >> 13) & 1;
+                bits.i += 0xC8000FFF + odd;
+                half = uint16_t(bits.i >> 13);
+            }
+            return half | uint16_t(sign >> 16);
+        }
+
+        SYNET_INLINE float Fp16ToFp32(uint16_t value)
+        {
+            Bits32 bits, magic;
+            magic.i = 113 << 23;
+            bits.i = (value & 0x7FFF) << 13;
+            uint32_t exp = bits.i & 0x0F800000;
+            bits.i += 0x38000000;
+            if (exp == 0x0F800000)
+                bits.i += 0x38000000;
+            else if (exp == 0)
+            {
+                bits.i += 1 << 23;
+                bits.f -= magic.f;
+            }
+            bits.i |= (value & 0x8000) << 16;
+            return bits.f;
+        }
+
+        SYNET_INLINE uint16_t Fp32ToBf16(float value)
+        {
+            Bits32 bits;
+            bits.f = value;
+            if ((bits.i & 0x7FFFFFFF) > 0x7F800000)
+                return uint16_t((bits.i >> 16) | 0x0040);
+            bits.i += 0x7FFF + ((bits.i >> 16) & 1);
+            return uint16_t(bits.i >> 16);
+        }
+
+        SYNET_INLINE float Bf16ToFp32(uint16_t value)
+        {
+            Bits32 bits;
+            bits.i = uint32_t(value) << 16;
+            return bits.f;
+        }
+
+        SYNET_INLINE void CpuFp32ToFp16(const float * src, size_t size, uint16_t * dst)
+        {
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            ::SimdFloat32ToFloat16(src, size, dst);
+#else
+            size_t i = 0;
+#if defined(__F16C__)
+            for (; i + 8 <= size; i += 8)
+                _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+            for (; i < size; ++i)
+                dst[i] = Fp32ToFp16(src[i]);
+#endif
+        }
+
+        SYNET_INLINE void CpuFp16ToFp32(const uint16_t * src, size_t size, float * dst)
+        {
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            ::SimdFloat16ToFloat32(src, size, dst);
+#else
+            size_t i = 0;
+#if defined(__F16C__)
+            for (; i + 8 <= size; i += 8)
+                _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((__m128i*)(src + i))));
+#endif
+            for (; i < size; ++i)
+                dst[i] = Fp16ToFp32(src[i]);
+#endif
+        }
+
+        SYNET_INLINE void CpuFp32ToBf16(const float * src, size_t size, uint16_t * dst)
+        {
+            for (size_t i = 0; i < size; ++i)
+                dst[i] = Fp32ToBf16(src[i]);
+        }
+
+        SYNET_INLINE void CpuBf16ToFp32(const uint16_t * src, size_t size, float * dst)
+        {
+            for (size_t i = 0; i < size; ++i)
+                dst[i] = Bf16ToFp32(src[i]);
+        }
+    }
+
+    SYNET_INLINE void CpuFloatToHalf(const float * src, size_t size, TensorType type, uint16_t * dst)
+    {
+        if (type == TensorType16f)
+            Detail::CpuFp32ToFp16(src, size, dst);
+        else if (type == TensorType16b)
+            Detail::CpuFp32ToBf16(src, size, dst);
+        else
+            assert(0);
+    }
+
+    SYNET_INLINE void CpuHalfToFloat(const uint16_t * src, size_t size, TensorType type, float * dst)
+    {
+        if (type == TensorType16f)
+            Detail::CpuFp16ToFp32(src, size, dst);
+        else if (type == TensorType16b)
+            Detail::CpuBf16ToFp32(src, size, dst);
+        else
+            assert(0);
+    }
+
+    inline bool ConvertWeightToHalf(const String & srcParamPath, const String & srcWeightPath,
+        const String & dstParamPath, const String & dstWeightPath, TensorType type = TensorType16f)
+    {
+        if (!IsHalf(type))
+            return false;
+
+        NetworkParamHolder holder;
+        if (!holder.Load(srcParamPath))
+            return false;
+
+        std::ifstream ifs(srcWeightPath.c_str(), std::ifstream::binary);
+        if (!ifs.is_open())
+            return false;
+        std::ofstream ofs(dstWeightPath.c_str(), std::ofstream::binary);
+        if (!ofs.is_open())
+            return false;
+
+        Floats fp32;
+        Halfs half;
+        std::vector<LayerParam> & layers = holder().layers();
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            std::vector<ShapeParam> & weight = layers[i].weight();
+            bool compress = layers[i].type() == LayerTypeConvolution || layers[i].type() == LayerTypeInnerProduct;
+            for (size_t j = 0; j < weight.size(); ++j)
+            {
+                if (IsHalf(weight[j].type()))
+                    return false;
+                size_t size = 1;
+                for (size_t k = 0; k < weight[j].dim().size(); ++k)
+                    size *= weight[j].dim()[k];
+                fp32.resize(size);
+                if (!ifs.read((char*)fp32.data(), size * sizeof(float)))
+                    return false;
+                if (compress && j == 0)
+                {
+                    half.resize(size);
+                    CpuFloatToHalf(fp32.data(), size, type, half.data());
+                    ofs.write((const char*)half.data(), size * sizeof(uint16_t));
+                    weight[j].type() = type;
+                }
+                else
+                    ofs.write((const char*)fp32.data(), size * sizeof(float));
+            }
+        }
+        return holder.Save(dstParamPath, false) && ofs.good();
+    }
+}
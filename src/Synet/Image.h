@@ -0,0 +1,242 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/Math.h"
+#include "Synet/Parallel.h"
+
+namespace Synet
+{
+    namespace Detail
+    {
+        struct ImageResizeIndex
+        {
+            std::vector<size_t> index0, index1;
+            Floats alpha;
+
+            void Init(size_t srcSize, size_t dstSize)
+            {
+                index0.resize(dstSize);
+                index1.resize(dstSize);
+                alpha.resize(dstSize);
+                float scale = float(srcSize) / float(dstSize);
+                for (size_t i = 0; i < dstSize; ++i)
+                {
+                    float pos = std::max((i + 0.5f) * scale - 0.5f, 0.0f);
+                    size_t i0 = std::min((size_t)pos, srcSize - 1);
+                    index0[i] = i0;
+                    index1[i] = std::min(i0 + 1, srcSize - 1);
+                    alpha[i] = std::min(pos - i0, 1.0f);
+                }
+            }
+        };
+
+        SYNET_INLINE size_t ImageChannels(ImageFormatType format)
+        {
+            return format == ImageFormatTypeGray ? 1 : 3;
+        }
+
+        SYNET_INLINE void ImageLoadRow(const uint8_t * src, size_t stride, size_t height, ImageFormatType format, size_t y, const ImageResizeIndex & x, float * dst)
+        {
+            size_t width = x.alpha.size();
+            const size_t * i0 = x.index0.data(), * i1 = x.index1.data();
+            const float * alpha = x.alpha.data();
+            const uint8_t * row = src + y * stride;
+            if (format == ImageFormatTypeGray || format == ImageFormatTypeNv12)
+            {
+                for (size_t i = 0; i < width; ++i)
+                    dst[i] = row[i0[i]] + (float(row[i1[i]]) - float(row[i0[i]])) * alpha[i];
+                if (format == ImageFormatTypeNv12)
+                {
+                    const uint8_t * uv = src + height * stride + y / 2 * stride;
+                    for (size_t i = 0; i < width; ++i)
+                    {
+                        size_t offset = i0[i] & (~size_t(1));
+                        dst[width + i] = uv[offset + 0];
+                        dst[2 * width + i] = uv[offset + 1];
+                    }
+                }
+            }
+            else
+            {
+                size_t step = format == ImageFormatTypeBgra ? 4 : 3;
+                for (size_t c = 0; c < 3; ++c, row += 1, dst += width)
+                    for (size_t i = 0; i < width; ++i)
+                        dst[i] = row[i0[i] * step] + (float(row[i1[i] * step]) - float(row[i0[i] * step])) * alpha[i];
+            }
+        }
+    }
+
+    class ImageConverter
+    {
+    public:
+        ImageConverter()
+            : _srcW(0), _srcH(0), _dstW(0), _dstH(0), _letterbox(false), _format(ImageFormatTypeUnknown)
+        {
+        }
+
+        bool Init(const InputParam & param, size_t srcW, size_t srcH, ImageFormatType format, size_t dstC, size_t dstH, size_t dstW)
+        {
+            if (format <= ImageFormatTypeUnknown || format >= ImageFormatTypeSize || srcW == 0 || srcH == 0)
+                return false;
+            if (dstC != Detail::ImageChannels(param.format()) || param.format() == ImageFormatTypeBgra || param.format() == ImageFormatTypeNv12)
+                return false;
+            if (format == ImageFormatTypeNv12 && (srcW & 1 || srcH & 1))
+                return false;
+            if (srcW != _srcW || srcH != _srcH || dstW != _dstW || dstH != _dstH || param.letterbox() != _letterbox)
+            {
+                _srcW = srcW, _srcH = srcH, _dstW = dstW, _dstH = dstH, _letterbox = param.letterbox();
+                _w = dstW, _h = dstH, _x = 0, _y = 0;
+                if (_letterbox)
+                {
+                    float scale = std::min(float(dstW) / srcW, float(dstH) / srcH);
+                    _w = std::max<size_t>(std::min<size_t>(size_t(srcW * scale + 0.5f), dstW), 1);
+                    _h = std::max<size_t>(std::min<size_t>(size_t(srcH * scale + 0.5f), dstH), 1);
+                    _x = (dstW - _w) / 2;
+                    _y = (dstH - _h) / 2;
+                }
+                _ix.Init(srcW, _w);
+                _iy.Init(srcH, _h);
+            }
+            _format = format;
+            _channels = dstC;
+            InitMatrix(param);
+            return true;
+        }
+
+        void Convert(const uint8_t * src, size_t stride, float * dst)
+        {
+            size_t srcC = Detail::ImageChannels(_format), dstC = _channels, size = _dstW * _dstH;
+            if (_letterbox)
+            {
+                for (size_t c = 0; c < dstC; ++c)
+                {
+                    float pad = _bias[c];
+                    for (size_t k = 0; k < srcC; ++k)
+                        pad += _matrix[c * 3 + k] * 128.0f;
+                    CpuSet(size, pad, dst + c * size);
+                }
+            }
+            size_t threads = size * dstC < 0x10000 ? 1 : GetThreadNumber();
+            _buffers.resize(threads);
+            Parallel(0, _h, [&](size_t thread, size_t begin, size_t end)
+            {
+                Floats & buffer = _buffers[thread];
+                buffer.resize(2 * srcC * _w);
+                float * row0 = buffer.data(), * row1 = row0 + srcC * _w;
+                for (size_t y = begin; y < end; ++y)
+                {
+                    Detail::ImageLoadRow(src, stride, _srcH, _format, _iy.index0[y], _ix, row0);
+                    Detail::ImageLoadRow(src, stride, _srcH, _format, _iy.index1[y], _ix, row1);
+                    float alpha = _iy.alpha[y];
+                    for (size_t i = 0, n = srcC * _w; i < n; ++i)
+                        row0[i] += (row1[i] - row0[i]) * alpha;
+                    for (size_t c = 0; c < dstC; ++c)
+                    {
+                        float * pDst = dst + c * size + (_y + y) * _dstW + _x;
+                        const float * matrix = _matrix + c * 3;
+                        float bias = _bias[c];
+                        for (size_t i = 0; i < _w; ++i)
+                            pDst[i] = bias;
+                        for (size_t k = 0; k < srcC; ++k)
+                        {
+                            const float * pSrc = row0 + k * _w;
+                            float m = matrix[k];
+                            for (size_t i = 0; i < _w; ++i)
+                                pDst[i] += m * pSrc[i];
+                        }
+                    }
+                }
+            }, threads);
+        }
+
+    private:
+        size_t _srcW, _srcH, _dstW, _dstH, _channels, _w, _h, _x, _y;
+        bool _letterbox;
+        ImageFormatType _format;
+        Detail::ImageResizeIndex _ix, _iy;
+        float _matrix[9], _bias[3];
+        std::vector<Floats> _buffers;
+
+        void InitMatrix(const InputParam & param)
+        {
+            float bgr[9] = { 0 }, offset[3] = { 0 };
+            switch (_format)
+            {
+            case ImageFormatTypeGray:
+                bgr[0] = bgr[3] = bgr[6] = 1.0f;
+                break;
+            case ImageFormatTypeBgr:
+            case ImageFormatTypeBgra:
+                bgr[0] = bgr[4] = bgr[8] = 1.0f;
+                break;
+            case ImageFormatTypeRgb:
+                bgr[2] = bgr[4] = bgr[6] = 1.0f;
+                break;
+            case ImageFormatTypeNv12:
+                bgr[0] = 1.164f, bgr[1] = 2.018f, bgr[2] = 0.0f;
+                bgr[3] = 1.164f, bgr[4] = -0.391f, bgr[5] = -0.813f;
+                bgr[6] = 1.164f, bgr[7] = 0.0f, bgr[8] = 1.596f;
+                for (size_t c = 0; c < 3; ++c)
+                    offset[c] = -16.0f * bgr[c * 3 + 0] - 128.0f * (bgr[c * 3 + 1] + bgr[c * 3 + 2]);
+                break;
+            default:
+                assert(0);
+            }
+            float select[9] = { 0 };
+            switch (param.format())
+            {
+            case ImageFormatTypeGray:
+                select[0] = 0.114f, select[1] = 0.587f, select[2] = 0.299f;
+                break;
+            case ImageFormatTypeBgr:
+                select[0] = select[4] = select[8] = 1.0f;
+                break;
+            case ImageFormatTypeRgb:
+                select[2] = select[4] = select[6] = 1.0f;
+                break;
+            default:
+                assert(0);
+            }
+            for (size_t c = 0; c < _channels; ++c)
+            {
+                float mean = param.mean().empty() ? 0.0f : param.mean()[std::min(c, param.mean().size() - 1)];
+                float scale = param.scale().empty() ? 1.0f : param.scale()[std::min(c, param.scale().size() - 1)];
+                _bias[c] = -mean * scale;
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    float m = 0;
+                    for (size_t j = 0; j < 3; ++j)
+                        m += select[c * 3 + j] * bgr[j * 3 + k];
+                    _matrix[c * 3 + k] = m * scale;
+                }
+                for (size_t j = 0; j < 3; ++j)
+                    _bias[c] += select[c * 3 + j] * offset[j] * scale;
+            }
+        }
+    };
+}
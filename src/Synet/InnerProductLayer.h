@@ -27,6 +27,7 @@
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
 #include "Synet/Math.h"
+#include "Synet/Sparse.h"
 
 namespace Synet
 {
@@ -39,6 +40,7 @@ namespace Synet
 
         InnerProductLayer(const LayerParam & param)
             : Base(param)
+            , _sparseChecked(false)
         {
         }
 
@@ -69,6 +71,15 @@ namespace Synet
                     assert(weight[0].Shape() == Shape({ _N, _K }));
                 if (_biasTerm)
                     assert(weight[1].Shape() == Shape({ _N }));
+                if (!_sparseChecked)
+                {
+                    if (!_transposeB)
+                    {
+                        std::vector<Type> buffer;
+                        _sparse.Init(this->UnpackedWeight(0, buffer), _N, _K);
+                    }
+                    _sparseChecked = true;
+                }
             }
         }
 
@@ -79,13 +90,102 @@ namespace Synet
             dstShape.resize(_axis + 1);
             dstShape[_axis] = _N;
             dst[0]->Reshape(dstShape);
+            _packed = src.size() == 1 && this->Packed(0) && !(_M == 1 && _sparse.Enable());
+            if (_packed)
+            {
+                size_t rows = _transposeB ? _K : _N, size = _transposeB ? _N : _K;
+                _panel = _M == 1 && !_transposeB ? 1 : this->PanelRows(rows, size);
+                buf[0]->Extend({ _panel * (size + _M) });
+            }
+        }
+
+        virtual bool SaveState(std::ostream & os) const
+        {
+            if (!_sparseChecked)
+                return false;
+            _sparse.Save(os);
+            return true;
+        }
+
+        virtual bool LoadState(const uint8_t * data, size_t size)
+        {
+            const typename Base::Tensors & weight = this->Weight();
+            if (!_sparse.Load(data, size) || size != 0 || (_sparse.Enable() && (weight.empty() || weight[0].Count() != 2 || 
+                this->Param().innerProduct().transposeB() || _sparse.Rows() != weight[0].Axis(0) || _sparse.Cols() != weight[0].Axis(1))))
+            {
+                _sparse.Clear();
+                return false;
+            }
+            _sparseChecked = true;
+            return true;
         }
 
     protected:
+        virtual bool PackedWeight(size_t index) const
+        {
+            return index == 0;
+        }
+
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             SYNET_PERF_FUNC();
-            ForwardCpu(src[0]->CpuData(), src.size() > 1 ? src[1]->CpuData() : this->Weight()[0].CpuData(), dst[0]->CpuData());
+            if (_M == 1 && src.size() == 1 && _sparse.Enable())
+            {
+                _sparse.Mul(src[0]->CpuData(), dst[0]->CpuData());
+                if (_biasTerm)
+                    CpuAddBias(this->Weight()[1].CpuData(), _N, _M, dst[0]->CpuData());
+            }
+            else if (_packed)
+                ForwardCpuPacked(src[0]->CpuData(), buf[0]->CpuData(), dst[0]->CpuData());
+            else
+                ForwardCpu(src[0]->CpuData(), src.size() > 1 ? src[1]->CpuData() : this->Weight()[0].CpuData(), dst[0]->CpuData());
+        }
+
+        void ForwardCpuPacked(const T * a, T * buf, T * c)
+        {
+            if (_M == 1 && !_transposeB)
+            {
+                for (size_t i = 0; i < _N; ++i)
+                {
+                    this->UnpackWeight(0, _K*i, _K, buf);
+                    c[i] = CpuDotProduct(a, buf, _K);
+                }
+                if (_biasTerm)
+                    CpuAddBias(this->Weight()[1].CpuData(), _N, _M, c);
+            }
+            else if (!_transposeB)
+            {
+                T * tmp = buf + _panel * _K;
+                for (size_t n = 0; n < _N; n += _panel)
+                {
+                    size_t rows = std::min(_panel, _N - n);
+                    this->UnpackWeight(0, _K * n, _K * rows, buf);
+                    CpuGemm<Type>(_transposeA ? CblasNoTrans : CblasTrans, CblasTrans, _M, rows, _K, Type(1), a, buf, Type(0), tmp);
+                    for (size_t m = 0; m < _M; ++m)
+                        memcpy(c + m * _N + n, tmp + m * rows, rows * sizeof(T));
+                }
+                if (_biasTerm)
+                    CpuAddBias(this->Weight()[1].CpuData(), _N, _M, c);
+            }
+            else
+            {
+                T * tmp = buf + _panel * _N;
+                for (size_t k = 0; k < _K; k += _panel)
+                {
+                    size_t rows = std::min(_panel, _K - k);
+                    this->UnpackWeight(0, _N * k, _N * rows, buf);
+                    const T * slice = a + _M * k;
+                    if (_transposeA)
+                    {
+                        for (size_t m = 0; m < _M; ++m)
+                            memcpy(tmp + m * rows, a + m * _K + k, rows * sizeof(T));
+                        slice = tmp;
+                    }
+                    CpuGemm<Type>(_transposeA ? CblasNoTrans : CblasTrans, CblasNoTrans, _M, _N, rows, Type(1), slice, buf, Type(k ? 1 : 0), c);
+                }
+                if (_biasTerm)
+                    CpuAddBias(this->Weight()[1].CpuData(), _N, _M, c);
+            }
         }
 
         void ForwardCpu(const T * a, const T * b, T * c)
@@ -112,7 +212,8 @@ namespace Synet
     private:
         typedef typename Base::Tensor Tensor;
 
-        size_t _M, _K, _N, _axis;
-        bool _biasTerm, _transposeA, _transposeB;
+        size_t _M, _K, _N, _axis, _panel;
+        bool _biasTerm, _transposeA, _transposeB, _packed, _sparseChecked;
+        SparseMatrix<Type> _sparse;
     };
 }
\ No newline at end of file
@@ -26,88 +26,76 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Parallel.h"
 
 namespace Synet
 {
     namespace Detail
     {
-        template <typename T> void InterpLayerForwardCpu(size_t channels, const T * src, size_t srcH, size_t srcW, size_t cropB, size_t cropE, T * dst, size_t dstH, size_t dstW)
+        template <typename T> struct InterpIndex
         {
-            size_t sizeH = srcH - cropB - cropE;
-            size_t sizeW = srcW - cropB - cropE;
-            src += cropB * srcW + cropB;
-            if (sizeH == dstH && sizeW == dstW)
+            std::vector<size_t> index, offset;
+            std::vector<T> alpha;
+
+            void Init(size_t srcSize, size_t dstSize)
             {
-                for (size_t c = 0; c < channels; ++c)
+                index.resize(dstSize);
+                offset.resize(dstSize);
+                alpha.resize(dstSize);
+                const float ratio = (dstSize > 1) ? static_cast<float>(srcSize - 1) / (dstSize - 1) : 0.f;
+                for (size_t i = 0; i < dstSize; ++i)
                 {
-                    for (size_t h = 0; h < dstH; ++h)
-                        memcpy(dst + h*dstW, src + h*srcW, sizeW*sizeof(T));
-                    src += srcH * srcW;
-                    dst += dstH * dstW;
+                    const float r = ratio * i;
+                    index[i] = (size_t)r;
+                    offset[i] = index[i] < srcSize - 1 ? 1 : 0;
+                    alpha[i] = r - index[i];
                 }
             }
-            else
+        };
+
+        template <typename T> SYNET_INLINE void InterpLayerRowCpu(const T * src, const InterpIndex<T> & x, T * dst)
+        {
+            const size_t * index = x.index.data(), * offset = x.offset.data();
+            const T * alpha = x.alpha.data();
+            for (size_t i = 0, n = x.index.size(); i < n; ++i)
             {
-                const float rheight = (dstH > 1) ? static_cast<float>(sizeH - 1) / (dstH - 1) : 0.f;
-                const float rwidth = (dstW > 1) ? static_cast<float>(sizeW - 1) / (dstW - 1) : 0.f;
-                for (int h2 = 0; h2 < dstH; ++h2) 
-                {
-                    const float h1r = rheight * h2;
-                    const int h1 = (int)h1r;
-                    const int h1p = (h1 < sizeH - 1) ? 1 : 0;
-                    const T h1lambda = h1r - h1;
-                    const T h0lambda = T(1.) - h1lambda;
-                    for (int w2 = 0; w2 < dstW; ++w2) 
-                    {
-                        const float w1r = rwidth * w2;
-                        const int w1 = (int)w1r;
-                        const int w1p = (w1 < sizeW - 1) ? 1 : 0;
-                        const T w1lambda = w1r - w1;
-                        const T w0lambda = T(1.) - w1lambda;
-                        const T * pos1 = & src[h1 * srcW + w1];
-                        T * pos2 = &dst[h2 * dstW + w2];
-                        for (int c = 0; c < channels; ++c) 
-                        {
-                            pos2[0] =
-                                h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p]) +
-                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]);
-                            pos1 += srcH * srcH;
-                            pos2 += dstH * dstW;
-                        }
-                    }
-                }
+                const T * s = src + index[i];
+                dst[i] = s[0] + (s[offset[i]] - s[0]) * alpha[i];
             }
         }
 
-#if defined(SYNET_SIMD_LIBRARY_ENABLE)
-        template <> inline void InterpLayerForwardCpu<float>(size_t channels, const float * src, size_t srcH, size_t srcW, size_t cropB, size_t cropE, float * dst, size_t dstH, size_t dstW)
+        template <typename T> void InterpLayerForwardCpu(const T * src, size_t srcW, const InterpIndex<T> & x, const InterpIndex<T> & y, T * rows, T * dst)
         {
-            size_t sizeH = srcH - cropB - cropE;
-            size_t sizeW = srcW - cropB - cropE;
-            src += cropB * srcW + cropB;
-            if (sizeH == dstH && sizeW == dstW)
+            size_t dstW = x.index.size(), dstH = y.index.size();
+            T * row[2] = { rows, rows + dstW };
+            size_t cached[2] = { size_t(-1), size_t(-1) };
+            for (size_t dy = 0; dy < dstH; ++dy, dst += dstW)
             {
-                for (size_t c = 0; c < channels; ++c)
+                size_t y0 = y.index[dy], y1 = y0 + y.offset[dy];
+                if (cached[0] != y0)
                 {
-                    for (size_t h = 0; h < dstH; ++h)
-                        memcpy(dst + h*dstW, src + h*srcW, sizeW * sizeof(float));
-                    src += srcH * srcW;
-                    dst += dstH * dstW;
+                    if (cached[1] == y0)
+                    {
+                        std::swap(row[0], row[1]);
+                        std::swap(cached[0], cached[1]);
+                    }
+                    else
+                    {
+                        InterpLayerRowCpu(src + y0 * srcW, x, row[0]);
+                        cached[0] = y0;
+                    }
                 }
-            }
-            else
-            {
-                void * resizer = ::SimdResizerInit(sizeW, sizeH, dstW, dstH, 1, ::SimdResizeChannelFloat, ::SimdResizeMethodCaffeInterp);
-                for (size_t c = 0; c < channels; ++c)
+                if (y1 != y0 && cached[1] != y1)
                 {
-                    ::SimdResizerRun(resizer, (uint8_t*)src, srcW * sizeof(float), (uint8_t*)dst, dstW * sizeof(float));
-                    src += srcH * srcW;
-                    dst += dstH * dstW;
+                    InterpLayerRowCpu(src + y1 * srcW, x, row[1]);
+                    cached[1] = y1;
                 }
-                ::SimdRelease(resizer);
+                const T * r0 = row[0], * r1 = y1 != y0 ? row[1] : row[0];
+                T a1 = y.alpha[dy], a0 = T(1) - a1;
+                for (size_t dx = 0; dx < dstW; ++dx)
+                    dst[dx] = r0[dx] * a0 + r1[dx] * a1;
             }
         }
-#endif
     }
 
     template <class T> class InterpLayer : public Synet::Layer<T>
@@ -120,6 +108,17 @@ namespace Synet
         InterpLayer(const LayerParam & param)
             : Base(param)
         {
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            _resizer = NULL;
+#endif
+        }
+
+        virtual ~InterpLayer()
+        {
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            if (_resizer)
+                ::SimdRelease(_resizer);
+#endif
         }
 
         virtual void Setup(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
@@ -173,6 +172,13 @@ namespace Synet
             else
                 assert(0);
             dst[0]->Reshape({ _num, _channels, _dstH, _dstW });
+            _x.Init(srcW, _dstW);
+            _y.Init(srcH, _dstH);
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+            if (_resizer)
+                ::SimdRelease(_resizer);
+            _resizer = ::SimdResizerInit(srcW, srcH, _dstW, _dstH, 1, ::SimdResizeChannelFloat, ::SimdResizeMethodCaffeInterp);
+#endif
         }
 
     protected:
@@ -180,10 +186,50 @@ namespace Synet
         {
             SYNET_PERF_FUNC();
 
-            Detail::InterpLayerForwardCpu(_num * _channels, src[0]->CpuData(), _srcH, _srcW, _cropBeg, _cropEnd, dst[0]->CpuData(), _dstH, _dstW);
+            const Type * pSrc = src[0]->CpuData() + _cropBeg * _srcW + _cropBeg;
+            Type * pDst = dst[0]->CpuData();
+            size_t srcW = _srcW, dstW = _dstW, dstH = _dstH, srcPlane = _srcH * _srcW, dstPlane = _dstH * _dstW;
+            size_t threadNumber = dst[0]->Size() < 0x10000 ? 1 : GetThreadNumber();
+            if (_srcH - _cropBeg - _cropEnd == _dstH && _srcW - _cropBeg - _cropEnd == _dstW)
+            {
+                Parallel(0, _num * _channels, [=](size_t thread, size_t begin, size_t end)
+                {
+                    for (size_t c = begin; c < end; ++c)
+                        for (size_t h = 0; h < dstH; ++h)
+                            CpuCopy(pSrc + c * srcPlane + h * srcW, dstW, pDst + c * dstPlane + h * dstW);
+                }, threadNumber);
+            }
+            else
+            {
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+                threadNumber = 1;
+#endif
+                Parallel(0, _num * _channels, [=](size_t thread, size_t begin, size_t end)
+                {
+                    std::vector<Type> rows(2 * dstW);
+                    for (size_t c = begin; c < end; ++c)
+                        ForwardCpu(pSrc + c * srcPlane, srcW, rows.data(), pDst + c * dstPlane);
+                }, threadNumber);
+            }
+        }
+
+        void ForwardCpu(const Type * src, size_t srcW, Type * rows, Type * dst)
+        {
+            Detail::InterpLayerForwardCpu(src, srcW, _x, _y, rows, dst);
         }
 
     private:
         size_t _num, _channels, _srcH, _srcW, _dstH, _dstW, _cropBeg, _cropEnd;
+        Detail::InterpIndex<Type> _x, _y;
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+        void * _resizer;
+#endif
     };
+
+#if defined(SYNET_SIMD_LIBRARY_ENABLE)
+    template <> inline void InterpLayer<float>::ForwardCpu(const float * src, size_t srcW, float * rows, float * dst)
+    {
+        ::SimdResizerRun(_resizer, (uint8_t*)src, srcW * sizeof(float), (uint8_t*)dst, _dstW * sizeof(float));
+    }
+#endif
 }
\ No newline at end of file
@@ -27,6 +27,7 @@
 #include "Synet/Common.h"
 #include "Synet/Tensor.h"
 #include "Synet/Params.h"
+#include "Synet/Half.h"
 
 namespace Synet
 {
@@ -42,8 +43,14 @@ namespace Synet
             : _param(param)
         {
             _weight.resize(_param.weight().size());
+            _half.resize(_weight.size());
             for (size_t i = 0; i < _weight.size(); ++i)
-                _weight[i].Reshape(_param.weight()[i].dim());
+            {
+                if (IsHalf(_param.weight()[i].type()))
+                    _weight[i].SetShape(_param.weight()[i].dim());
+                else
+                    _weight[i].Reshape(_param.weight()[i].dim());
+            }
         }
 
         virtual ~Layer()
@@ -69,32 +76,136 @@ namespace Synet
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst) = 0;
 
-        bool Load(const void * & data, size_t & size)
+        virtual bool Const() const
+        {
+            return false;
+        }
+
+        bool Load(const void * & data, size_t & size, bool share = false)
         {
             for (size_t i = 0; i < _weight.size(); ++i)
             {
-                size_t requred = _weight[i].Size() * sizeof(Type);
+                size_t requred = WeightSize(i);
                 if (requred > size)
                     return false;
-                ::memcpy(_weight[i].CpuData(), data, requred);
+                LoadWeight(i, data, share);
                 (char*&)data += requred;
                 size -= requred;
             }
             return true;
         }
 
+        size_t WeightSize(size_t index) const
+        {
+            return _weight[index].Size(0) * (IsHalf(_param.weight()[index].type()) ? sizeof(uint16_t) : sizeof(Type));
+        }
+
+        void LoadWeight(size_t index, const void * data, bool share = false)
+        {
+            if (IsHalf(_param.weight()[index].type()))
+            {
+                _half[index].reset(new Halfs(_weight[index].Size(0)));
+                ::memcpy(_half[index]->data(), data, _half[index]->size() * sizeof(uint16_t));
+                if (!PackedWeight(index))
+                    UnpackWeight(index);
+            }
+            else
+            {
+                if (share && size_t(data) % sizeof(Type) == 0)
+                    _weight[index].Share((const Type*)data, _weight[index].Shape());
+                else
+                    ::memcpy(_weight[index].CpuData(), data, _weight[index].Size() * sizeof(Type));
+            }
+        }
+
+        void ShareWeight(const Layer & layer)
+        {
+            assert(layer._weight.size() == _weight.size());
+            for (size_t i = 0; i < _weight.size(); ++i)
+            {
+                _half[i] = layer._half[i];
+                if (!Packed(i))
+                    _weight[i].Share(layer._weight[i].CpuData(), layer._weight[i].Shape());
+            }
+        }
+
+        virtual bool SaveState(std::ostream & os) const
+        {
+            return false;
+        }
+
+        virtual bool LoadState(const uint8_t * data, size_t size)
+        {
+            return false;
+        }
+
         bool Load(std::istream & is)
         {
             for (size_t i = 0; i < _weight.size(); ++i)
-                is.read((char*)_weight[i].CpuData(), _weight[i].Size() * sizeof(T));
+            {
+                TensorType type = _param.weight()[i].type();
+                if (IsHalf(type))
+                {
+                    _half[i].reset(new Halfs(_weight[i].Size(0)));
+                    if (!is.read((char*)_half[i]->data(), _half[i]->size() * sizeof(uint16_t)))
+                        return false;
+                    if (!PackedWeight(i))
+                        UnpackWeight(i);
+                }
+                else
+                {
+                    if (!is.read((char*)_weight[i].CpuData(), _weight[i].Size() * sizeof(T)))
+                        return false;
+                }
+            }
             return true;
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst) = 0;
 
+        virtual bool PackedWeight(size_t) const
+        {
+            return false;
+        }
+
+        bool Packed(size_t index) const
+        {
+            return _half[index] && _half[index]->size() != 0;
+        }
+
+        static size_t PanelRows(size_t rows, size_t rowSize)
+        {
+            return std::max<size_t>(std::min<size_t>(SYNET_HALF_PANEL_SIZE / (rowSize * sizeof(Type)), rows), 1);
+        }
+
+        void UnpackWeight(size_t index, size_t offset, size_t size, Type * dst) const
+        {
+            assert(Packed(index) && offset + size <= _half[index]->size());
+            CpuHalfToFloat(_half[index]->data() + offset, size, _param.weight()[index].type(), dst);
+        }
+
+        const Type * UnpackedWeight(size_t index, std::vector<Type> & buffer) const
+        {
+            if (!Packed(index))
+                return _weight[index].CpuData();
+            buffer.resize(_half[index]->size());
+            UnpackWeight(index, 0, buffer.size(), buffer.data());
+            return buffer.data();
+        }
+
+        void UnpackWeight(size_t index)
+        {
+            if (!Packed(index))
+                return;
+            _weight[index].Reshape(_weight[index].Shape());
+            UnpackWeight(index, 0, _half[index]->size(), _weight[index].CpuData());
+            _half[index].reset();
+        }
+
     private:
         const LayerParam & _param;
         Tensors _weight;
+        std::vector<std::shared_ptr<Halfs>> _half;
     };
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#ifdef _MSC_VER
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+namespace Synet
+{
+    class MappedFile
+    {
+    public:
+        MappedFile()
+            : _data(NULL)
+            , _size(0)
+#ifdef _MSC_VER
+            , _file(INVALID_HANDLE_VALUE)
+            , _mapping(NULL)
+#endif
+        {
+        }
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        bool Open(const String & path)
+        {
+            Close();
+#ifdef _MSC_VER
+            _file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (_file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+            {
+                Close();
+                return false;
+            }
+            _size = (size_t)size.QuadPart;
+            _mapping = ::CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (_mapping)
+                _data = (const uint8_t*)::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+            int file = ::open(path.c_str(), O_RDONLY);
+            if (file == -1)
+                return false;
+            struct stat info;
+            if (::fstat(file, &info) == 0 && info.st_size > 0)
+            {
+                _size = (size_t)info.st_size;
+                void * data = ::mmap(NULL, _size, PROT_READ, MAP_SHARED, file, 0);
+                if (data != MAP_FAILED)
+                    _data = (const uint8_t*)data;
+            }
+            ::close(file);
+#endif
+            if (_data == NULL)
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        void Close()
+        {
+#ifdef _MSC_VER
+            if (_data)
+                ::UnmapViewOfFile(_data);
+            if (_mapping)
+                ::CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE)
+                ::CloseHandle(_file);
+            _mapping = NULL;
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_data)
+                ::munmap((void*)_data, _size);
+#endif
+            _data = NULL;
+            _size = 0;
+        }
+
+        bool Enable() const
+        {
+            return _data != NULL;
+        }
+
+        const uint8_t * Data() const
+        {
+            return _data;
+        }
+
+        size_t Size() const
+        {
+            return _size;
+        }
+
+        static size_t PageSize()
+        {
+#ifdef _MSC_VER
+            SYSTEM_INFO info;
+            ::GetSystemInfo(&info);
+            return (size_t)info.dwPageSize;
+#else
+            return (size_t)::sysconf(_SC_PAGESIZE);
+#endif
+        }
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile & operator = (const MappedFile &);
+
+        const uint8_t * _data;
+        size_t _size;
+#ifdef _MSC_VER
+        HANDLE _file, _mapping;
+#endif
+    };
+}
@@ -100,6 +100,121 @@ namespace Synet
             y[i] = alpha*x[i] + beta*y[i];
     }
 
+    namespace Detail
+    {
+        SYNET_INLINE int32_t AsInt(float value)
+        {
+            int32_t result;
+            memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        SYNET_INLINE float AsFloat(int32_t value)
+        {
+            float result;
+            memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        SYNET_INLINE float Select(bool condition, float a, float b)
+        {
+            int32_t mask = -int32_t(condition);
+            return AsFloat((AsInt(a) & mask) | (AsInt(b) & ~mask));
+        }
+
+        // Branch-free float approximations which are vectorized by compiler inside of simple loops.
+        // Exp overflows to inf above 88.72 and underflows to 0 below -103.9, NaN is passed through.
+        // Log and Rsqrt expect positive normal argument. Pow follows std::pow for negative base and integer exponent.
+        // Maximal relative error: Exp - 1e-7, Log - 2e-7 (absolute near 1), Rsqrt - 2e-7, Tanh - 3e-7.
+        // With SYNET_FAST_MATH_ENABLE: Exp - 6e-5, Rsqrt - 5e-6.
+
+        SYNET_INLINE float Exp(float value)
+        {
+            int32_t bits = AsInt(value);
+            float x = AsFloat(std::min(bits & 0x7FFFFFFF, 0x42D00000) | (bits & 0x80000000));
+            float t = x * 1.44269504f + 12582912.0f;
+            int32_t n = AsInt(t) - 0x4B400000;
+            float k = t - 12582912.0f;
+            x = x - k * 0.693359375f + k * 2.12194440e-4f;
+#ifdef SYNET_FAST_MATH_ENABLE
+            float p = ((4.16979110e-2f * x + 1.66793633e-1f) * x + 5.00016630e-1f) * x * x + x + 1.0f;
+#else
+            float p = (((((1.9875691500e-4f * x + 1.3981999507e-3f) * x + 8.3334519073e-3f) * x
+                + 4.1665795894e-2f) * x + 1.6666665459e-1f) * x + 5.0000001201e-1f) * x * x + x + 1.0f;
+#endif
+            int32_t h = n >> 1;
+            return Select(value == value, p * AsFloat((h + 127) << 23) * AsFloat((n - h + 127) << 23), value);
+        }
+
+        SYNET_INLINE float Log(float value)
+        {
+            int32_t bits = AsInt(value);
+            int32_t lower = (bits & 0x007FFFFF) < 0x003504F3 ? 1 : 0;
+            int32_t e = ((bits >> 23) & 0xFF) - 126 - lower;
+            float x = AsFloat((bits & 0x007FFFFF) | ((126 + lower) << 23)) - 1.0f;
+            float z = x * x;
+            float p = ((((((((7.0376836292e-2f * x - 1.1514610310e-1f) * x + 1.1676998740e-1f) * x
+                - 1.2420140846e-1f) * x + 1.4249322787e-1f) * x - 1.6668057665e-1f) * x
+                + 2.0000714765e-1f) * x - 2.4999993993e-1f) * x + 3.3333331174e-1f) * x * z;
+            float f = float(e);
+            p += f * -2.12194440e-4f - 0.5f * z;
+            return x + p + f * 0.693359375f;
+        }
+
+        SYNET_INLINE float Pow(float value, float exponent, bool integer, bool odd)
+        {
+            int32_t sign = odd ? AsInt(value) & 0x80000000 : 0;
+            float result = AsFloat(AsInt(Exp(exponent * Log(AsFloat(AsInt(value) & 0x7FFFFFFF)))) | sign);
+            float zero = AsFloat(AsInt(Select(exponent > 0.0f, 0.0f, std::numeric_limits<float>::infinity())) | sign);
+            return Select(value > 0.0f || (integer && value < 0.0f), result, 
+                Select(value == 0.0f, zero, std::numeric_limits<float>::quiet_NaN()));
+        }
+
+        SYNET_INLINE float Sigmoid(float value)
+        {
+            return 1.0f / (1.0f + Exp(-value));
+        }
+
+        SYNET_INLINE float Tanh(float value)
+        {
+            float z = value * value;
+            float lo = ((((-5.70498872745e-3f * z + 2.06390887954e-2f) * z - 5.37397155531e-2f) * z
+                + 1.33314422036e-1f) * z - 3.33332819422e-1f) * z * value + value;
+            float hi = 1.0f - 2.0f / (Exp(2.0f * value) + 1.0f);
+            return Select(z < 0.390625f, lo, hi);
+        }
+
+        SYNET_INLINE float Rsqrt(float value)
+        {
+            float x = AsFloat(0x5F375A86 - (AsInt(value) >> 1));
+            float h = 0.5f * value;
+            x = x * (1.5f - h * x * x);
+            x = x * (1.5f - h * x * x);
+#ifndef SYNET_FAST_MATH_ENABLE
+            x = x * (1.5f - h * x * x);
+#endif
+            return x;
+        }
+    }
+
+    template <typename T> void CpuExp(const T * src, size_t size, T * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = ::exp(src[i]);
+    }
+
+    template<class T> void CpuRsqrt(const T * src, size_t size, T * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = T(1) / ::sqrt(src[i]);
+    }
+
+    template <typename T> void CpuTanh(const T * src, size_t size, T * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = ::tanh(src[i]);
+    }
+
     template <typename T> void CpuPow(const T * src, size_t size, const T & exp, T * dst)
     {
         for (size_t i = 0; i < size; ++i)
@@ -162,7 +277,25 @@ namespace Synet
         return sum;
     }
 
+    template <> SYNET_INLINE void CpuExp<float>(const float * src, size_t size, float * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = Detail::Exp(src[i]);
+    }
+
+    template <> SYNET_INLINE void CpuRsqrt<float>(const float * src, size_t size, float * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = Detail::Rsqrt(src[i]);
+    }
+
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
+    template <> SYNET_INLINE void CpuTanh<float>(const float * src, size_t size, float * dst)
+    {
+        float slope = 1.0f;
+        ::SimdNeuralTanh(src, size, &slope, dst);
+    }
+
     template <> SYNET_INLINE void CpuAxpy<float>(const float * x, size_t size, const float & alpha, float * y)
     {
         ::SimdNeuralAddVectorMultipliedByValue(x, size, &alpha, y);
@@ -200,5 +333,32 @@ namespace Synet
         ::SimdNeuralProductSum(a, b, size, &sum);
         return sum;
     }
+#else
+    template <> SYNET_INLINE void CpuTanh<float>(const float * src, size_t size, float * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = Detail::Tanh(src[i]);
+    }
+
+    template <> SYNET_INLINE void CpuPow<float>(const float * src, size_t size, const float & exp, float * dst)
+    {
+        float exponent = exp;
+        if (exponent == 0.0f)
+            CpuSet(size, 1.0f, dst);
+        else if (exponent == 2.0f)
+            CpuSqr(src, size, dst);
+        else
+        {
+            bool integer = ::floor(exponent) == exponent, odd = integer && ::fmod(exponent, 2.0f) != 0.0f;
+            for (size_t i = 0; i < size; ++i)
+                dst[i] = Detail::Pow(src[i], exponent, integer, odd);
+        }
+    }
+
+    template <> SYNET_INLINE void CpuSigmoid<float>(const float * src, size_t size, float * dst)
+    {
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = Detail::Sigmoid(src[i]);
+    }
 #endif
 }
\ No newline at end of file
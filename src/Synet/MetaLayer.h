@@ -83,6 +83,11 @@ namespace Synet
             }
         }
 
+        virtual bool Const() const
+        {
+            return true;
+        }
+
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
@@ -593,4 +598,52 @@ namespace Synet
                 assert(0);
         }
     };
+    namespace Detail
+    {
+        SYNET_INLINE bool MetaFoldable(const MetaParam & param)
+        {
+            switch (param.type())
+            {
+            case MetaTypeAdd:
+            case MetaTypeExpandDims:
+            case MetaTypeFill:
+            case MetaTypeGather:
+            case MetaTypeGreater:
+            case MetaTypeMaximum:
+            case MetaTypeMinimum:
+            case MetaTypePack:
+            case MetaTypeRange:
+            case MetaTypeReshape:
+            case MetaTypeShape:
+            case MetaTypeSlice:
+            case MetaTypeStridedSlice:
+            case MetaTypeSub:
+                return true;
+            case MetaTypeCast:
+                return param.alpha().type() == TensorType32i;
+            default:
+                return false;
+            }
+        }
+
+        inline bool MetaEvaluate(const LayerParam & layer, const std::vector<const TensorParam*> & src, TensorParam & dst)
+        {
+            std::vector<Synet::Tensor<float>> tensors(src.size() + 1);
+            std::vector<Synet::Tensor<float>*> srcPtrs, dstPtrs(1, &tensors.back()), bufPtrs;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                if (src[i]->type() != TensorType32i)
+                    return false;
+                tensors[i].Import(*src[i]);
+                srcPtrs.push_back(&tensors[i]);
+            }
+            MetaLayer<float> meta(layer);
+            meta.Setup(srcPtrs, bufPtrs, dstPtrs);
+            meta.Reshape(srcPtrs, bufPtrs, dstPtrs);
+            if (tensors.back().GetType() != TensorType32i)
+                return false;
+            tensors.back().Export(dst);
+            return true;
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,522 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/Tensor.h"
+
+#ifndef SYNET_META_REGISTER_SIZE
+#define SYNET_META_REGISTER_SIZE 8
+#endif
+
+namespace Synet
+{
+    template <class T> class MetaProgram
+    {
+    public:
+        typedef Synet::Tensor<T> Tensor;
+        typedef std::vector<Tensor*> TensorPtrs;
+
+        void Clear()
+        {
+            _code.clear();
+            _args.clear();
+            _registers.clear();
+            _tensors.clear();
+            _index.clear();
+            _inputs.clear();
+            _begin.clear();
+            _end.clear();
+            _owned.clear();
+        }
+
+        void Input(Tensor * tensor)
+        {
+            _inputs.insert(tensor);
+        }
+
+        bool Add(size_t stage, const LayerParam & layer, const TensorPtrs & src, const TensorPtrs & dst)
+        {
+            _begin.resize(stage + 1, _code.size());
+            _end.resize(stage + 1, _code.size());
+            _owned.resize(stage + 1, false);
+            _begin[stage] = _code.size();
+            _owned[stage] = layer.type() == LayerTypeMeta && Compile(layer.meta(), src, dst);
+            _end[stage] = _code.size();
+            return _owned[stage];
+        }
+
+        void Use(Tensor * tensor)
+        {
+            typename IndexMap::const_iterator it = _index.find(tensor);
+            if (it == _index.end() || _inputs.find(tensor) != _inputs.end())
+                return;
+            Register & reg = _registers[it->second];
+            reg.store = tensor;
+            if (reg.constant)
+                Store(reg);
+        }
+
+        SYNET_INLINE bool Owns(size_t stage) const
+        {
+            return stage < _owned.size() && _owned[stage];
+        }
+
+        // Returns false if a value does not fit into the registers or an index is out of range:
+        // the caller then has to fall back to the meta layers.
+        SYNET_INLINE bool Run(size_t stage)
+        {
+            for (size_t i = _begin[stage], end = _end[stage]; i < end; ++i)
+                if (!Execute(_code[i]))
+                    return false;
+            return true;
+        }
+
+        size_t Size() const
+        {
+            return _code.size();
+        }
+
+    private:
+        enum OpCode
+        {
+            OpUnknown,
+            OpConst,
+            OpLoad,
+            OpShapeOf,
+            OpShape,
+            OpAdd,
+            OpCopy,
+            OpExpandDims,
+            OpGather,
+            OpGreater,
+            OpMaximum,
+            OpMinimum,
+            OpPack,
+            OpReshape,
+            OpSlice,
+            OpStridedSlice,
+            OpSub,
+            OpUnpack,
+            OpSize
+        };
+
+        struct Instruction
+        {
+            uint16_t code, count, dst, dsts;
+            uint32_t args, arg;
+        };
+        typedef std::vector<Instruction> Instructions;
+
+        struct Register
+        {
+            int32_t data[SYNET_META_REGISTER_SIZE];
+            size_t shape[SYNET_META_REGISTER_SIZE];
+            size_t size, rank;
+            bool constant, scalar;
+            Tensor * store;
+
+            Register() : size(0), rank(0), constant(false), scalar(false), store(NULL) {}
+        };
+        typedef std::vector<Register> Registers;
+        typedef std::map<const Tensor*, uint16_t> IndexMap;
+
+        Instructions _code;
+        std::vector<uint16_t> _args;
+        Registers _registers;
+        TensorPtrs _tensors;
+        IndexMap _index;
+        std::set<const Tensor*> _inputs;
+        std::vector<size_t> _begin, _end;
+        std::vector<bool> _owned;
+
+        bool Compile(const MetaParam & param, const TensorPtrs & src, const TensorPtrs & dst)
+        {
+            Instruction op;
+            op.count = (uint16_t)src.size();
+            op.dsts = 1;
+            op.arg = 0;
+            switch (param.type())
+            {
+            case MetaTypeAdd: op.code = OpAdd; break;
+            case MetaTypeCast: op.code = param.alpha().type() == TensorType32i ? OpCopy : OpUnknown; break;
+            case MetaTypeConst: op.code = OpConst; break;
+            case MetaTypeExpandDims: op.code = OpExpandDims; break;
+            case MetaTypeGather: op.code = OpGather; break;
+            case MetaTypeGreater: op.code = OpGreater; break;
+            case MetaTypeMaximum: op.code = OpMaximum; break;
+            case MetaTypeMinimum: op.code = OpMinimum; break;
+            case MetaTypePack: op.code = OpPack; break;
+            case MetaTypeReshape: op.code = OpReshape; break;
+            case MetaTypeShape: op.code = OpShape; break;
+            case MetaTypeSlice: op.code = OpSlice; break;
+            case MetaTypeStridedSlice: op.code = OpStridedSlice; break;
+            case MetaTypeSub: op.code = OpSub; break;
+            case MetaTypeUnpack: op.code = OpUnpack, op.dsts = (uint16_t)dst.size(); break;
+            default: op.code = OpUnknown;
+            }
+            static const size_t arity[OpSize] = { 0, 0, 0, 0, 1, 2, 1, 2, 2, 2, 2, 2, 0, 2, 3, 4, 2, 1 };
+            if (op.code == OpUnknown || (arity[op.code] && arity[op.code] != src.size()) || dst.size() != op.dsts || op.dsts > SYNET_META_REGISTER_SIZE)
+                return false;
+            if (op.code == OpConst)
+                return CompileConst(param.alpha(), src, dst[0]);
+            if (op.code == OpPack && (src.empty() || src.size() > SYNET_META_REGISTER_SIZE))
+                return false;
+            if (op.code == OpShape && !Resolvable(src[0]))
+            {
+                op.code = OpShapeOf;
+                op.count = 0;
+                op.arg = (uint32_t)_tensors.size();
+                _tensors.push_back(src[0]);
+            }
+            for (size_t i = 0; i < op.count; ++i)
+                if (!Resolvable(src[i]))
+                    return false;
+            if (op.code == OpPack)
+            {
+                for (size_t i = 0; i < op.count; ++i)
+                {
+                    typename IndexMap::const_iterator it = _index.find(src[i]);
+                    if (it == _index.end() || !_registers[it->second].scalar)
+                        return false;
+                }
+            }
+            bool constant = op.code != OpShapeOf;
+            std::vector<uint16_t> args;
+            for (size_t i = 0; i < op.count; ++i)
+            {
+                args.push_back(Resolve(src[i]));
+                constant = constant && _registers[args.back()].constant;
+            }
+            op.args = (uint32_t)_args.size();
+            _args.insert(_args.end(), args.begin(), args.end());
+            op.dst = (uint16_t)_registers.size();
+            for (size_t i = 0; i < dst.size(); ++i)
+            {
+                _index[dst[i]] = (uint16_t)_registers.size();
+                _registers.push_back(Register());
+                _registers.back().constant = constant;
+                _registers.back().scalar = Scalar(op);
+            }
+            if (constant)
+            {
+                if (!Execute(op))
+                {
+                    for (size_t i = 0; i < dst.size(); ++i)
+                        _index.erase(dst[i]);
+                    _registers.resize(op.dst);
+                    _args.resize(op.args);
+                    return false;
+                }
+                for (size_t i = 0; i < dst.size(); ++i)
+                    _registers[op.dst + i].scalar = _registers[op.dst + i].size == 1;
+            }
+            else
+                _code.push_back(op);
+            return true;
+        }
+
+        bool Scalar(const Instruction & op) const
+        {
+            const uint16_t * args = _args.data() + op.args;
+            switch (op.code)
+            {
+            case OpAdd:
+            case OpGreater:
+            case OpMaximum:
+            case OpMinimum:
+            case OpSub:
+                return _registers[args[0]].scalar && _registers[args[1]].scalar;
+            case OpCopy:
+            case OpExpandDims:
+            case OpReshape:
+                return _registers[args[0]].scalar;
+            case OpGather:
+                return _registers[args[1]].constant && _registers[args[1]].size == 1;
+            case OpSlice:
+                return _registers[args[2]].constant && _registers[args[2]].data[0] == 1;
+            case OpStridedSlice:
+            {
+                const Register & begin = _registers[args[1]], & end = _registers[args[2]], & step = _registers[args[3]];
+                return begin.constant && end.constant && step.constant && step.data[0] > 0 && 
+                    end.data[0] > begin.data[0] && end.data[0] - begin.data[0] <= step.data[0];
+            }
+            case OpUnpack:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool CompileConst(const TensorParam & alpha, const TensorPtrs & src, Tensor * dst)
+        {
+            if (src.size() || alpha.type() != TensorType32i || alpha.shape().size() > SYNET_META_REGISTER_SIZE || alpha.i32().size() > SYNET_META_REGISTER_SIZE)
+                return false;
+            size_t size = 1;
+            for (size_t i = 0; i < alpha.shape().size(); ++i)
+                size *= alpha.shape()[i];
+            if (size != alpha.i32().size())
+                return false;
+            Register reg;
+            reg.constant = true;
+            reg.scalar = size == 1;
+            if (!Reshape(reg, alpha.shape().data(), alpha.shape().size()))
+                return false;
+            for (size_t i = 0; i < reg.size; ++i)
+                reg.data[i] = alpha.i32()[i];
+            _index[dst] = (uint16_t)_registers.size();
+            _registers.push_back(reg);
+            return true;
+        }
+
+        bool Resolvable(const Tensor * tensor) const
+        {
+            return _index.find(tensor) != _index.end() || _inputs.find(tensor) != _inputs.end();
+        }
+
+        uint16_t Resolve(Tensor * tensor)
+        {
+            typename IndexMap::const_iterator it = _index.find(tensor);
+            if (it != _index.end())
+                return it->second;
+            Instruction op;
+            op.code = OpLoad, op.count = 0, op.dsts = 1, op.args = 0;
+            op.dst = (uint16_t)_registers.size();
+            op.arg = (uint32_t)_tensors.size();
+            _tensors.push_back(tensor);
+            _registers.push_back(Register());
+            _code.push_back(op);
+            _index[tensor] = op.dst;
+            return op.dst;
+        }
+
+        static SYNET_INLINE bool Reshape(Register & reg, const size_t * shape, size_t rank)
+        {
+            if (rank > SYNET_META_REGISTER_SIZE)
+                return false;
+            size_t size = 1;
+            for (size_t i = 0; i < rank; ++i)
+            {
+                if (shape[i] > SYNET_META_REGISTER_SIZE || size * shape[i] > SYNET_META_REGISTER_SIZE)
+                    return false;
+                size *= shape[i];
+            }
+            reg.rank = rank;
+            reg.size = size;
+            for (size_t i = 0; i < rank; ++i)
+                reg.shape[i] = shape[i];
+            return true;
+        }
+
+        static SYNET_INLINE bool Assign(const Register & src, Register & dst)
+        {
+            if (!Reshape(dst, src.shape, src.rank))
+                return false;
+            memcpy(dst.data, src.data, src.size * sizeof(int32_t));
+            return true;
+        }
+
+        static SYNET_INLINE bool ShapeOf(const size_t * shape, size_t rank, Register & dst)
+        {
+            static const size_t order4[4] = { 0, 2, 3, 1 }, order2[2] = { 1, 0 };
+            if (!Reshape(dst, &rank, 1))
+                return false;
+            for (size_t i = 0; i < rank; ++i)
+                dst.data[i] = (int32_t)shape[rank == 4 ? order4[i] : (rank == 2 ? order2[i] : i)];
+            return true;
+        }
+
+        static SYNET_INLINE int32_t Binary(uint16_t code, int32_t a, int32_t b)
+        {
+            switch (code)
+            {
+            case OpAdd: return a + b;
+            case OpGreater: return a > b ? 1 : 0;
+            case OpMaximum: return std::max(a, b);
+            case OpMinimum: return std::min(a, b);
+            case OpSub: return a - b;
+            default: assert(0); return 0;
+            }
+        }
+
+        bool Execute(const Instruction & op)
+        {
+            Register & dst = _registers[op.dst];
+            const uint16_t * args = _args.data() + op.args;
+            switch (op.code)
+            {
+            case OpLoad:
+            {
+                const Synet::Tensor<int32_t> & src = _tensors[op.arg]->As32i();
+                if (!Reshape(dst, src.Shape().data(), src.Count()) || dst.size != src.Size())
+                    return false;
+                memcpy(dst.data, src.CpuData(), dst.size * sizeof(int32_t));
+                break;
+            }
+            case OpShapeOf:
+                if (!ShapeOf(_tensors[op.arg]->Shape().data(), _tensors[op.arg]->Count(), dst))
+                    return false;
+                break;
+            case OpShape:
+                if (!ShapeOf(_registers[args[0]].shape, _registers[args[0]].rank, dst))
+                    return false;
+                break;
+            case OpAdd:
+            case OpGreater:
+            case OpMaximum:
+            case OpMinimum:
+            case OpSub:
+            {
+                const Register & a = _registers[args[0]], & b = _registers[args[1]];
+                if (a.size != b.size || !Reshape(dst, a.shape, a.rank))
+                    return false;
+                for (size_t i = 0; i < a.size; ++i)
+                    dst.data[i] = Binary(op.code, a.data[i], b.data[i]);
+                break;
+            }
+            case OpCopy:
+                if (!Assign(_registers[args[0]], dst))
+                    return false;
+                break;
+            case OpExpandDims:
+            {
+                const Register & a = _registers[args[0]];
+                ptrdiff_t axis = _registers[args[1]].data[0];
+                if (axis < 0)
+                    axis += a.rank;
+                if (axis < 0 || size_t(axis) > a.rank || a.rank >= SYNET_META_REGISTER_SIZE || !Assign(a, dst))
+                    return false;
+                for (size_t i = a.rank; i > size_t(axis); --i)
+                    dst.shape[i] = dst.shape[i - 1];
+                dst.shape[axis] = 1;
+                dst.rank++;
+                break;
+            }
+            case OpGather:
+            {
+                const Register & a = _registers[args[0]], & index = _registers[args[1]];
+                for (size_t i = 0; i < index.size; ++i)
+                    if (index.data[i] < 0 || size_t(index.data[i]) >= a.size)
+                        return false;
+                if (!Reshape(dst, index.shape, index.rank))
+                    return false;
+                for (size_t i = 0; i < index.size; ++i)
+                    dst.data[i] = a.data[index.data[i]];
+                break;
+            }
+            case OpPack:
+            {
+                size_t count = op.count;
+                for (size_t i = 0; i < count; ++i)
+                    if (_registers[args[i]].size != 1)
+                        return false;
+                if (!Reshape(dst, &count, 1))
+                    return false;
+                for (size_t i = 0; i < count; ++i)
+                    dst.data[i] = _registers[args[i]].data[0];
+                break;
+            }
+            case OpReshape:
+            {
+                const Register & a = _registers[args[0]], & b = _registers[args[1]];
+                size_t shape[SYNET_META_REGISTER_SIZE], known = 1, unknown = b.size;
+                for (size_t i = 0; i < b.size; ++i)
+                {
+                    shape[i] = b.data[i];
+                    if (b.data[i] == -1)
+                        unknown = i;
+                    else if (b.data[i] < 0)
+                        return false;
+                    else
+                        known *= shape[i];
+                }
+                if (unknown < b.size)
+                {
+                    if (known == 0)
+                        return false;
+                    shape[unknown] = a.size / known;
+                }
+                if (!Reshape(dst, shape, b.size) || dst.size != a.size)
+                    return false;
+                memcpy(dst.data, a.data, a.size * sizeof(int32_t));
+                break;
+            }
+            case OpSlice:
+            {
+                const Register & a = _registers[args[0]];
+                size_t begin = _registers[args[1]].data[0], size = _registers[args[2]].data[0];
+                if (a.rank != 1 || begin > a.size || size > a.size - begin || !Reshape(dst, &size, 1))
+                    return false;
+                memcpy(dst.data, a.data + begin, size * sizeof(int32_t));
+                break;
+            }
+            case OpStridedSlice:
+            {
+                const Register & a = _registers[args[0]];
+                size_t begin = _registers[args[1]].data[0], end = _registers[args[2]].data[0], step = _registers[args[3]].data[0], size = 0;
+                if (a.rank != 1 || _registers[args[3]].data[0] <= 0 || end > a.size)
+                    return false;
+                for (size_t i = begin; i < end; i += step)
+                    dst.data[size++] = a.data[i];
+                Reshape(dst, &size, 1);
+                break;
+            }
+            case OpUnpack:
+            {
+                const Register & a = _registers[args[0]];
+                size_t one = 1;
+                if (a.size != op.dsts)
+                    return false;
+                for (size_t i = 0; i < op.dsts; ++i)
+                {
+                    Reshape(_registers[op.dst + i], &one, 1);
+                    _registers[op.dst + i].data[0] = a.data[i];
+                }
+                break;
+            }
+            default:
+                assert(0);
+                return false;
+            }
+            for (size_t i = 0; i < op.dsts; ++i)
+                if (_registers[op.dst + i].store)
+                    Store(_registers[op.dst + i]);
+            return true;
+        }
+
+        static void Store(const Register & reg)
+        {
+            Synet::Tensor<int32_t> & dst = reg.store->As32i();
+            bool same = dst.GetType() == TensorType32i && dst.Count() == reg.rank;
+            for (size_t i = 0; i < reg.rank && same; ++i)
+                same = dst.Shape()[i] == reg.shape[i];
+            if (!same)
+                dst.Reshape(Shape(reg.shape, reg.shape + reg.rank));
+            memcpy(dst.CpuData(), reg.data, reg.size * sizeof(int32_t));
+        }
+    };
+}
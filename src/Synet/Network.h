@@ -24,6 +24,15 @@
 
 #pragma once
 
+#include "Synet/Image.h"
+#include "Synet/MappedFile.h"
+#include "Synet/Container.h"
+#include "Synet/Cache.h"
+#include "Synet/Optimizer.h"
+#include "Synet/ShapeInference.h"
+#include "Synet/MetaProgram.h"
+#include "Synet/Tiling.h"
+
 #include "Synet/BatchNormLayer.h"
 #include "Synet/BiasLayer.h"
 #include "Synet/CastLayer.h"
@@ -81,6 +90,10 @@ namespace Synet
 
         Network()
             : _empty(true)
+            , _full(true)
+            , _tileCache(0)
+            , _cacheReady(true)
+            , _cacheModel(0)
         {
         }
 
@@ -94,17 +107,56 @@ namespace Synet
             return _param(); 
         }
 
-        bool Load(const String & param, const String & weight)
+        // Static shapes of the loaded model. If the inference could not cover the whole model,
+        // Inference().Error() tells why; Load fails on that only with SYNET_SHAPE_INFERENCE_STRICT.
+        const ShapeInference & Inference() const
+        {
+            return _inference;
+        }
+
+        bool Load(const String & param, const String & weight, bool mapped = false, int optimization = 0)
         {
+            _cacheModel = Detail::FileStamp(param, Hash64(&optimization, sizeof(optimization)));
+            if (weight.size())
+                _cacheModel = Detail::FileStamp(weight, _cacheModel);
+            if (ContainerReader::IsContainer(param))
+                return LoadContainer(param, mapped, optimization);
+
             if (!_param.Load(param))
                 return false;
 
+            Index offset(1, 0);
+            for (size_t i = 0; i < _param().layers().size(); ++i)
+                offset.push_back(offset.back() + Detail::WeightSize<Type>(_param().layers()[i]));
+            Optimizer optimizer(optimization);
+            if (!optimizer.Run(_param()) || !RunInference())
+                return false;
+
             _layers.clear();
+            Index origin;
             for (size_t i = 0; i < _param().layers().size(); ++i)
             {
                 LayerSharedPtr layer(Create(_param().layers()[i]));
                 if (layer)
+                {
                     _layers.push_back(layer);
+                    origin.push_back(optimizer.Origin()[i]);
+                }
+            }
+
+            _mapped.Close();
+            if (mapped && _mapped.Open(weight))
+            {
+                for (size_t i = 0; i < _layers.size(); ++i)
+                {
+                    if (offset[origin[i]] > _mapped.Size())
+                        return false;
+                    const void * data = _mapped.Data() + offset[origin[i]];
+                    size_t size = _mapped.Size() - offset[origin[i]];
+                    if (!_layers[i]->Load(data, size, true))
+                        return false;
+                }
+                return Init();
             }
 
             std::ifstream ifs(weight.c_str(), std::ifstream::binary);
@@ -112,7 +164,7 @@ namespace Synet
                 return false;
             for (size_t i = 0; i < _layers.size(); ++i)
             {
-                if (!_layers[i]->Load(ifs))
+                if (!ifs.seekg(offset[origin[i]]) || !_layers[i]->Load(ifs))
                 {
                     ifs.close();
                     return false;
@@ -123,6 +175,16 @@ namespace Synet
             return Init();
         }
 
+        bool Load(const String & model, int optimization = 0)
+        {
+            return Load(model, String(), true, optimization);
+        }
+
+        void SetCache(const String & path)
+        {
+            _cachePath = path;
+        }
+
         TensorPtrs & Src() 
         { 
             return _src; 
@@ -133,6 +195,29 @@ namespace Synet
             return _dst; 
         }
 
+        bool InitConverter(ImageConverter & converter, size_t width, size_t height, ImageFormatType format, size_t index = 0) const
+        {
+            if (index >= _src.size() || _src[index]->Count() != 4)
+                return false;
+            for (size_t i = 0; i < _input.size(); ++i)
+            {
+                if (_input[i].dst[0] == _src[index] && _input[i].layer->Param().type() == LayerTypeInput)
+                {
+                    const Tensor & src = *_src[index];
+                    return converter.Init(_input[i].layer->Param().input(), width, height, format, src.Axis(1), src.Axis(2), src.Axis(3));
+                }
+            }
+            return false;
+        }
+
+        bool SetInput(const uint8_t * data, size_t width, size_t height, size_t stride, ImageFormatType format, size_t index = 0, size_t batch = 0)
+        {
+            if (!InitConverter(_image, width, height, format, index) || batch >= _src[index]->Axis(0))
+                return false;
+            _image.Convert(data, stride, _src[index]->CpuData({ batch, 0, 0, 0 }));
+            return true;
+        }
+
         LayerPtrs Back() const
         {
             return _back;
@@ -185,15 +270,10 @@ namespace Synet
                 }
             }
 
-            for (size_t i = 0; i < _stages.size(); ++i)
-            {
-                _stages[i].layer->Setup(_stages[i].src, _stages[i].buf, _stages[i].dst);
-                _stages[i].layer->Reshape(_stages[i].src, _stages[i].buf, _stages[i].dst);
-            }
-
             if (dstNames.size())
             {
                 _dst.clear();
+                _back.clear();
                 for (size_t i = 0; i < dstNames.size(); ++i)
                 {
                     bool found = false;
@@ -203,6 +283,8 @@ namespace Synet
                         if (param.name() == dstNames[i])
                         {
                             _dst.push_back(_stages[j].dst[0]);
+                            _back.push_back(_stages[j].layer);
+                            _program.Use(_stages[j].dst[0]);
                             found = true;
                             break;
                         }
@@ -210,6 +292,24 @@ namespace Synet
                     if (!found)
                         return false;
                 }
+                Select();
+            }
+
+            if (!ReshapeStages())
+            {
+                _program.Clear();
+                ReshapeStages();
+            }
+
+            Tile();
+            _modified.assign(_src.size(), false);
+            _pattern.clear();
+            _full = true;
+
+            if (!_cacheReady)
+            {
+                SaveCache();
+                _cacheReady = true;
             }
 
             return true;
@@ -234,11 +334,24 @@ namespace Synet
             SYNET_PERF_FUNC();
             bool ftz = GetFlushToZero();
             SetFlushToZero(true);
-            for (size_t i = 0; i < _stages.size(); ++i)
-                _stages[i].layer->Forward(_stages[i].src, _stages[i].buf, _stages[i].dst);
+            const Stages & stages = Modified();
+            for (size_t i = 0; i < stages.size(); ++i)
+                stages[i].layer->Forward(stages[i].src, stages[i].buf, stages[i].dst);
             SetFlushToZero(ftz);
         }
 
+        void SetTiling(size_t cache = SYNET_TILE_CACHE_SIZE)
+        {
+            _tileCache = cache;
+            Tile();
+        }
+
+        void SetModified(size_t index = 0)
+        {
+            if (index < _modified.size())
+                _modified[index] = true;
+        }
+
 #ifdef SYNET_DEBUG_PRINT_ENABLE
         void DebugPrint(std::ostream & os, bool weight)
         {
@@ -261,46 +374,79 @@ namespace Synet
         }
 #endif
 
+        // Puts Yolo and Region layers into decoding mode (see YoloLayer::SetThreshold): their outputs
+        // keep class probabilities only for cells with objectness above threshold.
+        void SetRegionThreshold(Type threshold)
+        {
+            for (size_t i = 0; i < _layers.size(); ++i)
+            {
+                Layer * layer = _layers[i].get();
+                if (layer->Param().type() == Synet::LayerTypeYolo)
+                    ((YoloLayer<float>*)layer)->SetThreshold(threshold);
+                if (layer->Param().type() == Synet::LayerTypeRegion)
+                    ((RegionLayer<float>*)layer)->SetThreshold(threshold);
+            }
+        }
+
+        // Working buffers of GetRegions. A caller that keeps one per thread and passes it to every
+        // call gets regions without heap allocations once the buffers have grown.
+        struct RegionScratch
+        {
+            Regions candidats, buffer;
+            Ints cells, next;
+            TensorPtrs dst;
+        };
+
         Regions GetRegions(size_t imageW, size_t imageH, Type threshold, Type overlap) const
+        {
+            Regions regions;
+            GetRegions(imageW, imageH, threshold, overlap, regions);
+            return regions;
+        }
+
+        void GetRegions(size_t imageW, size_t imageH, Type threshold, Type overlap, Regions & regions) const
+        {
+            RegionScratch scratch;
+            GetRegions(imageW, imageH, threshold, overlap, scratch, regions);
+        }
+
+        void GetRegions(size_t imageW, size_t imageH, Type threshold, Type overlap, RegionScratch & scratch, Regions & regions) const
         {
             size_t netW = _src[0]->Axis(-1);
             size_t netH = _src[0]->Axis(-2);
-            Regions regions;
+            Regions & candidats = scratch.candidats, & buffer = scratch.buffer;
+            TensorPtrs & dst = scratch.dst;
+            candidats.clear();
             for (size_t i = 0; i < _dst.size(); ++i)
             {
-                TensorPtrs dst(1, _dst[i]);
+                dst.assign(1, _dst[i]);
                 const Layer * layer = _back[i];
-                Regions candidats;
+                buffer.clear();
                 if (layer->Param().type() == Synet::LayerTypeYolo)
-                    ((YoloLayer<float>*)layer)->GetRegions(dst, netW, netH, threshold, candidats);
+                    ((YoloLayer<float>*)layer)->GetRegions(dst, netW, netH, threshold, buffer);
                 if (layer->Param().type() == Synet::LayerTypeRegion)
-                    ((RegionLayer<float>*)layer)->GetRegions(dst, threshold, candidats);
+                    ((RegionLayer<float>*)layer)->GetRegions(dst, threshold, buffer);
                 if (layer->Param().type() == Synet::LayerTypeDetectionOutput)
-                    ((DetectionOutputLayer<float>*)layer)->GetRegions(dst, threshold, candidats);
-                for (size_t j = 0; j < candidats.size(); ++j)
-                {
-                    Region & c = candidats[j];
-                    c.x *= imageW;
-                    c.w *= imageW;
-                    c.y *= imageH;
-                    c.h *= imageH;
-                    bool insert = true;
-                    for (size_t k = 0; k < regions.size(); ++k)
-                    {
-                        Region & r = regions[k];
-                        if (c.id == r.id && RelativeIntersection(c, r) >= overlap)
-                        {
-                            if (c.prob > r.prob)
-                               r = c;
-                            insert = false;
-                            break;
-                        }
-                    }
-                    if (insert)
-                        regions.push_back(c);
-                }
+                    ((DetectionOutputLayer<float>*)layer)->GetRegions(dst, threshold, buffer);
+                candidats.insert(candidats.end(), buffer.begin(), buffer.end());
+            }
+            for (size_t i = 0; i < candidats.size(); ++i)
+            {
+                Region & c = candidats[i];
+                c.x *= imageW;
+                c.w *= imageW;
+                c.y *= imageH;
+                c.h *= imageH;
+            }
+            std::sort(candidats.begin(), candidats.end(), [](const Region & a, const Region & b)
+                { return a.id < b.id || (a.id == b.id && a.prob > b.prob); });
+            regions.clear();
+            for (size_t begin = 0, end = 0; begin < candidats.size(); begin = end)
+            {
+                while (end < candidats.size() && candidats[end].id == candidats[begin].id)
+                    ++end;
+                MergeRegions(candidats.data() + begin, candidats.data() + end, overlap, scratch.cells, scratch.next, regions);
             }
-            return regions;
         }
 
     private:
@@ -325,18 +471,275 @@ namespace Synet
 
         bool _empty;
         NetworkParamHolder _param;
+        ShapeInference _inference;
+        MappedFile _mapped;
         LayerSharedPtrs _layers;
         TensorSharedPtrs _tensors;
 
-        Stages _input, _stages;
+        Stages _input, _stages, _forward;
         TensorPtrs _src, _dst;
+        MetaProgram<T> _program;
+        std::vector<bool> _active, _modified, _pattern;
+        Stages _partial, _tiled;
+        bool _full;
+        size_t _tileCache;
+        std::vector<std::shared_ptr<TiledLayer<T>>> _tiles;
         LayerPtrs _back;
 
+        ImageConverter _image;
+        String _cachePath;
+        PreparedCache::Key _cacheKey;
+        bool _cacheReady;
+        uint64_t _cacheModel;
+
+        bool LoadContainer(const String & path, bool mapped, int optimization)
+        {
+            _layers.clear();
+            if (!_mapped.Open(path))
+                return false;
+            ContainerReader container;
+            if (!container.Open(_mapped.Data(), _mapped.Size()))
+                return false;
+            std::stringstream text(container.Param());
+            if (!_param.Load(text))
+                return false;
+            Optimizer optimizer(optimization);
+            if (!optimizer.Run(_param()) || !RunInference())
+                return false;
+            for (size_t i = 0; i < _param().layers().size(); ++i)
+            {
+                const LayerParam & param = _param().layers()[i];
+                LayerSharedPtr layer(Create(param));
+                if (!layer)
+                    continue;
+                for (size_t j = 0; j < param.weight().size(); ++j)
+                {
+                    size_t size = 0;
+                    const uint8_t * data = container.Find(optimizer.Origin()[i], j, ContainerSectionWeight, param.weight()[j].type(), param.weight()[j].dim(), size);
+                    if (data == NULL || size != layer->WeightSize(j))
+                        return false;
+                    layer->LoadWeight(j, data, mapped);
+                }
+                _layers.push_back(layer);
+            }
+            if (!mapped)
+                _mapped.Close();
+            return Init();
+        }
+
+        bool RunInference()
+        {
+            if (_inference.Run(_param()))
+                return true;
+#ifdef SYNET_SHAPE_INFERENCE_STRICT
+            return false;
+#else
+            return true;
+#endif
+        }
+
+        bool LoadCache()
+        {
+            uint64_t shape = Hash64(NULL, 0);
+            for (size_t i = 0; i < _input.size(); ++i)
+            {
+                const LayerParam & layer = _input[i].layer->Param();
+                if (layer.type() != LayerTypeInput)
+                    continue;
+                for (size_t j = 0; j < layer.input().shape().size(); ++j)
+                {
+                    const Shape & dim = layer.input().shape()[j].dim();
+                    shape = Hash64(dim.data(), dim.size() * sizeof(size_t), shape);
+                }
+            }
+            _cacheKey = PreparedCache::MakeKey(_cacheModel, shape);
+
+            PreparedCache cache;
+            if (!cache.Load(_cachePath, _cacheKey))
+                return false;
+            for (size_t i = 0; i < _layers.size(); ++i)
+            {
+                size_t size = 0;
+                const uint8_t * data = cache.Find(i, size);
+                if (data)
+                    _layers[i]->LoadState(data, size);
+            }
+            return true;
+        }
+
+        bool SaveCache() const
+        {
+            PreparedCache::Records records;
+            for (size_t i = 0; i < _layers.size(); ++i)
+            {
+                std::stringstream state;
+                if (_layers[i]->SaveState(state))
+                    records.push_back(PreparedCache::Record(i, state.str()));
+            }
+            return PreparedCache::Save(_cachePath, _cacheKey, records);
+        }
+
+        bool Overwritten(size_t index) const
+        {
+            const TensorPtrs & dst = _stages[index].dst;
+            for (size_t i = 0; i < _stages.size(); ++i)
+            {
+                if (i == index || _stages[i].layer->Const())
+                    continue;
+                for (size_t j = 0; j < _stages[i].dst.size(); ++j)
+                    for (size_t k = 0; k < dst.size(); ++k)
+                        if (_stages[i].dst[j] == dst[k])
+                            return true;
+            }
+            return false;
+        }
+
+        void Select()
+        {
+            std::set<const Tensor*> needed(_dst.begin(), _dst.end());
+            _active.assign(_stages.size(), false);
+            for (size_t i = _stages.size(); i > 0; --i)
+            {
+                const Stage & stage = _stages[i - 1];
+                for (size_t j = 0; j < stage.dst.size() && !_active[i - 1]; ++j)
+                    _active[i - 1] = needed.find(stage.dst[j]) != needed.end();
+                for (size_t j = 0; j < stage.src.size() && _active[i - 1]; ++j)
+                    needed.insert(stage.src[j]);
+            }
+            _forward.clear();
+            for (size_t i = 0; i < _stages.size(); ++i)
+            {
+                if (_active[i] && (!_stages[i].layer->Const() || Overwritten(i)))
+                    _forward.push_back(_stages[i]);
+            }
+            _pattern.clear();
+            _full = true;
+        }
+
+        const Stages & Modified()
+        {
+            bool any = false, same = _pattern.size() == _modified.size();
+            for (size_t i = 0; i < _modified.size(); ++i)
+            {
+                any = any || _modified[i];
+                same = same && _modified[i] == _pattern[i];
+            }
+            if (_full || !any)
+            {
+                _full = false;
+                _modified.assign(_src.size(), false);
+                return _tileCache ? _tiled : _forward;
+            }
+            if (!same)
+            {
+                std::set<const Tensor*> dirty;
+                for (size_t i = 0; i < _src.size(); ++i)
+                    if (_modified[i])
+                        dirty.insert(_src[i]);
+                _partial.clear();
+                for (size_t i = 0; i < _forward.size(); ++i)
+                {
+                    const Stage & stage = _forward[i];
+                    bool run = false;
+                    for (size_t j = 0; j < stage.src.size() && !run; ++j)
+                        run = dirty.find(stage.src[j]) != dirty.end();
+                    if (!run)
+                        continue;
+                    if (StaleInPlace(stage, dirty))
+                    {
+                        _partial = _forward;
+                        break;
+                    }
+                    _partial.push_back(stage);
+                    dirty.insert(stage.dst.begin(), stage.dst.end());
+                }
+                _pattern = _modified;
+            }
+            _modified.assign(_src.size(), false);
+            return _partial;
+        }
+
+        static bool StaleInPlace(const Stage & stage, const std::set<const Tensor*> & dirty)
+        {
+            for (size_t i = 0; i < stage.dst.size(); ++i)
+                if (dirty.find(stage.dst[i]) == dirty.end() && std::find(stage.src.begin(), stage.src.end(), stage.dst[i]) != stage.src.end())
+                    return true;
+            return false;
+        }
+
+        bool Private(const Tensor * tensor, size_t begin, size_t end) const
+        {
+            for (size_t i = 0; i < _forward.size(); ++i)
+            {
+                if (i >= begin && i < end)
+                    continue;
+                for (size_t j = 0; j < _forward[i].src.size(); ++j)
+                    if (_forward[i].src[j] == tensor)
+                        return false;
+            }
+            return std::find(_dst.begin(), _dst.end(), tensor) == _dst.end();
+        }
+
+        size_t Chain(size_t begin) const
+        {
+            size_t end = begin;
+            bool spatial = false;
+            ReceptiveField field;
+            for (; end < _forward.size(); ++end)
+            {
+                const Stage & stage = _forward[end];
+                if (stage.src.size() != 1 || stage.dst.size() != 1 || stage.src[0]->Count() != 4 || stage.dst[0]->Count() != 4 ||
+                    !ReceptiveField::Get(stage.layer->Param(), field) || stage.dst[0]->Axis(2) != field.Output(stage.src[0]->Axis(2)))
+                    break;
+                if (end == begin ? stage.src[0] == stage.dst[0] : stage.src[0] != _forward[end - 1].dst[0])
+                    break;
+                if (end > begin && stage.src[0] != stage.dst[0] && !Private(stage.src[0], begin, end + 1))
+                    break;
+                spatial = spatial || field.Spatial();
+            }
+            return spatial && end - begin > 1 ? end : begin;
+        }
+
+        void Tile()
+        {
+            _tiles.clear();
+            _tiled.clear();
+            if (_tileCache == 0)
+                return;
+            for (size_t i = 0; i < _forward.size();)
+            {
+                size_t end = Chain(i);
+                if (end > i)
+                {
+                    std::shared_ptr<TiledLayer<T>> tile(new TiledLayer<T>());
+                    typename TiledLayer<T>::LayerPtrs layers;
+                    TensorPtrs tensors(1, _forward[i].src[0]);
+                    for (size_t j = i; j < end; ++j)
+                    {
+                        layers.push_back(_forward[j].layer);
+                        tensors.push_back(_forward[j].dst[0]);
+                    }
+                    if (tile->Init(layers, tensors, _forward[i].buf, _tileCache, Create))
+                    {
+                        Stage stage = _forward[i];
+                        stage.layer = tile.get();
+                        stage.dst = _forward[end - 1].dst;
+                        _tiled.push_back(stage);
+                        _tiles.push_back(tile);
+                        i = end;
+                        continue;
+                    }
+                }
+                _tiled.push_back(_forward[i++]);
+            }
+        }
+
         bool Init()
         {
             _tensors.clear();
             _input.clear();
             _stages.clear();
+            _forward.clear();
             _src.clear();
             _dst.clear();
             _back.clear();
@@ -415,6 +818,20 @@ namespace Synet
                     }
                 }
             }
+            _modified.assign(_src.size(), false);
+            _program.Clear();
+            for (size_t i = 0; i < _input.size(); ++i)
+                if (_input[i].layer->Param().type() == LayerTypeMeta)
+                    _program.Input(_input[i].dst[0]);
+            for (size_t i = 0; i < _stages.size(); ++i)
+                _program.Add(i, _stages[i].layer->Param(), _stages[i].src, _stages[i].dst);
+            for (size_t i = 0; i < _stages.size(); ++i)
+                for (size_t j = 0; j < _stages[i].src.size() && !_program.Owns(i); ++j)
+                    _program.Use(_stages[i].src[j]);
+            for (size_t i = 0; i < _dst.size(); ++i)
+                _program.Use(_dst[i]);
+            Select();
+            _cacheReady = _cachePath.empty() || LoadCache();
             if (!Dynamic())
                 Reshape();
             _empty = false;
@@ -433,6 +850,27 @@ namespace Synet
             return false;
         }
 
+        // Returns false if the meta program can't hold the current shapes. Stages it owns store
+        // only the tensors that other layers read, so the caller clears the program and repeats
+        // the pass with the meta layers themselves.
+        bool ReshapeStages()
+        {
+            for (size_t i = 0; i < _stages.size(); ++i)
+            {
+                if (!_active[i])
+                    continue;
+                if (_program.Owns(i))
+                {
+                    if (!_program.Run(i))
+                        return false;
+                    continue;
+                }
+                _stages[i].layer->Setup(_stages[i].src, _stages[i].buf, _stages[i].dst);
+                _stages[i].layer->Reshape(_stages[i].src, _stages[i].buf, _stages[i].dst);
+            }
+            return true;
+        }
+
         bool Dynamic()
         {
             for (size_t i = 0; i < _param().layers().size(); ++i)
@@ -524,6 +962,50 @@ namespace Synet
         {
             return Intersection(a, b) / Union(a, b);
         }
+
+        static void MergeRegions(const Region * begin, const Region * end, Type overlap, Ints & cells, Ints & next, Regions & regions)
+        {
+            Type minX = begin->x, maxX = minX, minY = begin->y, maxY = minY, maxW = 0, maxH = 0;
+            for (const Region * r = begin; r < end; ++r)
+            {
+                const Region & c = *r;
+                minX = std::min(minX, c.x);
+                maxX = std::max(maxX, c.x);
+                minY = std::min(minY, c.y);
+                maxY = std::max(maxY, c.y);
+                maxW = std::max(maxW, c.w);
+                maxH = std::max(maxH, c.h);
+            }
+            size_t limit = overlap > 0 ? (size_t)::sqrt(double(end - begin)) + 1 : 1;
+            size_t gridW = maxW > 0 ? std::min(size_t((maxX - minX) / maxW) + 1, limit) : 1;
+            size_t gridH = maxH > 0 ? std::min(size_t((maxY - minY) / maxH) + 1, limit) : 1;
+            Type cellW = std::max(maxW, (maxX - minX) / gridW);
+            Type cellH = std::max(maxH, (maxY - minY) / gridH);
+            cells.assign(gridW * gridH, -1);
+            next.clear();
+            size_t first = regions.size();
+            for (const Region * r = begin; r < end; ++r)
+            {
+                const Region & c = *r;
+                size_t cx = cellW > 0 ? std::min(size_t((c.x - minX) / cellW), gridW - 1) : 0;
+                size_t cy = cellH > 0 ? std::min(size_t((c.y - minY) / cellH), gridH - 1) : 0;
+                bool insert = true;
+                for (size_t y = std::max<size_t>(cy, 1) - 1, yEnd = std::min(cy + 2, gridH); y < yEnd && insert; ++y)
+                {
+                    for (size_t x = std::max<size_t>(cx, 1) - 1, xEnd = std::min(cx + 2, gridW); x < xEnd && insert; ++x)
+                    {
+                        for (int k = cells[y * gridW + x]; k >= 0 && insert; k = next[k])
+                            insert = !(RelativeIntersection(c, regions[first + k]) >= overlap);
+                    }
+                }
+                if (insert)
+                {
+                    next.push_back(cells[cy * gridW + cx]);
+                    cells[cy * gridW + cx] = int(regions.size() - first);
+                    regions.push_back(c);
+                }
+            }
+        }
         
         friend class TensorflowToSynet;
     };
@@ -26,6 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Params.h"
+#include "Synet/Container.h"
 
 #if defined(SYNET_OPENCV_ENABLE)
 
@@ -71,6 +72,9 @@ namespace Synet
             if (!ConvertNetwork(xml, bin, holder(), weight))
                 return false;
 
+            if (dstWeightPath.empty())
+                return SaveContainer(holder, weight, dstModelPath);
+
             if (!holder.Save(dstModelPath, false))
                 return false;
 
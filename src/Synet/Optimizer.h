@@ -0,0 +1,479 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/Tensor.h"
+#include "Synet/Half.h"
+#include "Synet/MetaLayer.h"
+#include "Synet/Container.h"
+#include "Synet/MappedFile.h"
+
+namespace Synet
+{
+    namespace Detail
+    {
+        template<class T> SYNET_INLINE size_t WeightSize(const LayerParam & param)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < param.weight().size(); ++i)
+            {
+                size_t count = 1;
+                for (size_t j = 0; j < param.weight()[i].dim().size(); ++j)
+                    count *= param.weight()[i].dim()[j];
+                size += count * (IsHalf(param.weight()[i].type()) ? sizeof(uint16_t) : sizeof(T));
+            }
+            return size;
+        }
+    }
+
+    class Optimizer
+    {
+    public:
+        typedef bool(*Pass)(Optimizer & optimizer);
+        typedef std::vector<LayerType> LayerTypes;
+
+        static const size_t NONE = size_t(-1);
+
+        Optimizer(int level = 1)
+        {
+            if (level >= 1)
+            {
+                AddPass(RemoveStub);
+                AddPass(RemoveReshape);
+            }
+            if (level >= 2)
+                AddPass(FoldConst);
+            if (level >= 1)
+                AddPass(RemoveDead);
+        }
+
+        void AddPass(Pass pass)
+        {
+            _passes.push_back(pass);
+        }
+
+        bool Run(NetworkParam & param)
+        {
+            _param = &param;
+            _origin.resize(param.layers().size());
+            for (size_t i = 0; i < _origin.size(); ++i)
+                _origin[i] = i;
+            for (bool changed = !_passes.empty(); changed;)
+            {
+                changed = false;
+                for (size_t i = 0; i < _passes.size(); ++i)
+                {
+                    Build();
+                    if (_passes[i](*this))
+                    {
+                        Compact();
+                        changed = true;
+                    }
+                }
+            }
+            _param = NULL;
+            return true;
+        }
+
+        template<class T> bool Run(NetworkParam & param, std::vector<Synet::Tensor<T>> & weight)
+        {
+            Index offset(1, 0);
+            for (size_t i = 0; i < param.layers().size(); ++i)
+                offset.push_back(offset.back() + param.layers()[i].weight().size());
+            if (offset.back() != weight.size() || !Run(param))
+                return false;
+            std::vector<Synet::Tensor<T>> optimized;
+            for (size_t i = 0; i < _origin.size(); ++i)
+                for (size_t j = offset[_origin[i]]; j < offset[_origin[i] + 1]; ++j)
+                    optimized.push_back(weight[j]);
+            weight.swap(optimized);
+            return true;
+        }
+
+        const Index & Origin() const
+        {
+            return _origin;
+        }
+
+        size_t Size() const
+        {
+            return _param->layers().size();
+        }
+
+        LayerParam & Layer(size_t index)
+        {
+            return _param->layers()[index];
+        }
+
+        size_t Producer(size_t index, size_t src) const
+        {
+            return _producer[index][src];
+        }
+
+        const Index & Users(size_t index) const
+        {
+            return _users[index];
+        }
+
+        bool Output(size_t index) const
+        {
+            const LayerParam & layer = _param->layers()[index];
+            for (size_t i = 0; i < layer.dst().size(); ++i)
+            {
+                const Strings & dst = _param->dst();
+                if (dst.empty() ? !Used(index, i) : std::find(dst.begin(), dst.end(), layer.dst()[i]) != dst.end())
+                    return true;
+            }
+            return false;
+        }
+
+        bool Match(size_t index, const LayerTypes & pattern, Index & chain) const
+        {
+            chain.clear();
+            for (size_t i = 0; i < pattern.size(); ++i)
+            {
+                if (_removed[index] || _param->layers()[index].type() != pattern[i])
+                    return false;
+                chain.push_back(index);
+                if (i + 1 < pattern.size())
+                {
+                    if (_users[index].size() != 1 || Output(index))
+                        return false;
+                    index = _users[index][0];
+                }
+            }
+            return true;
+        }
+
+        void Remove(size_t index)
+        {
+            _removed[index] = true;
+        }
+
+        bool Bypass(size_t index)
+        {
+            LayerParam & layer = _param->layers()[index];
+            if (layer.src().empty() || layer.dst().size() != 1 || _removed[index])
+                return false;
+            const String & src = layer.src()[0], & dst = layer.dst()[0];
+            if (src != dst)
+            {
+                if (Output(index))
+                    return false;
+                for (size_t i = 0; i < _users[index].size(); ++i)
+                    if (Find(src, _users[index][i]) != _producer[index][0])
+                        return false;
+                for (size_t i = 0; i < _users[index].size(); ++i)
+                {
+                    size_t user = _users[index][i];
+                    Strings & names = _param->layers()[user].src();
+                    for (size_t j = 0; j < names.size(); ++j)
+                        if (_producer[user][j] == index)
+                            names[j] = src;
+                }
+            }
+            _removed[index] = true;
+            return true;
+        }
+
+    private:
+        NetworkParam * _param;
+        std::vector<Pass> _passes;
+        Index _origin;
+        std::vector<Index> _producer, _users;
+        std::vector<bool> _removed;
+
+        void Build()
+        {
+            const std::vector<LayerParam> & layers = _param->layers();
+            _producer.assign(layers.size(), Index());
+            _users.assign(layers.size(), Index());
+            _removed.assign(layers.size(), false);
+            std::map<String, size_t> last;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                for (size_t j = 0; j < layers[i].src().size(); ++j)
+                {
+                    std::map<String, size_t>::const_iterator it = last.find(layers[i].src()[j]);
+                    _producer[i].push_back(it == last.end() ? size_t(NONE) : it->second);
+                    if (it != last.end() && (_users[it->second].empty() || _users[it->second].back() != i))
+                        _users[it->second].push_back(i);
+                }
+                for (size_t j = 0; j < layers[i].dst().size(); ++j)
+                    last[layers[i].dst()[j]] = i;
+            }
+        }
+
+        void Compact()
+        {
+            std::vector<LayerParam> & layers = _param->layers();
+            size_t size = 0;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                if (_removed[i])
+                    continue;
+                if (size != i)
+                {
+                    layers[size] = layers[i];
+                    _origin[size] = _origin[i];
+                }
+                size++;
+            }
+            layers.resize(size);
+            _origin.resize(size);
+        }
+
+        size_t Find(const String & name, size_t before) const
+        {
+            for (size_t i = before; i > 0; --i)
+            {
+                const Strings & dst = _param->layers()[i - 1].dst();
+                if (std::find(dst.begin(), dst.end(), name) != dst.end())
+                    return i - 1;
+            }
+            return NONE;
+        }
+
+        bool Used(size_t index, size_t dst) const
+        {
+            const String & name = _param->layers()[index].dst()[dst];
+            for (size_t i = 0; i < _users[index].size(); ++i)
+            {
+                const LayerParam & user = _param->layers()[_users[index][i]];
+                for (size_t j = 0; j < user.src().size(); ++j)
+                    if (_producer[_users[index][i]][j] == index && user.src()[j] == name)
+                        return true;
+            }
+            return false;
+        }
+
+        static bool IsInput(const LayerParam & layer)
+        {
+            return layer.type() == LayerTypeInput || (layer.type() == LayerTypeMeta && layer.meta().type() == MetaTypeInput);
+        }
+
+        static bool IsConst(const LayerParam & layer)
+        {
+            return layer.type() == LayerTypeMeta && layer.meta().type() == MetaTypeConst && layer.meta().alpha().type() == TensorType32i;
+        }
+
+        static bool RemoveDead(Optimizer & optimizer)
+        {
+            if (optimizer._param->dst().empty())
+                return false;
+            std::vector<bool> live(optimizer.Size(), false);
+            const Strings & dst = optimizer._param->dst();
+            for (size_t i = 0; i < dst.size(); ++i)
+            {
+                size_t index = optimizer.Find(dst[i], optimizer.Size());
+                if (index != NONE)
+                    live[index] = true;
+            }
+            for (size_t i = optimizer.Size(); i > 0; --i)
+            {
+                size_t index = i - 1;
+                const LayerParam & layer = optimizer.Layer(index);
+                if (IsInput(layer))
+                    live[index] = true;
+                if (live[index])
+                {
+                    for (size_t j = 0; j < layer.src().size(); ++j)
+                        if (optimizer.Producer(index, j) != NONE)
+                            live[optimizer.Producer(index, j)] = true;
+                }
+            }
+            bool changed = false;
+            for (size_t i = 0; i < live.size(); ++i)
+            {
+                if (!live[i])
+                {
+                    optimizer.Remove(i);
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        static bool RemoveStub(Optimizer & optimizer)
+        {
+            bool changed = false;
+            for (size_t i = 0; i < optimizer.Size(); ++i)
+            {
+                const LayerParam & layer = optimizer.Layer(i);
+                if ((layer.type() == LayerTypeStub || layer.type() == LayerTypeDropout) && layer.src().size() == 1)
+                    changed = optimizer.Bypass(i) || changed;
+            }
+            return changed;
+        }
+
+        static bool RemoveReshape(Optimizer & optimizer)
+        {
+            bool changed = false;
+            for (size_t i = 0; i < optimizer.Size(); ++i)
+            {
+                const LayerParam & layer = optimizer.Layer(i);
+                if (layer.type() != LayerTypeReshape || layer.src().size() != 1)
+                    continue;
+                const ReshapeParam & reshape = layer.reshape();
+                bool identity = reshape.numAxes() >= 0 && (size_t)reshape.numAxes() == reshape.shape().size();
+                for (size_t j = 0; j < reshape.shape().size() && identity; ++j)
+                    identity = reshape.shape()[j] == 0;
+                Index chain;
+                if (!identity && optimizer.Match(i, LayerTypes({ LayerTypeReshape, LayerTypeReshape }), chain))
+                {
+                    const LayerParam & user = optimizer.Layer(chain[1]);
+                    if (user.type() == LayerTypeReshape && user.src().size() == 1 && user.reshape().axis() == 0 && user.reshape().numAxes() == -1)
+                    {
+                        identity = true;
+                        for (size_t j = 0; j < user.reshape().shape().size() && identity; ++j)
+                            identity = user.reshape().shape()[j] != 0;
+                    }
+                }
+                if (identity)
+                    changed = optimizer.Bypass(i) || changed;
+            }
+            return changed;
+        }
+
+        static bool FoldConst(Optimizer & optimizer)
+        {
+            bool changed = false;
+            std::vector<bool> folded(optimizer.Size(), false);
+            Index inputs;
+            for (size_t i = 0; i < optimizer.Size(); ++i)
+            {
+                LayerParam & layer = optimizer.Layer(i);
+                if (layer.type() != LayerTypeMeta || layer.dst().size() != 1 || layer.src().empty() || !Detail::MetaFoldable(layer.meta()))
+                    continue;
+                bool foldable = true;
+                for (size_t j = 0; j < layer.src().size() && foldable; ++j)
+                    foldable = optimizer.Producer(i, j) != NONE && IsConst(optimizer.Layer(optimizer.Producer(i, j)));
+                if (!foldable)
+                    continue;
+                std::vector<const TensorParam*> src;
+                for (size_t j = 0; j < layer.src().size(); ++j)
+                {
+                    src.push_back(&optimizer.Layer(optimizer.Producer(i, j)).meta().alpha());
+                    inputs.push_back(optimizer.Producer(i, j));
+                }
+                TensorParam value;
+                if (!Detail::MetaEvaluate(layer, src, value))
+                    continue;
+                layer.meta().type() = MetaTypeConst;
+                layer.meta().alpha() = value;
+                layer.src().clear();
+                folded[i] = true;
+                changed = true;
+            }
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                bool unused = true;
+                for (size_t j = 0; j < optimizer.Users(inputs[i]).size() && unused; ++j)
+                    unused = folded[optimizer.Users(inputs[i])[j]];
+                if (unused && (optimizer._param->dst().empty() || !optimizer.Output(inputs[i])))
+                    optimizer.Remove(inputs[i]);
+            }
+            return changed;
+        }
+    };
+
+    namespace Detail
+    {
+        inline bool OptimizeContainer(const String & srcPath, const String & dstPath, int level)
+        {
+            MappedFile mapped;
+            ContainerReader reader;
+            if (!mapped.Open(srcPath) || !reader.Open(mapped.Data(), mapped.Size()))
+                return false;
+            NetworkParamHolder holder;
+            std::stringstream param(reader.Param());
+            if (!holder.Load(param))
+                return false;
+            Optimizer optimizer(level);
+            if (!optimizer.Run(holder()))
+                return false;
+            std::stringstream optimized;
+            if (!holder.Save(optimized, false, true))
+                return false;
+            ContainerWriter writer;
+            if (!writer.Open(dstPath, optimized.str()))
+                return false;
+            const std::vector<LayerParam> & layers = holder().layers();
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                for (size_t j = 0; j < layers[i].weight().size(); ++j)
+                {
+                    const ShapeParam & weight = layers[i].weight()[j];
+                    size_t size = 0;
+                    const uint8_t * data = reader.Find(optimizer.Origin()[i], j, ContainerSectionWeight, weight.type(), weight.dim(), size);
+                    if (data == NULL || !writer.Write(i, j, ContainerSectionWeight, weight.type(), weight.dim(), data, size))
+                        return false;
+                }
+            }
+            return writer.Close();
+        }
+    }
+
+    inline bool OptimizeModel(const String & srcParamPath, const String & srcWeightPath,
+        const String & dstParamPath, const String & dstWeightPath, int level = 2)
+    {
+        if (ContainerReader::IsContainer(srcParamPath))
+            return Detail::OptimizeContainer(srcParamPath, dstParamPath, level);
+
+        NetworkParamHolder holder;
+        if (!holder.Load(srcParamPath))
+            return false;
+
+        std::ifstream ifs(srcWeightPath.c_str(), std::ifstream::binary);
+        if (!ifs.is_open())
+            return false;
+        std::ofstream ofs(dstWeightPath.c_str(), std::ofstream::binary);
+        if (!ofs.is_open())
+            return false;
+
+        Index offset(1, 0);
+        for (size_t i = 0; i < holder().layers().size(); ++i)
+            offset.push_back(offset.back() + Detail::WeightSize<float>(holder().layers()[i]));
+        Optimizer optimizer(level);
+        if (!optimizer.Run(holder()))
+            return false;
+
+        std::vector<char> buffer;
+        for (size_t i = 0; i < optimizer.Origin().size(); ++i)
+        {
+            size_t origin = optimizer.Origin()[i];
+            buffer.resize(offset[origin + 1] - offset[origin]);
+            if (buffer.empty())
+                continue;
+            if (!ifs.seekg(offset[origin]) || !ifs.read(buffer.data(), buffer.size()))
+                return false;
+            ofs.write(buffer.data(), buffer.size());
+        }
+        return holder.Save(dstParamPath, false) && ofs.good();
+    }
+}
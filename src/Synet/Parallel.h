@@ -0,0 +1,55 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#include <thread>
+
+namespace Synet
+{
+    template<class Function> inline void Parallel(size_t begin, size_t end, const Function & function, size_t threadNumber, size_t blockAlign = 1)
+    {
+        assert(begin <= end && blockAlign > 0);
+        size_t blockMax = (end - begin + blockAlign - 1) / blockAlign;
+        threadNumber = std::min(threadNumber, blockMax);
+        if (threadNumber <= 1)
+        {
+            if (begin < end)
+                function(0, begin, end);
+            return;
+        }
+        size_t blockSize = (blockMax + threadNumber - 1) / threadNumber * blockAlign;
+        std::vector<std::thread> threads;
+        threads.reserve(threadNumber - 1);
+        size_t thread = 0, block = begin;
+        for (; thread < threadNumber - 1 && block + blockSize < end; ++thread, block += blockSize)
+            threads.push_back(std::thread(function, thread, block, block + blockSize));
+        function(thread, block, end);
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+    }
+}
@@ -26,9 +26,50 @@
 
 #include "Synet/Common.h"
 #include "Synet/Xml.h"
+#include "Synet/MappedFile.h"
 
 namespace Synet
 {
+    namespace Detail
+    {
+        const char PARAM_BINARY_MAGIC[8] = { 'S', 'Y', 'N', 'E', 'T', 'P', 'R', 'M' };
+
+        SYNET_INLINE void WriteVarint(String & binary, uint64_t value)
+        {
+            for (; value >= 0x80; value >>= 7)
+                binary.push_back(char(value | 0x80));
+            binary.push_back(char(value));
+        }
+
+        SYNET_INLINE bool ReadVarint(const uint8_t * & data, const uint8_t * end, uint64_t & value)
+        {
+            value = 0;
+            for (int shift = 0; data < end && shift < 64; shift += 7)
+            {
+                uint8_t byte = *data++;
+                value |= uint64_t(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        SYNET_INLINE bool ReadBytes(const uint8_t * & data, const uint8_t * end, const uint8_t * & bytes, size_t & size)
+        {
+            uint64_t value;
+            if (!ReadVarint(data, end, value) || value > uint64_t(end - data))
+                return false;
+            bytes = data, size = size_t(value);
+            data += size;
+            return true;
+        }
+
+        SYNET_INLINE bool IsBinaryParam(const uint8_t * data, size_t size)
+        {
+            return size >= sizeof(PARAM_BINARY_MAGIC) && memcmp(data, PARAM_BINARY_MAGIC, sizeof(PARAM_BINARY_MAGIC)) == 0;
+        }
+    }
+
     template<class T> struct Param
     {
         typedef T Type;
@@ -36,7 +77,7 @@ namespace Synet
         SYNET_INLINE const Type & operator () () const { return _value; }
         SYNET_INLINE Type & operator () ()  { return _value; }
 
-        SYNET_INLINE const String & Name() const { return _name; }
+        SYNET_INLINE const char * Name() const { return _name; }
 
         virtual Type Default() const { return T(); }
 
@@ -69,8 +110,15 @@ namespace Synet
             }
         }
 
-        bool Save(std::ostream & os, bool full) const
+        bool Save(std::ostream & os, bool full, bool binary = false) const
         {
+            if (binary)
+            {
+                String buffer(Detail::PARAM_BINARY_MAGIC, sizeof(Detail::PARAM_BINARY_MAGIC));
+                this->Pack(buffer, full);
+                os.write(buffer.data(), buffer.size());
+                return (bool)os;
+            }
             Xml::XmlDocument<char> doc;
             Synet::Xml::XmlNode<char> * xmlDeclaration = doc.AllocateNode(Synet::Xml::NodeDeclaration);
             xmlDeclaration->AppendAttribute(doc.AllocateAttribute("version", "1.0"));
@@ -81,13 +129,13 @@ namespace Synet
             return true;
         }
 
-        bool Save(const String & path, bool full) const
+        bool Save(const String & path, bool full, bool binary = false) const
         {
             bool result = false;
-            std::ofstream ofs(path.c_str());
+            std::ofstream ofs(path.c_str(), binary ? std::ofstream::binary : std::ofstream::out);
             if (ofs.is_open())
             {
-                result = this->Save(ofs, full);
+                result = this->Save(ofs, full, binary);
                 ofs.close();
             }
             return result;
@@ -95,29 +143,27 @@ namespace Synet
 
         bool Load(std::istream & is)
         {
-            Xml::File<char> file(is);
-            Xml::XmlDocument<char> doc;
-            try
-            {
-                doc.Parse<0>(file.Data());
-            }
-            catch (std::exception e)
-            {
-                return false;
-            }
-            return this->Load(&doc);
+            String data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+            if (Detail::IsBinaryParam((const uint8_t*)data.data(), data.size()))
+                return this->Unpack((const uint8_t*)data.data(), data.size());
+            return this->Parse<Xml::ParseNoDataNodes>(&data[0]);
         }
 
         bool Load(const String & path)
         {
-            bool result = false;
-            std::ifstream ifs(path.c_str());
-            if (ifs.is_open())
+            MappedFile mapped;
+            if (mapped.Open(path))
             {
-                result = this->Load(ifs);
-                ifs.close();
+                if (Detail::IsBinaryParam(mapped.Data(), mapped.Size()))
+                    return this->Unpack(mapped.Data(), mapped.Size());
+                if (mapped.Size() % MappedFile::PageSize() != 0 && memchr(mapped.Data(), '&', mapped.Size()) == NULL)
+                    return this->Parse<Xml::ParseNoDataNodes | Xml::ParseNoStringTerminators | Xml::ParseNoEntityTranslation>((char*)mapped.Data());
             }
-            return result;
+            mapped.Close();
+            Xml::File<char> file;
+            if (!file.Open(path.c_str()))
+                return false;
+            return this->Parse<Xml::ParseNoDataNodes>(file.Data());
         }
 
     protected:
@@ -129,11 +175,11 @@ namespace Synet
         };
 
         Mode _mode;
-        String _name;
+        const char * _name;
         size_t _size, _item;
         Type _value;
 
-        Param(Mode mode, const String & name, size_t size, size_t item = 0)
+        Param(Mode mode, const char * name, size_t size, size_t item = 0)
             : _mode(mode)
             , _name(name)
             , _size(size)
@@ -143,8 +189,10 @@ namespace Synet
         
         virtual String ToString() const { return ""; }
         virtual void ToValue(const String & string) {}
+        virtual void ToBinary(String & binary) const {}
+        virtual bool FromBinary(const uint8_t * & data, const uint8_t * end) { return false; }
         virtual void Resize(size_t size) {}
-        SYNET_INLINE String ItemName() const { return "item"; }
+        SYNET_INLINE const char * ItemName() const { return "item"; }
 
         template<typename> friend struct Param;
 
@@ -158,47 +206,90 @@ namespace Synet
         SYNET_INLINE Unknown * VectorNext(const Unknown * param) const { return (Unknown*)((char*)param + this->_item); }
         SYNET_INLINE Unknown * VectorEnd() const { return (*(std::vector<Unknown>*)&_value).data() + (*(std::vector<Unknown>*)&_value).size(); }
 
+        template<int Flags> bool Parse(char * data)
+        {
+            Xml::XmlDocument<char> doc;
+            try
+            {
+                doc.Parse<Flags>(data);
+            }
+            catch (std::exception e)
+            {
+                return false;
+            }
+            return this->Load(&doc);
+        }
+
         bool Load(Xml::XmlNode<char> * xmlParent)
         {
-            Xml::XmlNode<char> * xmlCurrent = xmlParent->FirstNode(this->Name().c_str());
-            if (xmlCurrent)
+            Xml::XmlNode<char> * xmlCurrent = xmlParent->FirstNode(this->Name());
+            return xmlCurrent ? this->LoadNode(xmlCurrent) : true;
+        }
+
+        static SYNET_INLINE bool Is(const char * name, const char * other, size_t size)
+        {
+            return strncmp(name, other, size) == 0 && name[size] == 0;
+        }
+
+        static SYNET_INLINE bool Is(const char * name, const Xml::XmlNode<char> * xmlNode)
+        {
+            return Is(name, xmlNode->Name(), xmlNode->NameSize());
+        }
+
+        Unknown * Find(Unknown * begin, Unknown * cursor, Unknown * end, const char * name, size_t size) const
+        {
+            Unknown * paramChild = cursor;
+            while (paramChild < end && !Is(paramChild->_name, name, size))
+                paramChild = this->StructNext(paramChild);
+            if (paramChild < end)
+                return paramChild;
+            for (paramChild = begin; paramChild < cursor && !Is(paramChild->_name, name, size);)
+                paramChild = this->StructNext(paramChild);
+            return paramChild < cursor ? paramChild : NULL;
+        }
+
+        bool LoadNode(Xml::XmlNode<char> * xmlCurrent)
+        {
+            switch (_mode)
             {
-                switch (_mode)
+            case Value:
+                this->ToValue(String(xmlCurrent->Value(), xmlCurrent->ValueSize()));
+                break;
+            case Struct:
+                this->LoadChildren(xmlCurrent, this->StructBegin(), this->StructEnd());
+                break;
+            case Vector:
+                this->Resize(Xml::CountChildren(xmlCurrent));
+                Xml::XmlNode<char> * xmlItem = xmlCurrent->FirstNode();
+                for (Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
                 {
-                case Value:
-                    this->ToValue(xmlCurrent->Value());
-                    break;
-                case Struct:
-                    for (Unknown * paramChild = this->StructBegin(); paramChild < this->StructEnd(); paramChild = this->StructNext(paramChild))
-                    {
-                        if (!paramChild->Load(xmlCurrent))
-                            return true;
-                    }
-                    break;
-                case Vector:
-                    this->Resize(Xml::CountChildren(xmlCurrent));
-                    Xml::XmlNode<char> * xmlItem = xmlCurrent->FirstNode();
-                    for (Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
-                    {
-                        if (ItemName() != xmlItem->Name())
-                            return false;
-                        const Unknown * paramChildEnd = this->VectorNext(paramItem);
-                        for (Unknown * paramChild = paramItem; paramChild < paramChildEnd; paramChild = this->StructNext(paramChild))
-                        {
-                            if (!paramChild->Load(xmlItem))
-                                return true;
-                        }
-                        xmlItem = xmlItem->NextSibling();
-                    }
-                    break;
+                    if (!Is(ItemName(), xmlItem))
+                        return false;
+                    this->LoadChildren(xmlItem, paramItem, this->VectorNext(paramItem));
+                    xmlItem = xmlItem->NextSibling();
                 }
+                break;
             }
             return true;
         }
 
+        void LoadChildren(Xml::XmlNode<char> * xmlParent, Unknown * begin, Unknown * end)
+        {
+            Unknown * cursor = begin;
+            for (Xml::XmlNode<char> * xmlChild = xmlParent->FirstNode(); xmlChild; xmlChild = xmlChild->NextSibling())
+            {
+                Unknown * paramChild = this->Find(begin, cursor, end, xmlChild->Name(), xmlChild->NameSize());
+                if (paramChild == NULL)
+                    continue;
+                if (!paramChild->LoadNode(xmlChild))
+                    return;
+                cursor = this->StructNext(paramChild);
+            }
+        }
+
         void Save(Xml::XmlDocument<char> & xmlDoc, Xml::XmlNode<char> * xmlParent, bool full) const
         {
-            Xml::XmlNode<char> * xmlCurrent = xmlDoc.AllocateNode(Xml::NodeElement, xmlDoc.AllocateString(this->Name().c_str()));
+            Xml::XmlNode<char> * xmlCurrent = xmlDoc.AllocateNode(Xml::NodeElement, xmlDoc.AllocateString(this->Name()));
             switch (_mode)
             {
             case Value:
@@ -214,7 +305,7 @@ namespace Synet
             case Vector:
                 for (const Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
                 {
-                    Xml::XmlNode<char> * xmlItem = xmlDoc.AllocateNode(Xml::NodeElement, xmlDoc.AllocateString(ItemName().c_str()));
+                    Xml::XmlNode<char> * xmlItem = xmlDoc.AllocateNode(Xml::NodeElement, xmlDoc.AllocateString(ItemName()));
                     const Unknown * paramChildEnd = this->VectorNext(paramItem);
                     for (const Unknown * paramChild = paramItem; paramChild < paramChildEnd; paramChild = this->StructNext(paramChild))
                     {
@@ -227,6 +318,110 @@ namespace Synet
             }
             xmlParent->AppendNode(xmlCurrent);
         }
+
+        void Pack(String & binary, bool full) const
+        {
+            String payload;
+            switch (_mode)
+            {
+            case Value:
+                this->ToBinary(payload);
+                break;
+            case Struct:
+                this->PackChildren(payload, this->StructBegin(), this->StructEnd(), full);
+                break;
+            case Vector:
+            {
+                size_t count = 0;
+                for (const Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                    count++;
+                Detail::WriteVarint(payload, count);
+                String item;
+                for (const Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                {
+                    item.clear();
+                    this->PackChildren(item, paramItem, this->VectorNext(paramItem), full);
+                    Detail::WriteVarint(payload, item.size());
+                    payload += item;
+                }
+                break;
+            }
+            }
+            size_t size = strlen(this->Name());
+            Detail::WriteVarint(binary, size);
+            binary.append(this->Name(), size);
+            Detail::WriteVarint(binary, payload.size());
+            binary += payload;
+        }
+
+        void PackChildren(String & binary, const Unknown * begin, const Unknown * end, bool full) const
+        {
+            for (const Unknown * paramChild = begin; paramChild < end; paramChild = this->StructNext(paramChild))
+            {
+                if (full || paramChild->Changed())
+                    paramChild->Pack(binary, full);
+            }
+        }
+
+        bool Unpack(const uint8_t * data, size_t size)
+        {
+            const uint8_t * end = data + size, * name, * payload;
+            size_t nameSize, payloadSize;
+            data += sizeof(Detail::PARAM_BINARY_MAGIC);
+            if (!Detail::ReadBytes(data, end, name, nameSize) || !Detail::ReadBytes(data, end, payload, payloadSize))
+                return false;
+            if (!Is(this->Name(), (const char*)name, nameSize))
+                return true;
+            return this->UnpackNode(payload, payload + payloadSize);
+        }
+
+        bool UnpackNode(const uint8_t * data, const uint8_t * end)
+        {
+            switch (_mode)
+            {
+            case Value:
+                return this->FromBinary(data, end) && data == end;
+            case Struct:
+                return this->UnpackChildren(data, end, this->StructBegin(), this->StructEnd());
+            case Vector:
+            {
+                uint64_t count;
+                if (!Detail::ReadVarint(data, end, count) || count > uint64_t(end - data))
+                    return false;
+                this->Resize(size_t(count));
+                for (Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                {
+                    const uint8_t * item;
+                    size_t size;
+                    if (!Detail::ReadBytes(data, end, item, size))
+                        return false;
+                    if (!this->UnpackChildren(item, item + size, paramItem, this->VectorNext(paramItem)))
+                        return false;
+                }
+                return data == end;
+            }
+            }
+            return false;
+        }
+
+        bool UnpackChildren(const uint8_t * data, const uint8_t * end, Unknown * begin, Unknown * stop)
+        {
+            Unknown * cursor = begin;
+            while (data < end)
+            {
+                const uint8_t * name, * payload;
+                size_t nameSize, payloadSize;
+                if (!Detail::ReadBytes(data, end, name, nameSize) || !Detail::ReadBytes(data, end, payload, payloadSize))
+                    return false;
+                Unknown * paramChild = this->Find(begin, cursor, stop, (const char*)name, nameSize);
+                if (paramChild == NULL)
+                    continue;
+                if (!paramChild->UnpackNode(payload, payload + payloadSize))
+                    return false;
+                cursor = this->StructNext(paramChild);
+            }
+            return true;
+        }
     };
 
     template<class T> SYNET_INLINE  String ValueToString(const T & value)
@@ -255,6 +450,41 @@ namespace Synet
         ss >> value;
     }
 
+    template<> SYNET_INLINE void StringToValue<bool>(const String & string, bool & value)
+    {
+        value = ::strtol(string.c_str(), NULL, 10) != 0;
+    }
+
+    template<> SYNET_INLINE void StringToValue<int>(const String & string, int & value)
+    {
+        value = (int)::strtol(string.c_str(), NULL, 10);
+    }
+
+    template<> SYNET_INLINE void StringToValue<unsigned int>(const String & string, unsigned int & value)
+    {
+        value = (unsigned int)::strtoul(string.c_str(), NULL, 10);
+    }
+
+    template<> SYNET_INLINE void StringToValue<long>(const String & string, long & value)
+    {
+        value = ::strtol(string.c_str(), NULL, 10);
+    }
+
+    template<> SYNET_INLINE void StringToValue<long long>(const String & string, long long & value)
+    {
+        value = ::strtoll(string.c_str(), NULL, 10);
+    }
+
+    template<> SYNET_INLINE void StringToValue<float>(const String & string, float & value)
+    {
+        value = ::strtof(string.c_str(), NULL);
+    }
+
+    template<> SYNET_INLINE void StringToValue<double>(const String & string, double & value)
+    {
+        value = ::strtod(string.c_str(), NULL);
+    }
+
     template<> SYNET_INLINE void StringToValue<size_t>(const String & string, size_t & value)
     {
         StringToValue(string, (ptrdiff_t&)value);
@@ -262,21 +492,150 @@ namespace Synet
 
     template<class T> SYNET_INLINE void StringToValue(const String & string, std::vector<T> & values)
     {
-        std::stringstream ss(string);
         values.clear();
-        while (!ss.eof())
+        String item;
+        for (const char * data = string.c_str(); *data;)
         {
-            String item;
-            ss >> item;
-            if (item.size())
+            while (*data && ::isspace((unsigned char)*data))
+                data++;
+            const char * beg = data;
+            while (*data && !::isspace((unsigned char)*data))
+                data++;
+            if (data > beg)
             {
                 T value;
+                item.assign(beg, data);
                 StringToValue(item, value);
                 values.push_back(value);
             }
         }
     }
 
+    template<class T> SYNET_INLINE void ValueToBinary(const T & value, String & binary)
+    {
+        String string = ValueToString(value);
+        Detail::WriteVarint(binary, string.size());
+        binary += string;
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<String>(const String & value, String & binary)
+    {
+        Detail::WriteVarint(binary, value.size());
+        binary += value;
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<bool>(const bool & value, String & binary)
+    {
+        binary.push_back(value ? 1 : 0);
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<int>(const int & value, String & binary)
+    {
+        Detail::WriteVarint(binary, (uint64_t(int64_t(value)) << 1) ^ uint64_t(int64_t(value) >> 63));
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<unsigned int>(const unsigned int & value, String & binary)
+    {
+        Detail::WriteVarint(binary, value);
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<size_t>(const size_t & value, String & binary)
+    {
+        Detail::WriteVarint(binary, (uint64_t(value) << 1) ^ uint64_t(int64_t(ptrdiff_t(value)) >> 63));
+    }
+
+    template<> SYNET_INLINE void ValueToBinary<float>(const float & value, String & binary)
+    {
+        binary.append((const char*)&value, sizeof(value));
+    }
+
+    template<class T> SYNET_INLINE void ValueToBinary(const std::vector<T> & values, String & binary)
+    {
+        Detail::WriteVarint(binary, values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+            ValueToBinary<T>(values[i], binary);
+    }
+
+    template<class T> SYNET_INLINE bool BinaryToValue(const uint8_t * & data, const uint8_t * end, T & value)
+    {
+        const uint8_t * bytes;
+        size_t size;
+        if (!Detail::ReadBytes(data, end, bytes, size))
+            return false;
+        StringToValue(String((const char*)bytes, size), value);
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<String>(const uint8_t * & data, const uint8_t * end, String & value)
+    {
+        const uint8_t * bytes;
+        size_t size;
+        if (!Detail::ReadBytes(data, end, bytes, size))
+            return false;
+        value.assign((const char*)bytes, size);
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<bool>(const uint8_t * & data, const uint8_t * end, bool & value)
+    {
+        if (data >= end)
+            return false;
+        value = *data++ != 0;
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<int>(const uint8_t * & data, const uint8_t * end, int & value)
+    {
+        uint64_t zigzag;
+        if (!Detail::ReadVarint(data, end, zigzag))
+            return false;
+        value = int(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<unsigned int>(const uint8_t * & data, const uint8_t * end, unsigned int & value)
+    {
+        uint64_t varint;
+        if (!Detail::ReadVarint(data, end, varint))
+            return false;
+        value = (unsigned int)varint;
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<size_t>(const uint8_t * & data, const uint8_t * end, size_t & value)
+    {
+        uint64_t zigzag;
+        if (!Detail::ReadVarint(data, end, zigzag))
+            return false;
+        value = size_t(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+        return true;
+    }
+
+    template<> SYNET_INLINE bool BinaryToValue<float>(const uint8_t * & data, const uint8_t * end, float & value)
+    {
+        if (size_t(end - data) < sizeof(value))
+            return false;
+        memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return true;
+    }
+
+    template<class T> SYNET_INLINE bool BinaryToValue(const uint8_t * & data, const uint8_t * end, std::vector<T> & values)
+    {
+        uint64_t count;
+        if (!Detail::ReadVarint(data, end, count) || count > uint64_t(end - data))
+            return false;
+        values.resize(size_t(count));
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            T value;
+            if (!BinaryToValue<T>(data, end, value))
+                return false;
+            values[i] = value;
+        }
+        return true;
+    }
+
     SYNET_INLINE String ToLowerCase(const String & src) 
     {
         String dst(src);
@@ -325,6 +684,8 @@ Param_##name() : Base(Base::Value, #name, sizeof(Param_##name)) { this->_value =
 virtual type Default() const { return value; } \
 virtual Synet::String ToString() const { using namespace Synet; return ValueToString((*this)()); } \
 virtual void ToValue(const Synet::String & string) { using namespace Synet; StringToValue(string, this->_value); } \
+virtual void ToBinary(Synet::String & binary) const { using namespace Synet; ValueToBinary((*this)(), binary); } \
+virtual bool FromBinary(const uint8_t * & data, const uint8_t * end) { using namespace Synet; return BinaryToValue(data, end, this->_value); } \
 virtual bool Changed() const { return this->Default() != this->_value; } \
 virtual void Clone(const Param_##name & other) { this->_value = other._value; } \
 } name;
@@ -78,6 +78,13 @@ namespace Synet
         EltwiseOperationTypeMax,
         EltwiseOperationTypeMin);
 
+    SYNET_PARAM_ENUM(ImageFormatType,
+        ImageFormatTypeGray,
+        ImageFormatTypeBgr,
+        ImageFormatTypeBgra,
+        ImageFormatTypeRgb,
+        ImageFormatTypeNv12);
+
     SYNET_PARAM_ENUM(MetaType,
         MetaTypeAdd,
         MetaTypeCast,
@@ -126,7 +133,9 @@ namespace Synet
 
     SYNET_PARAM_ENUM(TensorType,
         TensorType32f,
-        TensorType32i);
+        TensorType32i,
+        TensorType16f,
+        TensorType16b);
 
     SYNET_PARAM_ENUM(UnaryOperationType,
         UnaryOperationTypeAbs,
@@ -156,6 +165,7 @@ namespace Synet
     struct ShapeParam
     {
         SYNET_PARAM_VALUE(Shape, dim, Shape());
+        SYNET_PARAM_VALUE(TensorType, type, TensorTypeUnknown);
     };
 
     struct CastParam
@@ -242,6 +252,10 @@ namespace Synet
     struct InputParam
     {
         SYNET_PARAM_VECTOR(ShapeParam, shape);
+        SYNET_PARAM_VALUE(ImageFormatType, format, ImageFormatTypeBgr);
+        SYNET_PARAM_VALUE(Floats, mean, Floats());
+        SYNET_PARAM_VALUE(Floats, scale, Floats());
+        SYNET_PARAM_VALUE(bool, letterbox, false);
     };
 
     struct InterpParam
@@ -27,11 +27,63 @@
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
 #include "Synet/Math.h"
+#include "Synet/Parallel.h"
+
+#if defined(__SSE__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#include <xmmintrin.h>
+#define SYNET_PERMUTE_SSE
+#endif
 
 namespace Synet
 {
     namespace Detail
     {
+        template <class T> SYNET_INLINE void PermuteTranspose4x4(const T * src, size_t srcStride, T * dst, size_t dstStride)
+        {
+            for (size_t i = 0; i < 4; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    dst[j * dstStride + i] = src[i * srcStride + j];
+        }
+
+#ifdef SYNET_PERMUTE_SSE
+        template <> SYNET_INLINE void PermuteTranspose4x4<float>(const float * src, size_t srcStride, float * dst, size_t dstStride)
+        {
+            __m128 s0 = _mm_loadu_ps(src + 0 * srcStride);
+            __m128 s1 = _mm_loadu_ps(src + 1 * srcStride);
+            __m128 s2 = _mm_loadu_ps(src + 2 * srcStride);
+            __m128 s3 = _mm_loadu_ps(src + 3 * srcStride);
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            _mm_storeu_ps(dst + 0 * dstStride, s0);
+            _mm_storeu_ps(dst + 1 * dstStride, s1);
+            _mm_storeu_ps(dst + 2 * dstStride, s2);
+            _mm_storeu_ps(dst + 3 * dstStride, s3);
+        }
+#endif
+
+        template <class T> void PermuteTranspose(const T * src, size_t srcStride, size_t rows, size_t cols, T * dst, size_t dstStride)
+        {
+            const size_t TILE = 32;
+            for (size_t r0 = 0; r0 < rows; r0 += TILE)
+            {
+                size_t r1 = std::min(r0 + TILE, rows);
+                for (size_t c0 = 0; c0 < cols; c0 += TILE)
+                {
+                    size_t c1 = std::min(c0 + TILE, cols), r = r0;
+                    for (; r + 4 <= r1; r += 4)
+                    {
+                        size_t c = c0;
+                        for (; c + 4 <= c1; c += 4)
+                            PermuteTranspose4x4(src + r * srcStride + c, srcStride, dst + c * dstStride + r, dstStride);
+                        for (; c < c1; ++c)
+                            for (size_t i = r; i < r + 4; ++i)
+                                dst[c * dstStride + i] = src[i * srcStride + c];
+                    }
+                    for (; r < r1; ++r)
+                        for (size_t c = c0; c < c1; ++c)
+                            dst[c * dstStride + r] = src[r * srcStride + c];
+                }
+            }
+        }
     }
 
     template <class T> class PermuteLayer : public Synet::Layer<T>
@@ -49,45 +101,84 @@ namespace Synet
         virtual void Setup(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const PermuteParam & param = this->Param().permute();
-            _permute = false;
             _order = param.order();
-            _count = _order.size();
-            assert(_count >= 2 && _count <= 4);
-            size_t is = 0, os = 0;
-            for (size_t i = 0; i < _order.size(); ++i)
-            {
-                if (_order[i] != i)
-                    _permute = true;
-                is += i;
-                os += _order[i];
-            }
-            assert(is == os);
+            Shape sorted = _order;
+            std::sort(sorted.begin(), sorted.end());
+            for (size_t i = 0; i < sorted.size(); ++i)
+                assert(sorted[i] == i);
         }
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            if (_permute)
+            const Shape & srcShape = src[0]->Shape();
+            assert(srcShape.size() == _order.size());
+            Shape dstShape;
+            for (size_t i = 0; i < _order.size(); ++i)
+                dstShape.push_back(srcShape[_order[i]]);
+
+            Shape first, last;
+            for (size_t i = 0; i < _order.size(); ++i)
             {
-                _srcShape = src[0]->Shape();
-                assert(_srcShape.size() == _count);
-                _dstShape.clear();
-                for (size_t i = 0; i < _count; ++i)
-                    _dstShape.push_back(_srcShape[_order[i]]);
-                _srcStride.resize(_count, 1);
-                _dstStride.resize(_count, 1);
-                Shape dstStride(_count, 1);
-                for (ptrdiff_t i = _count - 2; i >= 0; i--)
+                size_t axis = _order[i];
+                if (srcShape[axis] == 1)
+                    continue;
+                if (last.size() && last.back() + 1 == axis)
+                    last.back() = axis;
+                else
                 {
-                    _srcStride[i] = _srcStride[i + 1] * _srcShape[i + 1];
-                    dstStride[i] = dstStride[i + 1] * _dstShape[i + 1];
+                    first.push_back(axis);
+                    last.push_back(axis);
                 }
-                for (size_t i = 0; i < _count; ++i)
-                    _dstStride[_order[i]] = dstStride[i];
+            }
+            _count = first.size();
+            if (_count < 2)
+            {
+                _mode = ModeShare;
+                dst[0]->ShareAs(*src[0], dstShape);
+                return;
+            }
+
+            Shape sorted = first;
+            std::sort(sorted.begin(), sorted.end());
+            Shape order(_count), shape(_count), srcStride(_count, 1), dstStride(_count, 1);
+            for (size_t i = 0; i < _count; ++i)
+            {
+                order[i] = std::lower_bound(sorted.begin(), sorted.end(), first[i]) - sorted.begin();
+                shape[order[i]] = src[0]->Size(first[i], last[i] + 1);
+            }
+            for (ptrdiff_t i = _count - 2; i >= 0; --i)
+            {
+                srcStride[i] = srcStride[i + 1] * shape[i + 1];
+                dstStride[i] = dstStride[i + 1] * shape[order[i + 1]];
+            }
 
-                dst[0]->Reshape(_dstShape);
+            _outerShape.clear();
+            _outerSrcStride.clear();
+            _outerDstStride.clear();
+            size_t inner = _count - 1;
+            if (order[inner] == inner)
+            {
+                _mode = ModeCopy;
+                _cols = shape[inner];
             }
             else
-                dst[0]->Share(*src[0]);
+            {
+                _mode = ModeTranspose;
+                inner = std::find(order.begin(), order.end(), _count - 1) - order.begin();
+                _rows = shape[order[_count - 1]];
+                _cols = shape[_count - 1];
+                _rowStride = srcStride[order[_count - 1]];
+                _colStride = dstStride[inner];
+            }
+            for (size_t i = 0; i < _count - 1; ++i)
+            {
+                if (i == inner)
+                    continue;
+                _outerShape.push_back(shape[order[i]]);
+                _outerSrcStride.push_back(srcStride[order[i]]);
+                _outerDstStride.push_back(dstStride[i]);
+            }
+            dst[0]->Reshape(dstShape);
         }
 
     protected:
@@ -95,63 +186,88 @@ namespace Synet
         {
             SYNET_PERF_FUNC();
 
-            if (_permute)
+            if (_mode == ModeShare)
+                return;
+            const Type * pSrc = src[0]->CpuData();
+            Type * pDst = dst[0]->CpuData();
+            size_t outer = 1;
+            for (size_t i = 0; i < _outerShape.size(); ++i)
+                outer *= _outerShape[i];
+            size_t threadNumber = src[0]->Size() < 0x10000 ? 1 : GetThreadNumber();
+            if (_mode == ModeCopy)
             {
-                const Type * pSrc = src[0]->CpuData();
-                Type * pDst = dst[0]->CpuData();
-                switch (_count)
+                Parallel(0, outer, [=](size_t thread, size_t begin, size_t end)
                 {
-                case 2:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
-                    {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            size_t srcOffset = i*_srcStride[0] + j*_srcStride[1];
-                            size_t dstOffset = i*_dstStride[0] + j*_dstStride[1];
-                            pDst[dstOffset] = pSrc[srcOffset];
-                        }
-                    }
-                    break;
-                case 3:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
+                    Shape index;
+                    size_t srcOffset, dstOffset;
+                    OuterOffsets(begin, index, srcOffset, dstOffset);
+                    for (size_t o = begin; o < end; ++o)
                     {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            for (size_t k = 0; k < _srcShape[2]; ++k)
-                            {
-                                size_t srcOffset = i*_srcStride[0] + j*_srcStride[1] + k*_srcStride[2];
-                                size_t dstOffset = i*_dstStride[0] + j*_dstStride[1] + k*_dstStride[2];
-                                pDst[dstOffset] = pSrc[srcOffset];
-                            }
-                        }
+                        CpuCopy(pSrc + srcOffset, _cols, pDst + dstOffset);
+                        NextOuter(index, srcOffset, dstOffset);
                     }
-                    break;
-                case 4:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
+                }, threadNumber);
+            }
+            else
+            {
+                const size_t BLOCK = 32;
+                size_t blocks = (_rows + BLOCK - 1) / BLOCK;
+                Parallel(0, outer * blocks, [=](size_t thread, size_t begin, size_t end)
+                {
+                    Shape index;
+                    size_t srcOffset, dstOffset, b = begin % blocks;
+                    OuterOffsets(begin / blocks, index, srcOffset, dstOffset);
+                    for (size_t i = begin; i < end; ++i)
                     {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
+                        size_t r = b * BLOCK;
+                        Detail::PermuteTranspose(pSrc + srcOffset + r * _rowStride, _rowStride, std::min(BLOCK, _rows - r),
+                            _cols, pDst + dstOffset + r, _colStride);
+                        if (++b == blocks)
                         {
-                            for (size_t k = 0; k < _srcShape[2]; ++k)
-                            {
-                                for (size_t l = 0; l < _srcShape[3]; ++l)
-                                {
-                                    size_t srcOffset = i*_srcStride[0] + j*_srcStride[1] + k*_srcStride[2] + l*_srcStride[3];
-                                    size_t dstOffset = i*_dstStride[0] + j*_dstStride[1] + k*_dstStride[2] + l*_dstStride[3];
-                                    pDst[dstOffset] = pSrc[srcOffset];
-                                }
-                            }
+                            b = 0;
+                            NextOuter(index, srcOffset, dstOffset);
                         }
                     }
-                    break;
-                default:
-                    assert(0);
-                }
+                }, threadNumber);
             }
         }
 
     private:
-        bool _permute;
-        size_t _count;
-        Shape _order, _srcShape, _dstShape, _srcStride, _dstStride;
+        void OuterOffsets(size_t outer, Shape & index, size_t & srcOffset, size_t & dstOffset) const
+        {
+            index.resize(_outerShape.size());
+            srcOffset = 0;
+            dstOffset = 0;
+            for (ptrdiff_t i = _outerShape.size() - 1; i >= 0; --i)
+            {
+                index[i] = outer % _outerShape[i];
+                outer /= _outerShape[i];
+                srcOffset += index[i] * _outerSrcStride[i];
+                dstOffset += index[i] * _outerDstStride[i];
+            }
+        }
+
+        SYNET_INLINE void NextOuter(Shape & index, size_t & srcOffset, size_t & dstOffset) const
+        {
+            for (ptrdiff_t i = _outerShape.size() - 1; i >= 0; --i)
+            {
+                srcOffset += _outerSrcStride[i];
+                dstOffset += _outerDstStride[i];
+                if (++index[i] < _outerShape[i])
+                    return;
+                srcOffset -= _outerSrcStride[i] * _outerShape[i];
+                dstOffset -= _outerDstStride[i] * _outerShape[i];
+                index[i] = 0;
+            }
+        }
+
+        enum Mode
+        {
+            ModeShare,
+            ModeCopy,
+            ModeTranspose,
+        } _mode;
+        size_t _count, _rows, _cols, _rowStride, _colStride;
+        Shape _order, _outerShape, _outerSrcStride, _outerDstStride;
     };
 }
\ No newline at end of file
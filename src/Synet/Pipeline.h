@@ -0,0 +1,352 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Network.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+#ifndef SYNET_PIPELINE_SPIN
+#define SYNET_PIPELINE_SPIN 64
+#endif
+
+namespace Synet
+{
+    namespace Detail
+    {
+        template<class T> class SpscQueue
+        {
+        public:
+            SpscQueue()
+                : _head(0)
+                , _tail(0)
+                , _waiting(0)
+            {
+            }
+
+            void Resize(size_t capacity)
+            {
+                _data.resize(capacity + 1);
+                _head.store(0);
+                _tail.store(0);
+            }
+
+            bool Push(const T & value)
+            {
+                size_t tail = _tail.load(std::memory_order_relaxed);
+                size_t next = tail + 1 == _data.size() ? 0 : tail + 1;
+                if (next == _head.load(std::memory_order_acquire))
+                    return false;
+                _data[tail] = value;
+                _tail.store(next, std::memory_order_release);
+                return true;
+            }
+
+            bool Pop(T & value)
+            {
+                size_t head = _head.load(std::memory_order_relaxed);
+                if (head == _tail.load(std::memory_order_acquire))
+                    return false;
+                value = _data[head];
+                _head.store(head + 1 == _data.size() ? 0 : head + 1, std::memory_order_release);
+                return true;
+            }
+
+            void Put(const T & value)
+            {
+                Wait([&]() { return Push(value); });
+                Notify();
+            }
+
+            T Get()
+            {
+                T value;
+                Wait([&]() { return Pop(value); });
+                Notify();
+                return value;
+            }
+
+        private:
+            std::vector<T> _data;
+            std::atomic<size_t> _head;
+            char _pad[64];
+            std::atomic<size_t> _tail;
+            std::atomic<size_t> _waiting;
+            std::mutex _mutex;
+            std::condition_variable _condition;
+
+            // Spins for a short while and then sleeps, so that waiting stages don't take cores from Forward.
+            template<class Try> void Wait(Try attempt)
+            {
+                for (size_t spin = 0; spin < SYNET_PIPELINE_SPIN; ++spin)
+                {
+                    if (attempt())
+                        return;
+                    std::this_thread::yield();
+                }
+                std::unique_lock<std::mutex> lock(_mutex);
+                _waiting.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _condition.wait(lock, attempt);
+                _waiting.fetch_sub(1);
+            }
+
+            void Notify()
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_waiting.load())
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _condition.notify_all();
+                }
+            }
+        };
+
+        SYNET_INLINE double PipelineTime()
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    class FrameSource
+    {
+    public:
+        FrameSource()
+            : _width(0), _height(0), _format(ImageFormatTypeUnknown)
+        {
+        }
+
+        virtual ~FrameSource()
+        {
+        }
+
+        virtual bool Read(uint8_t * dst) = 0;
+
+        size_t Width() const { return _width; }
+        size_t Height() const { return _height; }
+        ImageFormatType Format() const { return _format; }
+
+        size_t Stride() const
+        {
+            switch (_format)
+            {
+            case ImageFormatTypeBgr:
+            case ImageFormatTypeRgb:
+                return 3 * _width;
+            case ImageFormatTypeBgra:
+                return 4 * _width;
+            default:
+                return _width;
+            }
+        }
+
+        size_t Size() const
+        {
+            return _format == ImageFormatTypeNv12 ? _width * _height * 3 / 2 : Stride() * _height;
+        }
+
+    protected:
+        size_t _width, _height;
+        ImageFormatType _format;
+    };
+
+    class RawFrameSource : public FrameSource
+    {
+    public:
+        bool Open(const String & path, size_t width, size_t height, ImageFormatType format)
+        {
+            _ifs.close();
+            _ifs.clear();
+            _ifs.open(path.c_str(), std::ifstream::binary);
+            _width = width;
+            _height = height;
+            _format = format;
+            return _ifs.is_open() && width > 0 && height > 0 && format > ImageFormatTypeUnknown && format < ImageFormatTypeSize;
+        }
+
+        virtual bool Read(uint8_t * dst)
+        {
+            return _ifs.is_open() && _ifs.read((char*)dst, Size()) ? true : false;
+        }
+
+    private:
+        std::ifstream _ifs;
+    };
+
+    template<class T> class Pipeline
+    {
+    public:
+        typedef T Type;
+        typedef Synet::Network<T> Network;
+        typedef typename Network::Tensor Tensor;
+        typedef typename Network::Regions Regions;
+        typedef std::function<void(size_t frame, const Regions & regions)> Callback;
+
+        struct Statistic
+        {
+            size_t frames;
+            double time, latency;
+
+            Statistic() : frames(0), time(0), latency(0) {}
+
+            double Fps() const { return time > 0 ? frames / time : 0; }
+            double Latency() const { return frames ? latency / frames : 0; }
+        };
+
+        Pipeline(Network & network, size_t depth = 2)
+            : _network(network)
+            , _depth(std::max<size_t>(depth, 1))
+        {
+        }
+
+        void SetDepth(size_t depth)
+        {
+            _depth = std::max<size_t>(depth, 1);
+        }
+
+        size_t Depth() const
+        {
+            return _depth;
+        }
+
+        const Statistic & GetStatistic() const
+        {
+            return _statistic;
+        }
+
+        bool Run(FrameSource & source, Type threshold, Type overlap, const Callback & callback)
+        {
+            if (_network.Src().size() != 1 || !_network.InitConverter(_converter, source.Width(), source.Height(), source.Format()))
+                return false;
+            Tensor & src = *_network.Src()[0];
+            _inputs.resize(_depth);
+            _outputs.resize(_depth);
+            _freeInputs.Resize(_depth);
+            _readyInputs.Resize(_depth);
+            _freeOutputs.Resize(_depth);
+            _readyOutputs.Resize(_depth);
+            for (size_t i = 0; i < _depth; ++i)
+            {
+                _inputs[i].image.resize(source.Size());
+                _inputs[i].data.resize(src.Size(1));
+                _freeInputs.Push(i);
+                _freeOutputs.Push(i);
+            }
+            _statistic = Statistic();
+            const size_t stop = size_t(-1);
+            double start = Detail::PipelineTime();
+
+            std::thread preprocess([&]()
+            {
+                for (size_t frame = 0;; ++frame)
+                {
+                    size_t i = _freeInputs.Get();
+                    Input & input = _inputs[i];
+                    input.start = Detail::PipelineTime();
+                    if (!source.Read(input.image.data()))
+                    {
+                        _readyInputs.Put(stop);
+                        break;
+                    }
+                    input.frame = frame;
+                    _converter.Convert(input.image.data(), source.Stride(), input.data.data());
+                    _readyInputs.Put(i);
+                }
+            });
+
+            std::thread postprocess([&]()
+            {
+                for (;;)
+                {
+                    size_t i = _readyOutputs.Get();
+                    if (i == stop)
+                        break;
+                    Output & output = _outputs[i];
+                    callback(output.frame, output.regions);
+                    _statistic.latency += Detail::PipelineTime() - output.start;
+                    _statistic.frames++;
+                    _freeOutputs.Put(i);
+                }
+            });
+
+            for (;;)
+            {
+                size_t i = _readyInputs.Get();
+                if (i == stop)
+                {
+                    _readyOutputs.Put(stop);
+                    break;
+                }
+                size_t frame = _inputs[i].frame;
+                double time = _inputs[i].start;
+                memcpy(src.CpuData(), _inputs[i].data.data(), _inputs[i].data.size() * sizeof(Type));
+                _freeInputs.Put(i);
+                _network.Forward();
+                size_t o = _freeOutputs.Get();
+                Output & output = _outputs[o];
+                _network.GetRegions(source.Width(), source.Height(), threshold, overlap, _scratch, output.regions);
+                output.frame = frame;
+                output.start = time;
+                _readyOutputs.Put(o);
+            }
+
+            preprocess.join();
+            postprocess.join();
+            _statistic.time = Detail::PipelineTime() - start;
+            return true;
+        }
+
+    private:
+        struct Input
+        {
+            std::vector<uint8_t> image;
+            std::vector<Type> data;
+            size_t frame;
+            double start;
+        };
+
+        struct Output
+        {
+            Regions regions;
+            size_t frame;
+            double start;
+        };
+
+        Network & _network;
+        size_t _depth;
+        ImageConverter _converter;
+        typename Network::RegionScratch _scratch;
+        std::vector<Input> _inputs;
+        std::vector<Output> _outputs;
+        Detail::SpscQueue<size_t> _freeInputs, _readyInputs, _freeOutputs, _readyOutputs;
+        Statistic _statistic;
+    };
+}
@@ -27,69 +27,128 @@
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
 #include "Synet/Math.h"
+#include "Synet/Parallel.h"
 
 namespace Synet
 {
     namespace Detail
     {
-        template <class T> void PoolingForwardMaxCpu(const T * src, size_t srcStride, size_t srcX, size_t srcY, size_t kernelY, size_t kernelX, 
-            size_t padY, size_t padX, size_t strideY, size_t strideX, T * dst, size_t dstX, size_t dstY)
+        struct PoolingIndex
         {
-            for (size_t dy = 0; dy < dstY; ++dy)
+            Shape begin, end;
+
+            void Init(size_t srcSize, size_t dstSize, size_t kernel, size_t pad, size_t stride)
+            {
+                begin.resize(dstSize);
+                end.resize(dstSize);
+                for (size_t i = 0; i < dstSize; ++i)
+                {
+                    ptrdiff_t start = ptrdiff_t(i * stride) - ptrdiff_t(pad);
+                    begin[i] = std::max<ptrdiff_t>(0, start);
+                    end[i] = std::min<ptrdiff_t>(start + kernel, srcSize);
+                    end[i] = std::max(begin[i], end[i]);
+                }
+            }
+
+            bool Global(size_t srcSize) const
+            {
+                return begin.size() == 1 && begin[0] == 0 && end[0] == srcSize;
+            }
+        };
+
+        template <class T> T PoolingGlobalMaxCpu(const T * src, size_t size)
+        {
+            T max[8];
+            size_t size8 = size & (~size_t(7)), i = 0;
+            for (size_t j = 0; j < 8; ++j)
+                max[j] = -std::numeric_limits<T>::max();
+            for (; i < size8; i += 8)
+                for (size_t j = 0; j < 8; ++j)
+                    max[j] = std::max(max[j], src[i + j]);
+            for (; i < size; ++i)
+                max[0] = std::max(max[0], src[i]);
+            for (size_t j = 1; j < 8; ++j)
+                max[0] = std::max(max[0], max[j]);
+            return max[0];
+        }
+
+        template <class T> T PoolingGlobalSumCpu(const T * src, size_t size)
+        {
+            T sum[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+            size_t size8 = size & (~size_t(7)), i = 0;
+            for (; i < size8; i += 8)
+                for (size_t j = 0; j < 8; ++j)
+                    sum[j] += src[i + j];
+            for (; i < size; ++i)
+                sum[0] += src[i];
+            for (size_t j = 1; j < 8; ++j)
+                sum[0] += sum[j];
+            return sum[0];
+        }
+
+        template <class T> void PoolingForwardMaxCpu(const T * src, size_t srcX, const PoolingIndex & y, const PoolingIndex & x, T * row, T * dst)
+        {
+            size_t dstY = y.begin.size(), dstX = x.begin.size();
+            for (size_t dy = 0; dy < dstY; ++dy, dst += dstX)
             {
-                size_t yStart = dy * strideY - padY;
-                size_t yEnd = std::min(yStart + kernelY, srcY);
-                yStart = std::max<ptrdiff_t>(0, yStart);
+                CpuSet(srcX, -std::numeric_limits<T>::max(), row);
+                for (size_t sy = y.begin[dy]; sy < y.end[dy]; ++sy)
+                    CpuMax(row, src + sy * srcX, srcX, row);
                 for (size_t dx = 0; dx < dstX; ++dx)
                 {
-                    size_t xStart = dx * strideX - padX;
-                    size_t xEnd = std::min(xStart + kernelX, srcX);
-                    xStart = std::max<ptrdiff_t>(0, xStart);
                     T max = -std::numeric_limits<T>::max();
-                    for (size_t sy = yStart; sy < yEnd; ++sy)
-                        for (size_t sx = xStart; sx < xEnd; ++sx)
-                            max = std::max(max, src[sy * srcStride + sx]);
-                    dst[dy*dstX + dx] = max;
+                    for (size_t sx = x.begin[dx]; sx < x.end[dx]; ++sx)
+                        max = std::max(max, row[sx]);
+                    dst[dx] = max;
+                }
+            }
+        }
+
+        template <class T> void PoolingForwardAverageCpu(const T * src, size_t srcX, const PoolingIndex & y, const PoolingIndex & x, T * row, T * dst)
+        {
+            size_t dstY = y.begin.size(), dstX = x.begin.size();
+            for (size_t dy = 0; dy < dstY; ++dy, dst += dstX)
+            {
+                CpuSet(srcX, T(0), row);
+                for (size_t sy = y.begin[dy]; sy < y.end[dy]; ++sy)
+                    CpuAdd(row, src + sy * srcX, srcX, row);
+                T sizeY = T(y.end[dy] - y.begin[dy]);
+                for (size_t dx = 0; dx < dstX; ++dx)
+                {
+                    T sum = 0;
+                    for (size_t sx = x.begin[dx]; sx < x.end[dx]; ++sx)
+                        sum += row[sx];
+                    dst[dx] = sum / (sizeY * T(x.end[dx] - x.begin[dx]));
                 }
             }
         }
 
+        template <class T> SYNET_INLINE bool PoolingForwardMaxFast(const T * src, size_t srcX, size_t srcY, size_t kernelY, size_t kernelX,
+            size_t padY, size_t padX, size_t strideY, size_t strideX, T * dst, size_t dstX)
+        {
+            return false;
+        }
+
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-        template <> SYNET_INLINE void PoolingForwardMaxCpu<float>(const float * src, size_t srcStride, size_t srcX, size_t srcY, size_t kernelY, size_t kernelX,
-            size_t padY, size_t padX, size_t strideY, size_t strideX, float * dst, size_t dstX, size_t dstY)
+        template <> SYNET_INLINE bool PoolingForwardMaxFast<float>(const float * src, size_t srcX, size_t srcY, size_t kernelY, size_t kernelX,
+            size_t padY, size_t padX, size_t strideY, size_t strideX, float * dst, size_t dstX)
         {
             if (strideY == 1 && strideX == 1 && kernelY == 3 && kernelX == 3 && padY == 1 && padX == 1)
             {
-                ::SimdNeuralPooling1x1Max3x3(src, srcStride, srcX, srcY, dst, dstX);
-                return;
+                ::SimdNeuralPooling1x1Max3x3(src, srcX, srcX, srcY, dst, dstX);
+                return true;
             }
             if (strideY == 2 && strideX == 2 && kernelY == 3 && kernelX == 3 && padY == 0 && padX == 0)
             {
-                ::SimdNeuralPooling2x2Max3x3(src, srcStride, srcX, srcY, dst, dstX);
-                return;
+                ::SimdNeuralPooling2x2Max3x3(src, srcX, srcX, srcY, dst, dstX);
+                return true;
             }
             if (strideY == 2 && strideX == 2 && kernelY == 2 && kernelX == 2 && padY == 0 && padX == 0)
             {
-                ::SimdNeuralPooling2x2Max2x2(src, srcStride, srcX, srcY, dst, dstX);
-                return;
-            }
-            for (size_t dy = 0; dy < dstY; ++dy)
-            {
-                size_t yStart = dy * strideY - padY;
-                size_t yEnd = std::min(yStart + kernelY, srcY);
-                yStart = std::max<ptrdiff_t>(0, yStart);
-                for (size_t dx = 0; dx < dstX; ++dx)
-                {
-                    size_t xStart = dx * strideX - padX;
-                    size_t xEnd = std::min(xStart + kernelX, srcX);
-                    xStart = std::max<ptrdiff_t>(0, xStart);
-                    float max = -std::numeric_limits<float>::max();
-                    for (size_t sy = yStart; sy < yEnd; ++sy)
-                        for (size_t sx = xStart; sx < xEnd; ++sx)
-                            max = std::max(max, src[sy * srcStride + sx]);
-                    dst[dy*dstX + dx] = max;
-                }
+                ::SimdNeuralPooling2x2Max2x2(src, srcX, srcX, srcY, dst, dstX);
+                return true;
             }
+            return false;
         }
 #endif
     }
@@ -202,6 +261,17 @@ namespace Synet
             }
 
             dst[0]->Reshape(Shape({ src[0]->Axis(0), _channels, _dstY, _dstX }));
+
+            size_t srcX = _srcX, srcY = _srcY;
+            if (_method == PoolingMethodTypeMax && _yoloCompatible)
+            {
+                srcX = _dstX*_strideX - _padX - _padW;
+                srcY = _dstY*_strideY - _padY - _padH;
+            }
+            _x.Init(srcX, _dstX, _kernelX, _padX, _strideX);
+            _y.Init(srcY, _dstY, _kernelY, _padY, _strideY);
+            _global = _x.Global(_srcX) && _y.Global(_srcY);
+            _fast = srcX == _srcX && srcY == _srcY && _padY == _padH && _padX == _padW;
         }
 
     protected:
@@ -211,56 +281,18 @@ namespace Synet
 
             const Type * pSrc = src[0]->CpuData();
             Type * pDst = dst[0]->CpuData();
-            size_t num = dst[0]->Axis(0);
-            size_t dstSize = dst[0]->Size();
+            size_t planes = dst[0]->Axis(0) * _channels;
+            size_t threadNumber = src[0]->Size() < 0x10000 ? 1 : GetThreadNumber();
             switch (_method)
             {
             case PoolingMethodTypeMax:
-                CpuSet(dstSize, Type(-FLT_MAX), pDst);
-                for (size_t n = 0; n < num; ++n)
-                {
-                    for (size_t c = 0; c < _channels; ++c)
-                    {
-                        size_t srcX = _srcX, srcY = _srcY;
-                        if (_yoloCompatible)
-                        {
-                            srcX = _dstX*_strideX - _padX - _padW;
-                            srcY = _dstY*_strideY - _padY - _padH;
-                        }
-                        Detail::PoolingForwardMaxCpu(pSrc, _srcX, srcX, srcY, _kernelY, _kernelX, _padY, _padX, _strideY, _strideX, pDst, _dstX, _dstY);
-                        pSrc += _srcX * _srcY;
-                        pDst += _dstX * _dstY;
-                    }
-                }
-                break;
             case PoolingMethodTypeAverage:
-                CpuSet(dstSize, Type(0), pDst);
-                for (size_t n = 0; n < num; ++n)
+                Parallel(0, planes, [=](size_t thread, size_t begin, size_t end)
                 {
-                    for (size_t c = 0; c < _channels; ++c)
-                    {
-                        for (size_t ph = 0; ph < _dstY; ++ph)
-                        {
-                            size_t hStart = ph * _strideY - _padY;
-                            size_t hEnd = std::min(hStart + _kernelY, _srcY);
-                            hStart = std::max<ptrdiff_t>(0, hStart);
-                            for (size_t pw = 0; pw < _dstX; ++pw)
-                            {
-                                size_t wStart = pw * _strideX - _padX;
-                                size_t wEnd = std::min(wStart + _kernelX, _srcX);
-                                wStart = std::max<ptrdiff_t>(0, wStart);
-                                size_t poolSize = (hEnd - hStart) * (wEnd - wStart);
-                                Type sum = 0;
-                                for (size_t h = hStart; h < hEnd; ++h)
-                                    for (size_t w = wStart; w < wEnd; ++w)
-                                        sum += pSrc[h * _srcX + w];
-                                pDst[ph*_dstX + pw] = sum / poolSize;
-                            }
-                        }
-                        pSrc += _srcX * _srcY;
-                        pDst += _dstX * _dstY;
-                    }
-                }
+                    std::vector<Type> row(_global ? 0 : _srcX);
+                    for (size_t c = begin; c < end; ++c)
+                        ForwardCpu(pSrc + c * _srcX * _srcY, row.data(), pDst + c * _dstX * _dstY);
+                }, threadNumber);
                 break;
             case PoolingMethodTypeStochastic:
                 assert(0);
@@ -270,9 +302,29 @@ namespace Synet
             }
         }
 
+        void ForwardCpu(const Type * src, Type * row, Type * dst) const
+        {
+            size_t size = _srcX * _srcY;
+            if (_method == PoolingMethodTypeMax)
+            {
+                if (_global)
+                    dst[0] = Detail::PoolingGlobalMaxCpu(src, size);
+                else if (!(_fast && Detail::PoolingForwardMaxFast(src, _srcX, _srcY, _kernelY, _kernelX, _padY, _padX, _strideY, _strideX, dst, _dstX)))
+                    Detail::PoolingForwardMaxCpu(src, _srcX, _y, _x, row, dst);
+            }
+            else
+            {
+                if (_global)
+                    dst[0] = Detail::PoolingGlobalSumCpu(src, size) / Type(size);
+                else
+                    Detail::PoolingForwardAverageCpu(src, _srcX, _y, _x, row, dst);
+            }
+        }
+
     private:
         PoolingMethodType _method;
-        bool _yoloCompatible;
+        bool _yoloCompatible, _global, _fast;
         size_t _channels, _srcX, _srcY, _kernelX, _kernelY, _dstX, _dstY, _strideX, _strideY, _padX, _padY, _padW, _padH;
+        Detail::PoolingIndex _x, _y;
     };
 }
\ No newline at end of file
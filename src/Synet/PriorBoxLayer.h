@@ -126,10 +126,22 @@ namespace Synet
             shape[1] = 2;
             shape[2] = layerW * layerH * _numPriors * 4;
             dst[0]->Reshape(shape);
+            Generate(src, dst);
+        }
+
+        virtual bool Const() const
+        {
+            return true;
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+            Generate(src, dst);
+        }
+
+    private:
+        void Generate(const TensorPtrs & src, const TensorPtrs & dst)
         {
             SYNET_PERF_FUNC();
 
@@ -217,7 +229,6 @@ namespace Synet
                                 pDst[offset++] = _variance[j];
             }
         }
-    private:
 
         Floats _minSizes, _maxSizes, _aspectRatios, _variance;
         bool _flip, _clip;
@@ -62,6 +62,8 @@ namespace Synet
 
         RegionLayer(const LayerParam & param)
             : Base(param)
+            , _decode(false)
+            , _threshold(0)
         {
         }
 
@@ -84,35 +86,44 @@ namespace Synet
             dst[0]->Reshape(src[0]->Shape());
         }
 
-        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst)
+        // Switches Forward to decoding mode: class softmaxs are computed only for cells whose
+        // objectness is above threshold and are zero in the output for the rest. GetRegions then
+        // must be called with the same or a higher threshold.
+        void SetThreshold(Type threshold)
+        {
+            _decode = true;
+            _threshold = threshold;
+        }
+
+        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst) const
         {
             SYNET_PERF_FUNC();
             dst.clear();
+            if (_decode)
+            {
+                assert(threshold >= _threshold);
+                for (size_t i = 0; i < _regions.size(); ++i)
+                    if (_regions[i].prob > threshold)
+                        dst.push_back(_regions[i]);
+                return;
+            }
             const Type * pPredict = src[0]->CpuData();
             size_t height = src[0]->Axis(2);
             size_t width = src[0]->Axis(3);
-            size_t outputs = src[0]->Size(1);
             for (size_t i = 0; i < width*height; ++i) 
             {
-                size_t row = i / height;
-                size_t col = i % width;
                 for (size_t n = 0; n < _num; ++n) 
                 {
                     size_t index = i*_num + n;
-                    size_t predictIndex = index * (_classes + 5) + 4;
-                    Type scale = pPredict[predictIndex];
+                    Type scale = pPredict[index * (_coords + _classes + 1) + _coords];
                     if (_classfix == -1 && scale < Type(0.5)) 
                         scale = Type(0);
-                    size_t regionIndex = index * (_classes + 5);
                     Region r;
-                    r.x = (col + CpuSigmoid(pPredict[regionIndex + 0])) / width;
-                    r.y = (row + CpuSigmoid(pPredict[regionIndex + 1])) / height;
-                    r.w = ::exp(pPredict[regionIndex + 2]) * _anchors[2 * n] / width;
-                    r.h = ::exp(pPredict[regionIndex + 3]) * _anchors[2 * n + 1] / height;
-                    size_t classIndex = index * (_classes + 5) + 5;
+                    SetRegion(pPredict + index * (_coords + _classes + 1), i, n, width, height, r);
+                    const Type * pClass = pPredict + index * (_coords + _classes + 1) + _coords + 1;
                     for (size_t id = 0; id < _classes; ++id)
                     {
-                        Type prob = scale*pPredict[classIndex + id];
+                        Type prob = scale*pClass[id];
                         if (prob > threshold)
                         {
                             r.prob = prob;
@@ -137,30 +148,44 @@ namespace Synet
             T * pDst = dst[0]->CpuData();
             Detail::FlattenCpu(src[0]->CpuData(), width*height, size*_num, batch, pDst);
 
-
+            _regions.clear();
             for (size_t b = 0; b < batch; ++b) 
             {
                 for (size_t i = 0; i < height*width*_num; ++i)
                 {
-                    size_t index = size*i + b*outputs;
-                    CpuSigmoid(pDst + index + 4, 1, pDst + index + 4);
-                }
-            }
-
-            if (_softmax) 
-            {
-                for (size_t b = 0; b < batch; ++b) 
-                {
-                    for (size_t i = 0; i < height*width*_num; ++i)
+                    T * pCell = pDst + size*i + b*outputs;
+                    pCell[_coords] = CpuSigmoid(pCell[_coords]);
+                    if (_decode && pCell[_coords] <= _threshold)
                     {
-                        size_t index = size*i + b*outputs;
-                        T buffer;
-                        Detail::SoftmaxLayerForwardCpu(pDst + index + 5, _classes, 1, &buffer, pDst + index + 5);
+                        CpuSet(_classes, Type(0), pCell + _coords + 1);
+                        continue;
+                    }
+                    if (_softmax)
+                        Detail::SoftmaxLayerForwardCpu(pCell + _coords + 1, _classes, 1, pCell + _coords + 1);
+                    if (_decode && b == 0)
+                    {
+                        Region r;
+                        SetRegion(pCell, i / _num, i % _num, width, height, r);
+                        for (size_t id = 0; id < _classes; ++id)
+                        {
+                            r.prob = pCell[_coords] * pCell[_coords + 1 + id];
+                            r.id = id;
+                            if (r.prob > _threshold)
+                                _regions.push_back(r);
+                        }
                     }
                 }
             }
         }
 
+        void SetRegion(const Type * cell, size_t i, size_t n, size_t width, size_t height, Region & region) const
+        {
+            region.x = (i % width + CpuSigmoid(cell[0])) / width;
+            region.y = (i / width + CpuSigmoid(cell[1])) / height;
+            region.w = ::exp(cell[2]) * _anchors[2 * n] / width;
+            region.h = ::exp(cell[3]) * _anchors[2 * n + 1] / height;
+        }
+
     private:
         typedef typename Base::Tensor Tensor;
         typedef std::vector<Type> Vector;
@@ -168,5 +193,8 @@ namespace Synet
         size_t _coords, _classes, _num, _classfix;
         bool _softmax;
         Vector _anchors;
+        bool _decode;
+        Type _threshold;
+        Regions _regions;
     };
 }
\ No newline at end of file
@@ -0,0 +1,797 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/MetaLayer.h"
+
+namespace Synet
+{
+    class ShapeInference
+    {
+    public:
+        typedef ptrdiff_t Dim;
+        typedef std::vector<Dim> Dims;
+
+        struct Entry
+        {
+            Dims shape, value;
+            bool ranked, valued;
+
+            Entry() : ranked(false), valued(false) {}
+        };
+        typedef std::vector<Entry> Entries;
+
+        static SYNET_INLINE bool Known(Dim dim)
+        {
+            return dim >= 0;
+        }
+
+        static SYNET_INLINE bool Symbolic(Dim dim)
+        {
+            return dim <= SYMBOL;
+        }
+
+        static bool Known(const Entry & entry)
+        {
+            if (!entry.ranked)
+                return false;
+            for (size_t i = 0; i < entry.shape.size(); ++i)
+                if (!Known(entry.shape[i]))
+                    return false;
+            return true;
+        }
+
+        static Shape ToShape(const Entry & entry)
+        {
+            Shape shape;
+            for (size_t i = 0; i < entry.shape.size(); ++i)
+                shape.push_back(Known(entry.shape[i]) ? size_t(entry.shape[i]) : 0);
+            return shape;
+        }
+
+        bool Run(const NetworkParam & param, const Strings & srcNames = Strings(), const Shapes & srcShapes = Shapes())
+        {
+            _error.clear();
+            _symbols = 0;
+            _layers.assign(param.layers().size(), Entries());
+            _index.clear();
+            for (size_t i = 0; i < param.layers().size(); ++i)
+            {
+                const LayerParam & layer = param.layers()[i];
+                std::vector<const Entry*> src;
+                for (size_t j = 0; j < layer.src().size(); ++j)
+                {
+                    std::map<String, Entry>::const_iterator it = _index.find(layer.src()[j]);
+                    if (it == _index.end())
+                        return Fail(layer, "input '" + layer.src()[j] + "' is not defined");
+                    src.push_back(&it->second);
+                }
+                Entries & dst = _layers[i];
+                dst.resize(layer.dst().size());
+                std::vector<Shapes::const_iterator> given;
+                for (size_t j = 0; j < srcNames.size() && j < srcShapes.size(); ++j)
+                    if (srcNames[j] == layer.name())
+                        given.push_back(srcShapes.begin() + j);
+                if (given.size())
+                {
+                    for (size_t j = 0; j < dst.size(); ++j)
+                        Set(dst[j], *given[0]);
+                }
+                else if (!Infer(layer, src, dst))
+                    return false;
+                for (size_t j = 0; j < dst.size(); ++j)
+                    _index[layer.dst()[j]] = dst[j];
+            }
+            return true;
+        }
+
+        const String & Error() const
+        {
+            return _error;
+        }
+
+        const Entry & Get(const String & name) const
+        {
+            static const Entry empty;
+            std::map<String, Entry>::const_iterator it = _index.find(name);
+            return it == _index.end() ? empty : it->second;
+        }
+
+        const Entries & Layer(size_t index) const
+        {
+            return _layers[index];
+        }
+
+    private:
+        static const Dim SYMBOL = -(Dim(1) << 40);
+
+        String _error;
+        Dim _symbols;
+        std::vector<Entries> _layers;
+        std::map<String, Entry> _index;
+
+        bool Fail(const LayerParam & layer, const String & message)
+        {
+            _error = "Layer '" + layer.name() + "' (" + ValueToString(layer.type()) + "): " + message;
+            return false;
+        }
+
+        Dim Fresh()
+        {
+            return SYMBOL - (++_symbols);
+        }
+
+        Dim Mul(Dim a, Dim b)
+        {
+            if (Known(a) && Known(b))
+                return a * b;
+            if (a == 1)
+                return b;
+            if (b == 1)
+                return a;
+            return Fresh();
+        }
+
+        Dim Div(Dim a, Dim b)
+        {
+            if (Known(a) && Known(b) && b > 0)
+                return a / b;
+            return b == 1 ? a : Fresh();
+        }
+
+        Dim Add(Dim a, Dim b)
+        {
+            if (Known(a) && Known(b))
+                return a + b;
+            return b == 0 ? a : (a == 0 ? b : Fresh());
+        }
+
+        Dim Size(const Dims & shape, size_t begin, size_t end)
+        {
+            Dim size = 1;
+            for (size_t i = begin; i < end && i < shape.size(); ++i)
+                size = Mul(size, shape[i]);
+            return size;
+        }
+
+        static bool Conflict(Dim a, Dim b)
+        {
+            return Known(a) && Known(b) && a != b;
+        }
+
+        static void Set(Entry & entry, const Shape & shape)
+        {
+            entry.ranked = true;
+            entry.shape.assign(shape.begin(), shape.end());
+        }
+
+        static bool Axis(ptrdiff_t axis, size_t rank, size_t & index)
+        {
+            index = axis < 0 ? size_t(axis + (ptrdiff_t)rank) : size_t(axis);
+            return index < rank;
+        }
+
+        static String ToString(const Dims & dims)
+        {
+            std::stringstream ss;
+            ss << "{";
+            for (size_t i = 0; i < dims.size(); ++i)
+            {
+                ss << (i ? " " : "");
+                if (Known(dims[i]))
+                    ss << dims[i];
+                else
+                    ss << "?";
+            }
+            ss << "}";
+            return ss.str();
+        }
+
+        bool Same(const LayerParam & layer, const Entry & a, const Entry & b, const char * what)
+        {
+            if (!a.ranked || !b.ranked)
+                return true;
+            bool conflict = a.shape.size() != b.shape.size();
+            for (size_t i = 0; i < a.shape.size() && !conflict; ++i)
+                conflict = Conflict(a.shape[i], b.shape[i]);
+            return conflict ? Fail(layer, String(what) + " shapes " + ToString(a.shape) + " and " + ToString(b.shape) + " mismatch") : true;
+        }
+
+        bool Weight(const LayerParam & layer, size_t index, const Dims & shape)
+        {
+            if (index >= layer.weight().size())
+                return Fail(layer, "weight[" + ValueToString(index) + "] is missing");
+            const Shape & dim = layer.weight()[index].dim();
+            bool conflict = dim.size() != shape.size();
+            for (size_t i = 0; i < shape.size() && !conflict; ++i)
+                conflict = Conflict(shape[i], (Dim)dim[i]);
+            if (conflict)
+                return Fail(layer, "weight[" + ValueToString(index) + "] shape " + ToString(Dims(dim.begin(), dim.end())) + " does not match " + ToString(shape));
+            return true;
+        }
+
+        bool Infer(const LayerParam & layer, const std::vector<const Entry*> & src, Entries & dst)
+        {
+            switch (layer.type())
+            {
+            case LayerTypeInput:
+            {
+                const InputParam & input = layer.input();
+                if (input.shape().size() != 0 && input.shape().size() != 1 && input.shape().size() != dst.size())
+                    return Fail(layer, "count of shapes does not match count of outputs");
+                for (size_t i = 0; i < dst.size() && input.shape().size(); ++i)
+                    Set(dst[i], input.shape()[input.shape().size() == 1 ? 0 : i].dim());
+                return true;
+            }
+            case LayerTypeConst:
+                if (layer.weight().size() != 1 || dst.size() != 1)
+                    return Fail(layer, "must have one weight and one output");
+                Set(dst[0], layer.weight()[0].dim());
+                return true;
+            case LayerTypeMeta:
+                return InferMeta(layer, src, dst);
+            default:
+                break;
+            }
+
+            if (src.empty() || dst.empty())
+                return Fail(layer, "has no inputs or outputs");
+            const Entry & src0 = *src[0];
+            if (!src0.ranked)
+            {
+                for (size_t i = 0; i < dst.size(); ++i)
+                    dst[i] = Entry();
+                return true;
+            }
+            const Dims & s = src0.shape;
+            Entry & dst0 = dst[0];
+            dst0.ranked = true;
+            dst0.shape = s;
+
+            switch (layer.type())
+            {
+            case LayerTypeBatchNorm:
+            case LayerTypeFill:
+            case LayerTypeLog:
+            case LayerTypeRelu:
+            case LayerTypeRestrictRange:
+            case LayerTypeSigmoid:
+            case LayerTypeUnaryOperation:
+            case LayerTypeDropout:
+            case LayerTypeStub:
+                return true;
+            case LayerTypeCast:
+                dst0.value = src0.value;
+                dst0.valued = src0.valued;
+                return true;
+            case LayerTypeSoftmax:
+                return layer.softmax().axis() < s.size() ? true : Fail(layer, "axis is out of range");
+            case LayerTypeLrn:
+            case LayerTypeNormalize:
+                return s.size() >= (layer.type() == LayerTypeLrn ? 4 : 3) ? true : Fail(layer, "input rank " + ValueToString(s.size()) + " is too small");
+            case LayerTypeBias:
+            case LayerTypeScale:
+            {
+                if (src.size() > 1)
+                    return true;
+                size_t axis = layer.type() == LayerTypeBias ? layer.bias().axis() : layer.scale().axis();
+                if (layer.weight().empty())
+                    return Fail(layer, "weight is missing");
+                const Shape & dim = layer.weight()[0].dim();
+                if (dim.empty())
+                    return true;
+                if (axis + dim.size() > s.size())
+                    return Fail(layer, "weight rank does not fit input " + ToString(s));
+                return Weight(layer, 0, Dims(s.begin() + axis, s.begin() + axis + dim.size()));
+            }
+            case LayerTypeConcat:
+            {
+                size_t axis = layer.concat().axis();
+                if (axis >= s.size())
+                    return Fail(layer, "axis is out of range");
+                for (size_t i = 1; i < src.size(); ++i)
+                {
+                    if (!src[i]->ranked)
+                    {
+                        dst0 = Entry();
+                        return true;
+                    }
+                    const Dims & si = src[i]->shape;
+                    if (si.size() != s.size())
+                        return Fail(layer, "input ranks mismatch");
+                    for (size_t j = 0; j < s.size(); ++j)
+                        if (j != axis && Conflict(s[j], si[j]))
+                            return Fail(layer, "input shapes " + ToString(s) + " and " + ToString(si) + " mismatch");
+                    dst0.shape[axis] = Add(dst0.shape[axis], si[axis]);
+                }
+                return true;
+            }
+            case LayerTypeConvolution:
+                return InferConvolution(layer, s, dst);
+            case LayerTypeDetectionOutput:
+            {
+                if (src.size() < 3)
+                    return Fail(layer, "needs 3 inputs");
+                dst0.shape = Dims({ 1, 1, 1, 7 });
+                return true;
+            }
+            case LayerTypeEltwise:
+            case LayerTypeShortcut:
+                for (size_t i = 1; i < src.size(); ++i)
+                    if (!Same(layer, src0, *src[i], "input"))
+                        return false;
+                return true;
+            case LayerTypeExpandDims:
+            {
+                size_t axis;
+                if (!Axis(layer.expandDims().axis(), s.size() + 1, axis))
+                    return Fail(layer, "axis is out of range");
+                dst0.shape.insert(dst0.shape.begin() + axis, 1);
+                return true;
+            }
+            case LayerTypeFlatten:
+            {
+                size_t begin, end;
+                if (!Axis(layer.flatten().axis(), s.size(), begin) || !Axis(layer.flatten().endAxis(), s.size(), end) || begin > end)
+                    return Fail(layer, "axes are out of range");
+                dst0.shape.assign(s.begin(), s.begin() + begin);
+                dst0.shape.push_back(Size(s, begin, end + 1));
+                dst0.shape.insert(dst0.shape.end(), s.begin() + end + 1, s.end());
+                return true;
+            }
+            case LayerTypeGather:
+                if (src.size() != 2)
+                    return Fail(layer, "needs 2 inputs");
+                dst0 = *src[1];
+                dst0.valued = false;
+                return true;
+            case LayerTypeInnerProduct:
+                return InferInnerProduct(layer, src, dst);
+            case LayerTypeInterp:
+            {
+                const InterpParam & param = layer.interp();
+                if (s.size() != 4)
+                    return Fail(layer, "input must be 4D");
+                Dim crop = param.cropBeg() + param.cropEnd();
+                Dim h = Known(s[2]) ? s[2] - crop : Fresh(), w = Known(s[3]) ? s[3] - crop : Fresh();
+                if (param.useTensorSize())
+                    h = s[1], w = s[0];
+                else if (param.shrinkFactor() != 1 && param.zoomFactor() == 1)
+                    h = Add(Div(Add(h, -1), param.shrinkFactor()), 1), w = Add(Div(Add(w, -1), param.shrinkFactor()), 1);
+                else if (param.shrinkFactor() == 1 && param.zoomFactor() != 1)
+                    h = Add(h, Mul(Add(h, -1), param.zoomFactor() - 1)), w = Add(w, Mul(Add(w, -1), param.zoomFactor() - 1));
+                else if (param.height() && param.width())
+                    h = param.height(), w = param.width();
+                else if (param.shrinkFactor() != 1 && param.zoomFactor() != 1)
+                {
+                    h = Add(Div(Add(h, -1), param.shrinkFactor()), 1), w = Add(Div(Add(w, -1), param.shrinkFactor()), 1);
+                    h = Add(h, Mul(Add(h, -1), param.zoomFactor() - 1)), w = Add(w, Mul(Add(w, -1), param.zoomFactor() - 1));
+                }
+                else
+                    return Fail(layer, "output size is not defined");
+                dst0.shape = Dims({ s[0], s[1], h, w });
+                return true;
+            }
+            case LayerTypePad:
+            {
+                if (src.size() != 2 || !src[1]->ranked)
+                {
+                    dst0 = Entry();
+                    return true;
+                }
+                const Dims & raw = src[1]->shape;
+                size_t n = s.size();
+                if (raw.size() != n * 2)
+                    return Fail(layer, "pad shape " + ToString(raw) + " does not fit input " + ToString(s));
+                for (size_t i = 0; i < n; ++i)
+                {
+                    size_t j = n == 4 ? (i == 0 ? 0 : (i == 1 ? 3 : i - 1)) : i;
+                    dst0.shape[i] = Add(Add(s[i], raw[j * 2 + 0]), raw[j * 2 + 1]);
+                }
+                return true;
+            }
+            case LayerTypePermute:
+            {
+                const Shape & order = layer.permute().order();
+                if (order.size() != s.size())
+                    return Fail(layer, "order size does not match input rank");
+                for (size_t i = 0; i < order.size(); ++i)
+                {
+                    if (order[i] >= s.size())
+                        return Fail(layer, "order is out of range");
+                    dst0.shape[i] = s[order[i]];
+                }
+                return true;
+            }
+            case LayerTypePooling:
+                return InferPooling(layer, s, dst);
+            case LayerTypePriorBox:
+            {
+                const PriorBoxParam & param = layer.priorBox();
+                if (s.size() != 4)
+                    return Fail(layer, "input must be 4D");
+                Floats ratios(1, 1.0f);
+                for (size_t i = 0; i < param.aspectRatio().size(); ++i)
+                {
+                    float ratio = param.aspectRatio()[i];
+                    bool exist = false;
+                    for (size_t j = 0; j < ratios.size() && !exist; ++j)
+                        exist = ::fabs(ratio - ratios[j]) < 1e-6;
+                    if (!exist)
+                    {
+                        ratios.push_back(ratio);
+                        if (param.flip())
+                            ratios.push_back(1.0f / ratio);
+                    }
+                }
+                Dim priors = ratios.size() * param.minSize().size() + param.maxSize().size();
+                dst0.shape = Dims({ 1, 2, Mul(Mul(s[3], s[2]), priors * 4) });
+                return true;
+            }
+            case LayerTypeRegion:
+            {
+                const RegionParam & param = layer.region();
+                if (s.size() < 2 || Conflict(s[1], param.num() * (param.coords() + param.classes() + 1)))
+                    return Fail(layer, "input " + ToString(s) + " does not match num * (coords + classes + 1)");
+                return true;
+            }
+            case LayerTypeReorg:
+            {
+                Dim stride = layer.reorg().stride();
+                if (s.size() != 4)
+                    return Fail(layer, "input must be 4D");
+                if (layer.reorg().reverse())
+                    dst0.shape = Dims({ s[0], Div(s[1], stride * stride), Mul(s[2], stride), Mul(s[3], stride) });
+                else
+                    dst0.shape = Dims({ s[0], Mul(s[1], stride * stride), Div(s[2], stride), Div(s[3], stride) });
+                return true;
+            }
+            case LayerTypeReshape:
+                return InferReshape(layer, src, dst);
+            case LayerTypeSlice:
+            {
+                size_t axis = layer.slice().axis();
+                const Index & points = layer.slice().slicePoint();
+                if (axis >= s.size())
+                    return Fail(layer, "axis is out of range");
+                if (points.size() && points.size() != dst.size() - 1)
+                    return Fail(layer, "count of slice points does not match count of outputs");
+                Dim prev = 0;
+                for (size_t i = 0; i < dst.size(); ++i)
+                {
+                    dst[i] = dst0;
+                    if (points.empty())
+                    {
+                        if (Known(s[axis]) && s[axis] % dst.size())
+                            return Fail(layer, "axis size " + ValueToString(s[axis]) + " is not divisible by count of outputs");
+                        dst[i].shape[axis] = Div(s[axis], dst.size());
+                    }
+                    else
+                    {
+                        Dim next = i < points.size() ? (Dim)points[i] : s[axis];
+                        if (i < points.size() && next <= prev)
+                            return Fail(layer, "slice points must increase");
+                        dst[i].shape[axis] = Known(next) ? next - prev : Fresh();
+                        prev = next;
+                    }
+                }
+                if (!points.empty() && Known(s[axis]) && (Dim)points.back() >= s[axis])
+                    return Fail(layer, "slice point is out of range");
+                return true;
+            }
+            case LayerTypeSqueeze:
+            {
+                dst0.shape.clear();
+                for (size_t i = 0; i < s.size(); ++i)
+                    if (s[i] != 1)
+                        dst0.shape.push_back(s[i]);
+                return true;
+            }
+            case LayerTypeSwitch:
+                if (dst.size() != 2)
+                    return Fail(layer, "must have 2 outputs");
+                dst[1] = dst0;
+                return true;
+            case LayerTypeUnpack:
+            {
+                size_t axis;
+                if (!Axis(layer.unpack().axis(), s.size(), axis))
+                    return Fail(layer, "axis is out of range");
+                if (Known(s[axis]) && s[axis] % dst.size())
+                    return Fail(layer, "axis size " + ValueToString(s[axis]) + " is not divisible by count of outputs");
+                dst0.shape[axis] = Div(s[axis], dst.size());
+                for (size_t i = 1; i < dst.size(); ++i)
+                    dst[i] = dst0;
+                return true;
+            }
+            case LayerTypeUpsample:
+            {
+                Dim stride = layer.upsample().stride();
+                size_t n = s.size();
+                if (n < 2)
+                    return Fail(layer, "input rank is too small");
+                for (size_t i = n - 2; i < n; ++i)
+                    dst0.shape[i] = stride < 0 ? Div(s[i], -stride) : Mul(s[i], stride);
+                return true;
+            }
+            case LayerTypeYolo:
+                if (s.size() < 2)
+                    return Fail(layer, "input rank is too small");
+                dst0.shape[1] = layer.yolo().num() * (layer.yolo().classes() + 4 + 1);
+                return true;
+            default:
+                return Fail(layer, "unsupported layer type");
+            }
+        }
+
+        bool InferConvolution(const LayerParam & layer, const Dims & s, Entries & dst)
+        {
+            const ConvolutionParam & param = layer.convolution();
+            size_t axis = param.axis();
+            if (axis >= s.size())
+                return Fail(layer, "axis is out of range");
+            size_t spatial = s.size() - axis - 1;
+            const Shape & kernel = param.kernel(), & stride = param.stride(), & pad = param.pad(), & dilation = param.dilation();
+            if ((kernel.size() != 1 && kernel.size() != spatial) || (stride.size() > 1 && stride.size() != spatial) ||
+                (dilation.size() > 1 && dilation.size() != spatial) || (pad.size() > 1 && pad.size() != spatial && pad.size() != spatial * 2))
+                return Fail(layer, "kernel, stride, pad or dilation does not fit input " + ToString(s));
+            Dim group = param.group(), output = param.outputNum();
+            if (output == 0 || group == 0 || output % group)
+                return Fail(layer, "output number must be a positive multiple of group");
+            if (Known(s[axis]) && s[axis] % group)
+                return Fail(layer, "input channels " + ValueToString(s[axis]) + " are not divisible by group");
+            Dims weight(1, output);
+            weight.push_back(Div(s[axis], group));
+            Dims & d = dst[0].shape;
+            d.assign(s.begin(), s.begin() + axis);
+            d.push_back(output);
+            for (size_t i = 0; i < spatial; ++i)
+            {
+                Dim k = kernel.size() == 1 ? kernel[0] : kernel[i];
+                Dim st = stride.empty() ? 1 : (stride.size() == 1 ? stride[0] : stride[i]);
+                Dim dl = dilation.empty() ? 1 : (dilation.size() == 1 ? dilation[0] : dilation[i]);
+                Dim pb = pad.empty() ? 0 : (pad.size() == 1 ? pad[0] : pad[i]);
+                Dim pe = pad.empty() ? 0 : (pad.size() == 1 ? pad[0] : (pad.size() == spatial ? pad[i] : pad[spatial + i]));
+                if (k <= 0 || st <= 0 || dl <= 0)
+                    return Fail(layer, "kernel, stride and dilation must be positive");
+                weight.push_back(k);
+                Dim extent = dl * (k - 1) + 1, x = s[axis + 1 + i];
+                if (Known(x) && x + pb + pe < extent)
+                    return Fail(layer, "kernel does not fit input " + ToString(s));
+                d.push_back(Known(x) ? (x + pb + pe - extent) / st + 1 : Fresh());
+            }
+            for (size_t i = 1; i < dst.size(); ++i)
+                dst[i] = dst[0];
+            if (layer.weight().size() != (param.biasTerm() ? 2 : 1))
+                return Fail(layer, "count of weights does not match biasTerm");
+            return Weight(layer, 0, weight) && (!param.biasTerm() || Weight(layer, 1, Dims(1, output)));
+        }
+
+        bool InferInnerProduct(const LayerParam & layer, const std::vector<const Entry*> & src, Entries & dst)
+        {
+            const InnerProductParam & param = layer.innerProduct();
+            const Dims & s = src[0]->shape;
+            size_t axis = param.axis();
+            if (axis >= s.size())
+                return Fail(layer, "axis is out of range");
+            Dim k = Size(s, axis, s.size()), n = param.outputNum();
+            if (src.size() > 1)
+            {
+                if (!src[1]->ranked || axis >= src[1]->shape.size())
+                {
+                    dst[0] = Entry();
+                    return true;
+                }
+                n = src[1]->shape[axis];
+            }
+            dst[0].shape.assign(s.begin(), s.begin() + axis);
+            dst[0].shape.push_back(n);
+            if (src.size() > 1)
+                return true;
+            if (layer.weight().size() != (param.biasTerm() ? 2 : 1))
+                return Fail(layer, "count of weights does not match biasTerm");
+            return Weight(layer, 0, param.transposeB() ? Dims({ k, n }) : Dims({ n, k })) && (!param.biasTerm() || Weight(layer, 1, Dims(1, n)));
+        }
+
+        bool InferPooling(const LayerParam & layer, const Dims & s, Entries & dst)
+        {
+            const PoolingParam & param = layer.pooling();
+            if (s.size() != 4)
+                return Fail(layer, "input must be 4D");
+            const Shape & kernel = param.kernel(), & pad = param.pad(), & stride = param.stride();
+            if ((!param.globalPooling() && kernel.size() != 1 && kernel.size() != 2) || (pad.size() == 3 || pad.size() > 4) || stride.size() > 2)
+                return Fail(layer, "kernel, stride or pad has wrong size");
+            Dim kY = param.globalPooling() ? s[2] : kernel[0], kX = param.globalPooling() ? s[3] : kernel.back();
+            Dim pY = pad.empty() ? 0 : pad[0], pX = pad.empty() ? 0 : pad[pad.size() > 1 ? 1 : 0];
+            Dim pH = pad.size() == 4 ? pad[2] : pY, pW = pad.size() == 4 ? pad[3] : pX;
+            Dim sY = stride.empty() ? 1 : stride[0], sX = stride.empty() ? 1 : stride.back();
+            if (sY <= 0 || sX <= 0)
+                return Fail(layer, "stride must be positive");
+            Dim y = Fresh(), x = Fresh();
+            if (Known(s[2]) && Known(s[3]) && Known(kY) && Known(kX))
+            {
+                if (kY <= 0 || kX <= 0 || pY + pH >= kY || pX + pW >= kX)
+                    return Fail(layer, "kernel must be positive and greater than pad");
+                if (param.yoloCompatible())
+                {
+                    y = (s[2] + pY + pH) / sY;
+                    x = (s[3] + pX + pW) / sX;
+                }
+                else
+                {
+                    y = (Dim)::ceil(float(s[2] + pY + pH - kY) / sY) + 1;
+                    x = (Dim)::ceil(float(s[3] + pX + pW - kX) / sX) + 1;
+                    if (pY || pX)
+                    {
+                        if ((x - 1) * sX >= s[3] + pX)
+                            --x;
+                        if ((y - 1) * sY >= s[2] + pY)
+                            --y;
+                    }
+                }
+            }
+            dst[0].shape = Dims({ s[0], s[1], y, x });
+            return true;
+        }
+
+        bool InferReshape(const LayerParam & layer, const std::vector<const Entry*> & src, Entries & dst)
+        {
+            const Dims & s = src[0]->shape;
+            Dims & d = dst[0].shape;
+            Dim total = Size(s, 0, s.size());
+            if (src.size() == 2)
+            {
+                if (!src[1]->valued)
+                {
+                    dst[0] = Entry();
+                    return true;
+                }
+                d = src[1]->value;
+                if (d.size() == 2)
+                    d = Dims({ d[1], d[0] });
+                if (d.size() == 4)
+                    d = Dims({ d[0], d[3], d[1], d[2] });
+            }
+            else
+            {
+                const ReshapeParam & param = layer.reshape();
+                size_t begin = param.axis() >= 0 ? param.axis() : s.size() + param.axis() + 1;
+                size_t end = param.numAxes() == -1 ? s.size() : begin + param.numAxes();
+                if (begin > s.size() || end > s.size() || param.numAxes() < -1)
+                    return Fail(layer, "axes are out of range for input " + ToString(s));
+                d.assign(s.begin(), s.begin() + begin);
+                for (size_t i = 0; i < param.shape().size(); ++i)
+                {
+                    Dim dim = (Dim)param.shape()[i];
+                    if (dim == 0)
+                    {
+                        if (begin + i >= s.size())
+                            return Fail(layer, "copied axis is out of range");
+                        dim = s[begin + i];
+                    }
+                    d.push_back(dim);
+                }
+                d.insert(d.end(), s.begin() + end, s.end());
+            }
+            size_t inferred = d.size();
+            Dim known = 1;
+            for (size_t i = 0; i < d.size(); ++i)
+            {
+                if (d[i] == -1)
+                {
+                    if (inferred != d.size())
+                        return Fail(layer, "only one dimension can be inferred");
+                    inferred = i;
+                }
+                else if (d[i] < 0 && !Symbolic(d[i]))
+                    return Fail(layer, "wrong dimension " + ValueToString(d[i]));
+                else
+                    known = Mul(known, d[i]);
+            }
+            if (inferred < d.size())
+            {
+                if (Known(total) && Known(known) && (known == 0 || total % known))
+                    return Fail(layer, "input " + ToString(s) + " can't be reshaped to " + ToString(d));
+                d[inferred] = Div(total, known);
+            }
+            else if (Conflict(total, known))
+                return Fail(layer, "input " + ToString(s) + " can't be reshaped to " + ToString(d));
+            return true;
+        }
+
+        bool InferMeta(const LayerParam & layer, const std::vector<const Entry*> & src, Entries & dst)
+        {
+            const MetaParam & param = layer.meta();
+            if (dst.size() != 1)
+                return true;
+            Entry & d = dst[0];
+            switch (param.type())
+            {
+            case MetaTypeConst:
+                d.ranked = true, d.valued = param.alpha().type() == TensorType32i;
+                d.shape.assign(param.alpha().shape().begin(), param.alpha().shape().end());
+                d.value.assign(param.alpha().i32().begin(), param.alpha().i32().end());
+                return true;
+            case MetaTypeShape:
+            {
+                if (src.size() != 1)
+                    return Fail(layer, "needs 1 input");
+                if (!src[0]->ranked)
+                    return true;
+                Dims v = src[0]->shape;
+                if (v.size() == 4)
+                    v = Dims({ v[0], v[2], v[3], v[1] });
+                if (v.size() == 2)
+                    v = Dims({ v[1], v[0] });
+                d.ranked = true, d.valued = true;
+                d.shape = Dims(1, v.size());
+                d.value = v;
+                return true;
+            }
+            case MetaTypePack:
+            {
+                d.ranked = true, d.valued = true;
+                d.shape = Dims(1, src.size());
+                for (size_t i = 0; i < src.size() && d.valued; ++i)
+                {
+                    d.valued = src[i]->valued && src[i]->value.size() == 1;
+                    if (d.valued)
+                        d.value.push_back(src[i]->value[0]);
+                }
+                return true;
+            }
+            default:
+                break;
+            }
+            if (!Detail::MetaFoldable(param) || src.empty())
+                return true;
+            std::vector<TensorParam> values(src.size());
+            std::vector<const TensorParam*> ptrs;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                if (!src[i]->valued || !Known(*src[i]))
+                    return true;
+                for (size_t j = 0; j < src[i]->value.size(); ++j)
+                    if (Symbolic(src[i]->value[j]))
+                        return true;
+                values[i].type() = TensorType32i;
+                values[i].shape() = ToShape(*src[i]);
+                values[i].i32().assign(src[i]->value.begin(), src[i]->value.end());
+                ptrs.push_back(&values[i]);
+            }
+            TensorParam value;
+            if (Detail::MetaEvaluate(layer, ptrs, value))
+            {
+                d.ranked = true, d.valued = true;
+                d.shape.assign(value.shape().begin(), value.shape().end());
+                d.value.assign(value.i32().begin(), value.i32().end());
+            }
+            return true;
+        }
+    };
+}
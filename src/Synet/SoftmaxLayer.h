@@ -27,47 +27,72 @@
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
 #include "Synet/Math.h"
-#include "Synet/UnaryOperationLayer.h"
+#include "Synet/Parallel.h"
 
 namespace Synet
 {
     namespace Detail
     {
-        template <typename T> void SoftmaxLayerForwardCpu(const T * src, size_t channels, size_t inner, T * buffer, T * dst)
+        template <typename T> void SoftmaxLayerForwardCpu(const T * src, size_t channels, size_t inner, size_t begin, size_t end, T * dst)
         {
-            Synet::CpuCopy(src, inner, buffer);
-            const T * s = src + inner;
-            for (size_t i = 1; i < channels; ++i)
+            const size_t BLOCK = 64;
+            if (inner == 1)
             {
-                Synet::CpuMax(s, buffer, inner, buffer);
-                s += inner;
+                T max = src[0];
+                for (size_t c = 1; c < channels; ++c)
+                    max = std::max(max, src[c]);
+                for (size_t c = 0; c < channels; ++c)
+                    dst[c] = src[c] - max;
+                CpuExp(dst, channels, dst);
+                T sum[4] = { 0, 0, 0, 0 };
+                size_t channels4 = channels & (~size_t(3)), c = 0;
+                for (; c < channels4; c += 4)
+                {
+                    sum[0] += dst[c + 0];
+                    sum[1] += dst[c + 1];
+                    sum[2] += dst[c + 2];
+                    sum[3] += dst[c + 3];
+                }
+                for (; c < channels; ++c)
+                    sum[0] += dst[c];
+                CpuScale(dst, channels, T(1) / (sum[0] + sum[1] + sum[2] + sum[3]), dst);
+                return;
             }
-
-            s = src;
-            T * d = dst;
-            for (size_t i = 0; i < channels; ++i)
+            size_t block = std::min(std::max<size_t>(4096 / channels, 16), BLOCK);
+            T max[BLOCK], sum[BLOCK];
+            for (size_t b = begin; b < end; b += block)
             {
-                Synet::CpuSub(s, buffer, inner, d);
-                s += inner;
-                d += inner;
-            }
-
-            CpuExp(dst, channels*inner, dst);
-
-            Synet::CpuCopy(dst, inner, buffer);
-            d = dst + inner;
-            for (size_t i = 1; i < channels; ++i)
-            {
-                Synet::CpuAdd(d, buffer, inner, buffer);
-                d += inner;
+                size_t size = std::min(block, end - b);
+                const T * s = src + b;
+                CpuCopy(s, size, max);
+                for (size_t c = 1; c < channels; ++c)
+                {
+                    s += inner;
+                    for (size_t i = 0; i < size; ++i)
+                        max[i] = std::max(max[i], s[i]);
+                }
+                s = src + b;
+                T * d = dst + b;
+                CpuSet(size, T(0), sum);
+                for (size_t c = 0; c < channels; ++c, s += inner, d += inner)
+                {
+                    for (size_t i = 0; i < size; ++i)
+                        d[i] = s[i] - max[i];
+                    CpuExp(d, size, d);
+                    for (size_t i = 0; i < size; ++i)
+                        sum[i] += d[i];
+                }
+                for (size_t i = 0; i < size; ++i)
+                    sum[i] = T(1) / sum[i];
+                d = dst + b;
+                for (size_t c = 0; c < channels; ++c, d += inner)
+                    CpuMul(d, sum, size, d);
             }
+        }
 
-            d = dst;
-            for (size_t i = 0; i < channels; ++i)
-            {
-                Synet::CpuDiv(d, buffer, inner, d);
-                d += inner;
-            }
+        template <typename T> SYNET_INLINE void SoftmaxLayerForwardCpu(const T * src, size_t channels, size_t inner, T * dst)
+        {
+            SoftmaxLayerForwardCpu(src, channels, inner, 0, inner, dst);
         }
     }
 
@@ -93,10 +118,8 @@ namespace Synet
             _softmaxAxis = this->Param().softmax().axis();
             dst[0]->Reshape(src[0]->Shape());
             _outerNum = src[0]->Size(0, _softmaxAxis);
+            _channels = src[0]->Axis(_softmaxAxis);
             _innerNum = src[0]->Size(_softmaxAxis + 1);
-            Shape scaleShape = src[0]->Shape();
-            scaleShape[_softmaxAxis] = 1;
-            _scale.Reshape(scaleShape);
         }
 
     protected:
@@ -104,14 +127,34 @@ namespace Synet
         {
             SYNET_PERF_FUNC();
 
-            size_t channels = src[0]->Axis(_softmaxAxis);
-            size_t dim = src[0]->Size() / _outerNum;
-            for (size_t i = 0; i < _outerNum; ++i)
-                Detail::SoftmaxLayerForwardCpu(src[0]->CpuData() + i*dim, channels, _innerNum, _scale.CpuData(), dst[0]->CpuData() + i*dim);
+            const Type * pSrc = src[0]->CpuData();
+            Type * pDst = dst[0]->CpuData();
+            size_t channels = _channels, inner = _innerNum, dim = channels * inner;
+            size_t threadNumber = src[0]->Size() < 0x10000 ? 1 : GetThreadNumber();
+            if (inner == 1)
+            {
+                Parallel(0, _outerNum, [=](size_t thread, size_t begin, size_t end)
+                {
+                    for (size_t o = begin; o < end; ++o)
+                        Detail::SoftmaxLayerForwardCpu(pSrc + o * dim, channels, 1, pDst + o * dim);
+                }, threadNumber);
+            }
+            else
+            {
+                const size_t BLOCK = 64;
+                size_t blocks = (inner + BLOCK - 1) / BLOCK;
+                Parallel(0, _outerNum * blocks, [=](size_t thread, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        size_t o = i / blocks, b = i % blocks * BLOCK;
+                        Detail::SoftmaxLayerForwardCpu(pSrc + o * dim, channels, inner, b, std::min(b + BLOCK, inner), pDst + o * dim);
+                    }
+                }, threadNumber);
+            }
         }
 
     private:
-        size_t _outerNum, _innerNum, _softmaxAxis;
-        Tensor _scale;
+        size_t _outerNum, _channels, _innerNum, _softmaxAxis;
     };
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#ifndef SYNET_SPARSE_DENSITY_MAX
+#define SYNET_SPARSE_DENSITY_MAX 0.35f
+#endif
+
+namespace Synet
+{
+    template <class T> class SparseMatrix
+    {
+    public:
+        typedef T Type;
+
+        SparseMatrix()
+            : _rows(0)
+            , _cols(0)
+        {
+        }
+
+        bool Init(const Type * src, size_t rows, size_t cols, float density = SYNET_SPARSE_DENSITY_MAX)
+        {
+            Clear();
+            size_t nonZero = 0;
+            for (size_t i = 0, size = rows * cols; i < size; ++i)
+                nonZero += src[i] != Type(0) ? 1 : 0;
+            if (rows == 0 || cols == 0 || nonZero > density * rows * cols)
+                return false;
+            _rows = rows;
+            _cols = cols;
+            _offset.resize(rows + 1);
+            _index.reserve(nonZero);
+            _value.reserve(nonZero);
+            for (size_t i = 0; i < rows; ++i)
+            {
+                _offset[i] = (uint32_t)_index.size();
+                for (size_t j = 0; j < cols; ++j, ++src)
+                {
+                    if (*src != Type(0))
+                    {
+                        _index.push_back((uint32_t)j);
+                        _value.push_back(*src);
+                    }
+                }
+            }
+            _offset[rows] = (uint32_t)_index.size();
+            return true;
+        }
+
+        void Clear()
+        {
+            _rows = 0;
+            _cols = 0;
+            _offset.clear();
+            _index.clear();
+            _value.clear();
+        }
+
+        SYNET_INLINE bool Enable() const
+        {
+            return _rows != 0;
+        }
+
+        SYNET_INLINE size_t Rows() const
+        {
+            return _rows;
+        }
+
+        SYNET_INLINE size_t Cols() const
+        {
+            return _cols;
+        }
+
+        void Mul(const Type * src, size_t size, Type * dst) const
+        {
+            for (size_t i = 0; i < _rows; ++i, dst += size)
+            {
+                const uint32_t * index = _index.data() + _offset[i];
+                const Type * value = _value.data() + _offset[i];
+                size_t count = _offset[i + 1] - _offset[i], count4 = count & (~size_t(3)), k = 0;
+                memset(dst, 0, size * sizeof(Type));
+                for (; k < count4; k += 4)
+                {
+                    const Type * s0 = src + index[k + 0] * size;
+                    const Type * s1 = src + index[k + 1] * size;
+                    const Type * s2 = src + index[k + 2] * size;
+                    const Type * s3 = src + index[k + 3] * size;
+                    Type w0 = value[k + 0], w1 = value[k + 1], w2 = value[k + 2], w3 = value[k + 3];
+                    for (size_t j = 0; j < size; ++j)
+                        dst[j] += w0 * s0[j] + w1 * s1[j] + w2 * s2[j] + w3 * s3[j];
+                }
+                for (; k < count; ++k)
+                {
+                    const Type * s0 = src + index[k] * size;
+                    Type w0 = value[k];
+                    for (size_t j = 0; j < size; ++j)
+                        dst[j] += w0 * s0[j];
+                }
+            }
+        }
+
+        void Mul(const Type * src, Type * dst) const
+        {
+            for (size_t i = 0; i < _rows; ++i)
+            {
+                const uint32_t * index = _index.data() + _offset[i];
+                const Type * value = _value.data() + _offset[i];
+                size_t count = _offset[i + 1] - _offset[i], count4 = count & (~size_t(3)), k = 0;
+                Type sums[4] = { 0, 0, 0, 0 };
+                for (; k < count4; k += 4)
+                {
+                    sums[0] += value[k + 0] * src[index[k + 0]];
+                    sums[1] += value[k + 1] * src[index[k + 1]];
+                    sums[2] += value[k + 2] * src[index[k + 2]];
+                    sums[3] += value[k + 3] * src[index[k + 3]];
+                }
+                for (; k < count; ++k)
+                    sums[0] += value[k] * src[index[k]];
+                dst[i] = sums[0] + sums[1] + sums[2] + sums[3];
+            }
+        }
+
+        void Save(std::ostream & os) const
+        {
+            uint64_t header[2] = { _rows, _cols };
+            os.write((const char*)header, sizeof(header));
+            if (_rows == 0)
+                return;
+            os.write((const char*)_offset.data(), _offset.size() * sizeof(uint32_t));
+            os.write((const char*)_index.data(), _index.size() * sizeof(uint32_t));
+            os.write((const char*)_value.data(), _value.size() * sizeof(Type));
+        }
+
+        // Checks the whole structure: Mul trusts offsets and column indices without bounds checks.
+        bool Load(const uint8_t * & data, size_t & size)
+        {
+            Clear();
+            uint64_t header[2];
+            if (size < sizeof(header))
+                return false;
+            memcpy(header, data, sizeof(header));
+            data += sizeof(header), size -= sizeof(header);
+            if (header[0] == 0)
+                return header[1] == 0;
+            if (header[1] == 0 || header[1] > uint64_t(uint32_t(-1)) || header[0] >= size / sizeof(uint32_t))
+                return false;
+            size_t offsetSize = (size_t(header[0]) + 1) * sizeof(uint32_t);
+            _offset.resize(size_t(header[0]) + 1);
+            memcpy(_offset.data(), data, offsetSize);
+            data += offsetSize, size -= offsetSize;
+            bool valid = _offset[0] == 0;
+            for (size_t i = 1; i < _offset.size() && valid; ++i)
+                valid = _offset[i - 1] <= _offset[i];
+            size_t nonZero = _offset.back();
+            if (!valid || size < nonZero * (sizeof(uint32_t) + sizeof(Type)))
+            {
+                Clear();
+                return false;
+            }
+            _index.resize(nonZero);
+            memcpy(_index.data(), data, nonZero * sizeof(uint32_t));
+            data += nonZero * sizeof(uint32_t), size -= nonZero * sizeof(uint32_t);
+            for (size_t i = 0; i < nonZero && valid; ++i)
+                valid = _index[i] < header[1];
+            if (!valid)
+            {
+                Clear();
+                return false;
+            }
+            _value.resize(nonZero);
+            memcpy(_value.data(), data, nonZero * sizeof(Type));
+            data += nonZero * sizeof(Type), size -= nonZero * sizeof(Type);
+            _rows = size_t(header[0]);
+            _cols = size_t(header[1]);
+            return true;
+        }
+
+    private:
+        size_t _rows, _cols;
+        std::vector<uint32_t> _offset, _index;
+        std::vector<Type> _value;
+    };
+}
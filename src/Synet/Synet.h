@@ -24,4 +24,6 @@
 
 #pragma once
 
-#include "Synet/Network.h"
\ No newline at end of file
+#include "Synet/Network.h"
+#include "Synet/Pipeline.h"
+#include "Synet/TiledNetwork.h"
\ No newline at end of file
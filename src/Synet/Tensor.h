@@ -43,24 +43,27 @@ namespace Synet
         typedef T Type;
 
         SYNET_INLINE Tensor()
-            : _size(0)
+            : _type(TensorTypeUnknown)
+            , _size(0)
             , _cpuData(std::make_shared<Vector>())
-            , _type(TensorTypeUnknown)
+            , _external(NULL)
         {
         }
 
         SYNET_INLINE Tensor(const Synet::Shape & shape, const Type & value = Type(), const String & name = String())
-            : _shape(shape)
+            : _name(name)
+            , _shape(shape)
             , _cpuData(std::make_shared<Vector>())
-            , _name(name)
+            , _external(NULL)
         {
             Resize(value);
         }
 
         SYNET_INLINE Tensor(std::initializer_list<size_t> shape, const Type & value = Type(), const String & name = String())
-            : _shape(shape.begin(), shape.end())
+            : _name(name)
+            , _shape(shape.begin(), shape.end())
             , _cpuData(std::make_shared<Vector>())
-            , _name(name)
+            , _external(NULL)
         {
             Resize(value);
         }
@@ -95,6 +98,16 @@ namespace Synet
             Extend();
         }
 
+        SYNET_INLINE void SetShape(const Synet::Shape & shape)
+        {
+            _type = TensorTypeUnknown;
+            _shape = shape;
+            _size = 0;
+            _cpuData = std::make_shared<Vector>();
+            _external = NULL;
+            SetDebugPtr();
+        }
+
         SYNET_INLINE Tensor<int32_t> & As32i()
         {
             assert(_type == TensorTypeUnknown || _type == TensorType32i);
@@ -212,13 +225,20 @@ namespace Synet
         SYNET_INLINE Type * CpuData()
         {
             assert(_type == Detail::GetTensorType<Type>());
+            if (_external)
+                Detach();
             return _cpuData->data();
         }
 
         SYNET_INLINE const Type * CpuData() const
         {
             assert(_type == Detail::GetTensorType<Type>());
-            return _cpuData->data();
+            return External() ? _external : _cpuData->data();
+        }
+
+        SYNET_INLINE bool External() const
+        {
+            return _external != NULL && _cpuData->empty();
         }
 
         SYNET_INLINE Type * CpuData(const Synet::Index & index)
@@ -248,6 +268,17 @@ namespace Synet
             _name = tensor._name;
             _size = tensor._size;
             _cpuData = tensor._cpuData;
+            _external = tensor._external;
+            SetDebugPtr();
+        }
+
+        SYNET_INLINE void Share(const Type * data, const Synet::Shape & shape)
+        {
+            _type = Detail::GetTensorType<Type>();
+            _shape = shape;
+            _size = Size(0, _shape.size());
+            _cpuData = std::make_shared<Vector>();
+            _external = data;
             SetDebugPtr();
         }
 
@@ -258,6 +289,7 @@ namespace Synet
             _size = Size(0, _shape.size());
             assert(_size == tensor._size);
             _cpuData = tensor._cpuData;
+            _external = tensor._external;
             SetDebugPtr();
         }
 
@@ -267,7 +299,8 @@ namespace Synet
             _shape = tensor._shape;
             _name = tensor._name;
             _size = tensor._size;
-            _cpuData(std::make_shared<Vector>(tensor._cpuData->begin(), tensor._cpuData->end()));
+            _cpuData = std::make_shared<Vector>(tensor.CpuData(), tensor.CpuData() + tensor._size);
+            _external = NULL;
             SetDebugPtr();
         }
 
@@ -387,6 +420,8 @@ namespace Synet
         SYNET_INLINE void Resize(const Type & value)
         {
             _type = Detail::GetTensorType<Type>();
+            if (_external)
+                Detach();
             _size = Size(0, _shape.size());
             _cpuData->resize(_size, value);
             SetDebugPtr();
@@ -397,18 +432,30 @@ namespace Synet
             if(_type == TensorTypeUnknown)
                 _type = Detail::GetTensorType<Type>();
             assert(_type == Detail::GetTensorType<Type>());
+            if (_external)
+                Detach();
             _size = Size(0, _shape.size());
             if (_size > _cpuData->size())
                 _cpuData->resize(_size);
             SetDebugPtr();
         }
 
+        // External data is referenced while the shared buffer is empty. Detaching fills that buffer
+        // in place, so every tensor sharing it switches to the same owned copy and sees its writes.
+        void Detach()
+        {
+            if (_cpuData->empty())
+                _cpuData->assign(_external, _external + _size);
+            _external = NULL;
+            SetDebugPtr();
+        }
+
 #if defined(_DEBUG) && defined(_MSC_VER)
         const Type * _ptr;
 
         SYNET_INLINE void SetDebugPtr()
         {
-            _ptr = _cpuData->data();
+            _ptr = External() ? _external : _cpuData->data();
         }
 #else
         SYNET_INLINE void SetDebugPtr()
@@ -428,5 +475,6 @@ namespace Synet
         Synet::Shape _shape;
         size_t _size;
         VectorPtr _cpuData;
+        const Type * _external;
     };
 }
\ No newline at end of file
@@ -92,6 +92,9 @@ namespace Synet
             if (!ConvertNetwork(holder(), weight))
                 return false;
 
+            if (dstWeightPath.empty())
+                return SaveContainer(holder, weight, dstModelPath);
+
             if (!holder.Save(dstModelPath, false))
                 return false;
 
@@ -0,0 +1,362 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Network.h"
+
+#ifndef SYNET_TILED_NETWORK_SIZE
+#define SYNET_TILED_NETWORK_SIZE 512
+#endif
+
+namespace Synet
+{
+    namespace Detail
+    {
+        SYNET_INLINE ptrdiff_t TiledGcd(ptrdiff_t a, ptrdiff_t b)
+        {
+            while (b)
+            {
+                ptrdiff_t c = a % b;
+                a = b;
+                b = c;
+            }
+            return a;
+        }
+
+        SYNET_INLINE ptrdiff_t TiledCeil(ptrdiff_t a, ptrdiff_t b)
+        {
+            return a > 0 ? (a + b - 1) / b : -(-a / b);
+        }
+
+        // An output pixel y of the tensor depends on source pixels [y * num / den - beg, y * num / den + end].
+        // Upsampling makes the stride num / den fractional; a tile that starts at a multiple of period
+        // meets the pixel grid of every tensor on the way.
+        struct TiledField
+        {
+            ptrdiff_t num, den, period, beg, end;
+            bool valid;
+
+            TiledField(bool v = true)
+                : num(1), den(1), period(1), beg(0), end(0), valid(v)
+            {
+            }
+
+            TiledField Next(const ReceptiveField & field) const
+            {
+                TiledField next = *this;
+                next.beg = beg + TiledCeil(ptrdiff_t(field.padBeg) * num, den);
+                next.end = end + TiledCeil((ptrdiff_t(field.kernel) - 1 - ptrdiff_t(field.padBeg)) * num, den);
+                next.Rescale(field.stride, 1);
+                return next;
+            }
+
+            TiledField Upsample(size_t factor) const
+            {
+                TiledField next = *this;
+                next.beg = beg + TiledCeil(ptrdiff_t(factor - 1) * num, ptrdiff_t(factor) * den);
+                next.Rescale(1, factor);
+                return next;
+            }
+
+            void Merge(const TiledField & field)
+            {
+                valid = valid && field.valid && field.num == num && field.den == den;
+                beg = std::max(beg, field.beg);
+                end = std::max(end, field.end);
+                period = period / TiledGcd(period, field.period) * field.period;
+            }
+
+        private:
+            void Rescale(size_t mul, size_t div)
+            {
+                num *= ptrdiff_t(mul);
+                den *= ptrdiff_t(div);
+                ptrdiff_t gcd = TiledGcd(num, den);
+                num /= gcd;
+                den /= gcd;
+                period = period / TiledGcd(period, num) * num;
+            }
+        };
+
+        SYNET_INLINE bool TiledPointwise(const LayerParam & layer)
+        {
+            switch (layer.type())
+            {
+            case LayerTypeDropout:
+            case LayerTypeLog:
+            case LayerTypeRestrictRange:
+            case LayerTypeSigmoid:
+            case LayerTypeStub:
+            case LayerTypeUnaryOperation:
+                return true;
+            case LayerTypeSoftmax:
+                return layer.softmax().axis() == 1;
+            default:
+                return false;
+            }
+        }
+
+        struct TiledRange
+        {
+            size_t srcBeg, srcEnd, dstBeg, dstEnd;
+        };
+
+        inline bool TiledPlan(size_t size, size_t tile, size_t out, const TiledField & field, std::vector<TiledRange> & ranges)
+        {
+            ranges.clear();
+            ptrdiff_t num = field.num, den = field.den, period = field.period;
+            for (size_t y = 0; y < out;)
+            {
+                TiledRange range;
+                ptrdiff_t first = ptrdiff_t(y) * num - field.beg * den;
+                range.srcBeg = first > 0 ? size_t(first / (den * period) * period) : 0;
+                range.dstBeg = y;
+                if (range.srcBeg + tile >= size)
+                {
+                    range.srcEnd = size;
+                    range.dstEnd = out;
+                }
+                else
+                {
+                    ptrdiff_t last = ptrdiff_t(range.srcBeg + tile) - 1 - field.end;
+                    if (last < 0)
+                        return false;
+                    range.srcEnd = range.srcBeg + tile;
+                    range.dstEnd = std::min<size_t>(last * den / num + 1, out);
+                    if (range.dstEnd <= y)
+                        return false;
+                }
+                ranges.push_back(range);
+                y = range.dstEnd;
+            }
+            return true;
+        }
+    }
+
+    template<class T> class TiledNetwork
+    {
+    public:
+        typedef T Type;
+        typedef Synet::Network<T> Network;
+        typedef typename Network::Tensor Tensor;
+
+        TiledNetwork(Network & network, size_t height = SYNET_TILED_NETWORK_SIZE, size_t width = SYNET_TILED_NETWORK_SIZE)
+            : _height(height)
+            , _width(width)
+        {
+            _contexts.push_back(&network);
+        }
+
+        void AddContext(Network & network)
+        {
+            _contexts.push_back(&network);
+        }
+
+        void SetTile(size_t height, size_t width)
+        {
+            _height = height;
+            _width = width;
+        }
+
+        size_t Tiles() const
+        {
+            return _tiles.size();
+        }
+
+        // Why the last Forward failed, e.g. a layer that can't be split into tiles.
+        const String & Error() const
+        {
+            return _error;
+        }
+
+        bool Forward(const Tensor & src, Tensor & dst)
+        {
+            _error.clear();
+            if (src.Count() != 4)
+                return Fail("source is not 4D");
+            if (!Init())
+                return false;
+            Shape shape = src.Shape();
+            if (!_inference.Run(_contexts[0]->Param(), Strings(1, _srcName), Shapes(1, shape)))
+                return Fail("shape inference: " + _inference.Error());
+            const ShapeInference::Entry & out = _inference.Get(_dstName);
+            if (!ShapeInference::Known(out) || out.shape.size() != 4 || size_t(out.shape[0]) != shape[0])
+                return Fail("output shape is unknown or not 4D");
+            std::vector<Detail::TiledRange> ys, xs;
+            if (!Detail::TiledPlan(shape[2], _height, out.shape[2], _fields[0], ys) ||
+                !Detail::TiledPlan(shape[3], _width, out.shape[3], _fields[1], xs))
+                return Fail("tile is smaller than the receptive field");
+            _tiles.clear();
+            for (size_t y = 0; y < ys.size(); ++y)
+                for (size_t x = 0; x < xs.size(); ++x)
+                    _tiles.push_back(Tile(ys[y], xs[x]));
+            std::stable_sort(_tiles.begin(), _tiles.end(), Tile::Less);
+            dst.Reshape(ShapeInference::ToShape(out));
+            std::vector<char> ok(_contexts.size(), 1);
+            Parallel(0, _tiles.size(), [&](size_t thread, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end && ok[thread]; ++i)
+                    ok[thread] = Run(*_contexts[thread], _tiles[i], src, dst);
+            }, _contexts.size());
+            for (size_t i = 0; i < ok.size(); ++i)
+                if (!ok[i])
+                    return Fail("tile forward failed");
+            return true;
+        }
+
+    private:
+        struct Tile
+        {
+            Detail::TiledRange y, x;
+
+            Tile(const Detail::TiledRange & y_, const Detail::TiledRange & x_) : y(y_), x(x_) {}
+
+            size_t Height() const { return y.srcEnd - y.srcBeg; }
+            size_t Width() const { return x.srcEnd - x.srcBeg; }
+
+            static bool Less(const Tile & a, const Tile & b)
+            {
+                return a.Height() < b.Height() || (a.Height() == b.Height() && a.Width() < b.Width());
+            }
+        };
+
+        size_t _height, _width;
+        std::vector<Network*> _contexts;
+        String _srcName, _dstName;
+        Detail::TiledField _fields[2];
+        ShapeInference _inference;
+        std::vector<Tile> _tiles;
+        String _error;
+
+        bool Fail(const String & error)
+        {
+            _error = error;
+            return false;
+        }
+
+        bool Init()
+        {
+            Network & network = *_contexts[0];
+            if (network.Src().size() != 1 || network.Dst().size() != 1 || network.Back().size() != 1)
+                return Fail("network must have one source and one output");
+            const NetworkParam & param = network.Param();
+            _srcName.clear();
+            for (size_t i = 0; i < param.layers().size() && _srcName.empty(); ++i)
+                if (param.layers()[i].type() == LayerTypeInput)
+                    _srcName = param.layers()[i].name();
+            _dstName = network.Back()[0]->Param().dst()[0];
+            if (_srcName.empty())
+                return Fail("network has no Input layer");
+            for (size_t axis = 0; axis < 2; ++axis)
+                if (!Field(param, axis, _fields[axis]))
+                    return false;
+            return true;
+        }
+
+        bool Field(const NetworkParam & param, size_t axis, Detail::TiledField & field)
+        {
+            std::map<String, Detail::TiledField> fields;
+            for (size_t i = 0; i < param.layers().size(); ++i)
+            {
+                const LayerParam & layer = param.layers()[i];
+                if (layer.type() == LayerTypeInput)
+                {
+                    for (size_t j = 0; j < layer.dst().size(); ++j)
+                        fields[layer.dst()[j]] = Detail::TiledField();
+                    continue;
+                }
+                Detail::TiledField merged(false);
+                size_t found = 0;
+                for (size_t j = 0; j < layer.src().size(); ++j)
+                {
+                    std::map<String, Detail::TiledField>::const_iterator it = fields.find(layer.src()[j]);
+                    if (it == fields.end())
+                        continue;
+                    if (found++)
+                        merged.Merge(it->second);
+                    else
+                        merged = it->second;
+                }
+                if (found == 0)
+                    continue;
+                ReceptiveField receptive;
+                bool merge = layer.type() == LayerTypeEltwise || layer.type() == LayerTypeShortcut ||
+                    (layer.type() == LayerTypeConcat && layer.concat().axis() == 1);
+                bool upsample = layer.type() == LayerTypeUpsample && layer.upsample().stride() != 0;
+                if (found != layer.src().size() || (!merge && found != 1))
+                    merged.valid = false;
+                else if (merge || Detail::TiledPointwise(layer))
+                    ;
+                else if (upsample && layer.upsample().stride() > 0)
+                    merged = merged.Upsample(layer.upsample().stride());
+                else if (upsample)
+                    merged = merged.Next(ReceptiveField(1, -layer.upsample().stride()));
+                else if (ReceptiveField::Get(layer, receptive, axis))
+                    merged = merged.Next(receptive);
+                else
+                {
+                    merged.valid = false;
+                    if (_error.empty())
+                        _error = "layer '" + layer.name() + "' (" + ValueToString(layer.type()) + ") can't be tiled";
+                }
+                for (size_t j = 0; j < layer.dst().size(); ++j)
+                    fields[layer.dst()[j]] = merged;
+            }
+            std::map<String, Detail::TiledField>::const_iterator it = fields.find(_dstName);
+            if (it == fields.end() || !it->second.valid)
+            {
+                if (_error.empty())
+                    _error = "output has no spatial mapping to the source";
+                return false;
+            }
+            field = it->second;
+            return true;
+        }
+
+        bool Run(Network & network, const Tile & tile, const Tensor & src, Tensor & dst)
+        {
+            Shape shape({ src.Axis(0), src.Axis(1), tile.Height(), tile.Width() });
+            if (network.Src()[0]->Shape() != shape && !network.Reshape(Strings(1, _srcName), Shapes(1, shape)))
+                return false;
+            Tensor & input = *network.Src()[0];
+            for (size_t p = 0, planes = shape[0] * shape[1]; p < planes; ++p)
+                for (size_t y = 0; y < shape[2]; ++y)
+                    memcpy(input.CpuData() + (p * shape[2] + y) * shape[3], 
+                        src.CpuData() + (p * src.Axis(2) + tile.y.srcBeg + y) * src.Axis(3) + tile.x.srcBeg, shape[3] * sizeof(Type));
+            network.Forward();
+            const Tensor & output = *network.Dst()[0];
+            size_t y0 = tile.y.srcBeg * _fields[0].den / _fields[0].num, x0 = tile.x.srcBeg * _fields[1].den / _fields[1].num;
+            size_t height = tile.y.dstEnd - tile.y.dstBeg, width = tile.x.dstEnd - tile.x.dstBeg;
+            if (output.Count() != 4 || output.Axis(1) != dst.Axis(1) || tile.y.dstEnd - y0 > output.Axis(2) || tile.x.dstEnd - x0 > output.Axis(3))
+                return false;
+            for (size_t p = 0, planes = dst.Axis(0) * dst.Axis(1); p < planes; ++p)
+                for (size_t y = 0; y < height; ++y)
+                    memcpy(dst.CpuData() + (p * dst.Axis(2) + tile.y.dstBeg + y) * dst.Axis(3) + tile.x.dstBeg,
+                        output.CpuData() + (p * output.Axis(2) + tile.y.dstBeg - y0 + y) * output.Axis(3) + tile.x.dstBeg - x0, width * sizeof(Type));
+            return true;
+        }
+    };
+}
@@ -0,0 +1,342 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Params.h"
+#include "Synet/Layer.h"
+
+#ifndef SYNET_TILE_CACHE_SIZE
+#define SYNET_TILE_CACHE_SIZE 0x40000
+#endif
+
+#ifndef SYNET_TILE_OVERHEAD_MAX
+#define SYNET_TILE_OVERHEAD_MAX 1.25f
+#endif
+
+namespace Synet
+{
+    struct ReceptiveField
+    {
+        size_t kernel, stride, padBeg, padEnd;
+
+        ReceptiveField(size_t k = 1, size_t s = 1, size_t pb = 0, size_t pe = 0)
+            : kernel(k), stride(s), padBeg(pb), padEnd(pe)
+        {
+        }
+
+        static bool Get(const LayerParam & param, ReceptiveField & field, size_t axis = 0)
+        {
+            switch (param.type())
+            {
+            case LayerTypeBatchNorm:
+            case LayerTypeRelu:
+                field = ReceptiveField();
+                return true;
+            case LayerTypeBias:
+            case LayerTypeScale:
+                field = ReceptiveField();
+                return param.weight().size() && param.weight()[0].dim().size() == 1 &&
+                    (param.type() == LayerTypeBias ? param.bias().axis() : param.scale().axis()) == 1;
+            case LayerTypeConvolution:
+            {
+                const ConvolutionParam & conv = param.convolution();
+                if (conv.axis() != 1 || conv.kernel().empty() || conv.kernel().size() > 2)
+                    return false;
+                field.kernel = At(conv.dilation(), axis, 1) * (At(conv.kernel(), axis, 1) - 1) + 1;
+                field.stride = At(conv.stride(), axis, 1);
+                return Pad(conv.pad(), axis, field);
+            }
+            case LayerTypePooling:
+            {
+                const PoolingParam & pool = param.pooling();
+                if (pool.globalPooling() || pool.yoloCompatible() || pool.kernel().empty() || pool.kernel().size() > 2 ||
+                    (pool.method() != PoolingMethodTypeMax && pool.method() != PoolingMethodTypeAverage))
+                    return false;
+                field.kernel = At(pool.kernel(), axis, 1);
+                field.stride = At(pool.stride(), axis, 1);
+                return Pad(pool.pad(), axis, field);
+            }
+            default:
+                return false;
+            }
+        }
+
+        SYNET_INLINE bool Spatial() const
+        {
+            return kernel > 1 || stride > 1;
+        }
+
+        SYNET_INLINE size_t Output(size_t size) const
+        {
+            return size + padBeg + padEnd < kernel ? 0 : (size + padBeg + padEnd - kernel) / stride + 1;
+        }
+
+        void Source(size_t dstBeg, size_t dstEnd, size_t size, size_t & srcBeg, size_t & srcEnd, size_t & pb, size_t & pe) const
+        {
+            ptrdiff_t beg = ptrdiff_t(dstBeg * stride) - ptrdiff_t(padBeg);
+            ptrdiff_t end = ptrdiff_t((dstEnd - 1) * stride + kernel) - ptrdiff_t(padBeg);
+            srcBeg = std::max<ptrdiff_t>(beg, 0);
+            srcEnd = std::min<ptrdiff_t>(end, size);
+            pb = srcBeg - beg;
+            pe = end - srcEnd;
+        }
+
+    private:
+        static SYNET_INLINE size_t At(const Shape & shape, size_t axis, size_t value)
+        {
+            return shape.empty() ? value : shape[std::min(axis, shape.size() - 1)];
+        }
+
+        static bool Pad(const Shape & pad, size_t axis, ReceptiveField & field)
+        {
+            if (pad.size() == 3 || pad.size() > 4 || axis > 1 || field.kernel == 0 || field.stride == 0)
+                return false;
+            field.padBeg = pad.size() == 4 ? pad[axis] : At(pad, axis, 0);
+            field.padEnd = pad.size() == 4 ? pad[axis + 2] : field.padBeg;
+            return true;
+        }
+    };
+
+    namespace Detail
+    {
+        inline const LayerParam & TiledParam()
+        {
+            static LayerParam param;
+            return param;
+        }
+
+        inline Shape TiledPad(const Shape & pad, size_t padBeg, size_t padEnd)
+        {
+            size_t x0 = pad.empty() ? 0 : pad[pad.size() > 1 ? 1 : 0];
+            size_t x1 = pad.size() == 4 ? pad[3] : x0;
+            return Shape({ padBeg, x0, padEnd, x1 });
+        }
+    }
+
+    template <class T> class TiledLayer : public Synet::Layer<T>
+    {
+    public:
+        typedef T Type;
+        typedef Layer<T> Base;
+        typedef typename Base::Tensor Tensor;
+        typedef typename Base::TensorPtrs TensorPtrs;
+        typedef std::vector<Base*> LayerPtrs;
+        typedef Base * (*Creator)(const LayerParam & param);
+
+        TiledLayer()
+            : Base(Detail::TiledParam())
+        {
+        }
+
+        bool Init(const LayerPtrs & layers, const TensorPtrs & tensors, const TensorPtrs & buf, size_t cache, Creator create)
+        {
+            size_t count = layers.size();
+            _variants.clear();
+            _bands.clear();
+            _fields.resize(count);
+            _shapes.resize(count + 1);
+            _inplace.resize(count);
+            for (size_t l = 0; l <= count; ++l)
+                _shapes[l] = tensors[l]->Shape();
+            for (size_t l = 0; l < count; ++l)
+            {
+                if (!ReceptiveField::Get(layers[l]->Param(), _fields[l]))
+                    return false;
+                _inplace[l] = tensors[l] == tensors[l + 1];
+            }
+            size_t height = _shapes[count][2], rows = height;
+            while (rows > 1 && Bytes(rows) > cache)
+                rows = (rows + 1) / 2;
+            while (rows < height && Overhead(rows) > SYNET_TILE_OVERHEAD_MAX)
+                rows *= 2;
+            if (rows >= height)
+                return false;
+            std::map<Index, size_t> signatures;
+            std::vector<Index> ranges;
+            for (size_t y = 0; y < height; y += rows)
+            {
+                Band band;
+                Index signature;
+                Ranges(y, rows, ranges);
+                for (size_t l = 0; l <= count; ++l)
+                {
+                    signature.push_back(ranges[l][1] - ranges[l][0]);
+                    signature.push_back(ranges[l][2]);
+                    signature.push_back(ranges[l][3]);
+                }
+                band.srcBeg = ranges[0][0], band.srcEnd = ranges[0][1];
+                band.dstBeg = ranges[count][0], band.dstEnd = ranges[count][1];
+                std::map<Index, size_t>::const_iterator it = signatures.find(signature);
+                if (it == signatures.end())
+                {
+                    if (!AddVariant(layers, ranges, buf, create))
+                        return false;
+                    it = signatures.insert(std::make_pair(signature, _variants.size() - 1)).first;
+                }
+                band.variant = it->second;
+                _bands.push_back(band);
+            }
+            return true;
+        }
+
+        size_t Bands() const
+        {
+            return _bands.size();
+        }
+
+        virtual void Setup(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+        }
+
+        virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+        }
+
+    protected:
+        virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+            SYNET_PERF_FUNC();
+            for (size_t b = 0; b < _bands.size(); ++b)
+            {
+                const Band & band = _bands[b];
+                Variant & variant = _variants[band.variant];
+                CopyRows(*src[0], band.srcBeg, band.srcEnd - band.srcBeg, *variant.src[0][0], 0);
+                for (size_t l = 0; l < variant.layers.size(); ++l)
+                    variant.layers[l]->Forward(variant.src[l], buf, variant.dst[l]);
+                const Tensor & last = *variant.dst.back()[0];
+                CopyRows(last, 0, last.Axis(2), *dst[0], band.dstBeg);
+            }
+        }
+
+    private:
+        typedef std::shared_ptr<Base> LayerSharedPtr;
+        typedef std::shared_ptr<Tensor> TensorSharedPtr;
+
+        struct Band
+        {
+            size_t variant, srcBeg, srcEnd, dstBeg, dstEnd;
+        };
+
+        struct Variant
+        {
+            std::vector<std::shared_ptr<LayerParam>> params;
+            std::vector<LayerSharedPtr> layers;
+            std::vector<TensorSharedPtr> tensors;
+            std::vector<TensorPtrs> src, dst;
+        };
+
+        std::vector<ReceptiveField> _fields;
+        std::vector<Shape> _shapes;
+        std::vector<bool> _inplace;
+        std::vector<Variant> _variants;
+        std::vector<Band> _bands;
+
+        size_t Bytes(size_t rows) const
+        {
+            size_t bytes = 0;
+            for (size_t l = _fields.size(); l > 0; --l)
+            {
+                const Shape & shape = _shapes[l];
+                bytes += shape[0] * shape[1] * shape[3] * std::min(rows, shape[2]) * sizeof(Type);
+                rows = (rows - 1) * _fields[l - 1].stride + _fields[l - 1].kernel;
+            }
+            const Shape & shape = _shapes[0];
+            return bytes + shape[0] * shape[1] * shape[3] * std::min(rows, shape[2]) * sizeof(Type);
+        }
+
+        void Ranges(size_t y, size_t rows, std::vector<Index> & ranges) const
+        {
+            size_t count = _fields.size();
+            ranges.assign(count + 1, Index(4, 0));
+            ranges[count][0] = y, ranges[count][1] = std::min(y + rows, _shapes[count][2]);
+            for (size_t l = count; l > 0; --l)
+            {
+                Index & r = ranges[l - 1];
+                _fields[l - 1].Source(ranges[l][0], ranges[l][1], _shapes[l - 1][2], r[0], r[1], r[2], r[3]);
+            }
+        }
+
+        float Overhead(size_t rows) const
+        {
+            size_t count = _fields.size(), full = 0, tiled = 0;
+            std::vector<Index> ranges;
+            for (size_t y = 0; y < _shapes[count][2]; y += rows)
+            {
+                Ranges(y, rows, ranges);
+                for (size_t l = 1; l <= count; ++l)
+                    tiled += (ranges[l][1] - ranges[l][0]) * _shapes[l][1] * _shapes[l][3];
+            }
+            for (size_t l = 1; l <= count; ++l)
+                full += _shapes[l][2] * _shapes[l][1] * _shapes[l][3];
+            return float(tiled) / float(full);
+        }
+
+        bool AddVariant(const LayerPtrs & layers, const std::vector<Index> & ranges, const TensorPtrs & buf, Creator create)
+        {
+            _variants.push_back(Variant());
+            Variant & variant = _variants.back();
+            variant.tensors.push_back(TensorSharedPtr(new Tensor()));
+            const Shape & input = _shapes[0];
+            variant.tensors[0]->Reshape(Shape({ input[0], input[1], ranges[0][1] - ranges[0][0], input[3] }));
+            for (size_t l = 0; l < layers.size(); ++l)
+            {
+                std::shared_ptr<LayerParam> param(new LayerParam(layers[l]->Param()));
+                const Index & range = ranges[l];
+                if (param->type() == LayerTypeConvolution)
+                    param->convolution().pad() = Detail::TiledPad(param->convolution().pad(), range[2], range[3]);
+                if (param->type() == LayerTypePooling)
+                    param->pooling().pad() = Detail::TiledPad(param->pooling().pad(), range[2], range[3]);
+                LayerSharedPtr layer(create(*param));
+                if (!layer)
+                    return false;
+                layer->ShareWeight(*layers[l]);
+                if (!_inplace[l])
+                    variant.tensors.push_back(TensorSharedPtr(new Tensor()));
+                variant.src.push_back(TensorPtrs(1, variant.tensors[variant.tensors.size() - (_inplace[l] ? 1 : 2)].get()));
+                variant.dst.push_back(TensorPtrs(1, variant.tensors.back().get()));
+                layer->Setup(variant.src[l], buf, variant.dst[l]);
+                layer->Reshape(variant.src[l], buf, variant.dst[l]);
+                const Shape & dst = variant.dst[l][0]->Shape(), & full = _shapes[l + 1];
+                if (dst.size() != 4 || dst[0] != full[0] || dst[1] != full[1] || dst[2] != ranges[l + 1][1] - ranges[l + 1][0] || dst[3] != full[3])
+                    return false;
+                variant.params.push_back(param);
+                variant.layers.push_back(layer);
+            }
+            return true;
+        }
+
+        static void CopyRows(const Tensor & src, size_t srcRow, size_t rows, Tensor & dst, size_t dstRow)
+        {
+            size_t planes = src.Axis(0) * src.Axis(1), width = src.Axis(3);
+            size_t srcStride = src.Axis(2) * width, dstStride = dst.Axis(2) * width;
+            const Type * pSrc = src.CpuData() + srcRow * width;
+            Type * pDst = dst.CpuData() + dstRow * width;
+            for (size_t p = 0; p < planes; ++p, pSrc += srcStride, pDst += dstStride)
+                memcpy(pDst, pSrc, rows * width * sizeof(Type));
+        }
+    };
+}
@@ -26,6 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Math.h"
 
 namespace Synet
 {
@@ -37,42 +38,16 @@ namespace Synet
                 dst[i] = ::abs(src[i]);
         }
 
-        template <typename T> void CpuExp(const T * src, size_t size, T * dst)
-        {
-            for (size_t i = 0; i < size; ++i)
-                dst[i] = ::exp(src[i]);
-        }
-
-        template<class T> void CpuRsqrt(const T * src, size_t size, T * dst)
-        {
-            for (size_t i = 0; i < size; ++i)
-                dst[i] = 1.0f / sqrt(src[i]);
-        }
-
         template<class T> void CpuSqrt(const T * src, size_t size, T * dst)
         {
             for (size_t i = 0; i < size; ++i)
                 dst[i] = sqrt(src[i]);
         }
 
-        template <typename T> void CpuTanh(const T * src, size_t size, T * dst)
-        {
-            for (size_t i = 0; i < size; ++i)
-                dst[i] = ::tanh(src[i]);
-        }
-
         template <typename T> void CpuZero(const T * src, size_t size, T * dst)
         {
             ::memset(dst, 0, size * sizeof(T));
         }
-
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-        template <> SYNET_INLINE void CpuTanh<float>(const float * src, size_t size, float * dst)
-        {
-            float slope = 1.0f;
-            ::SimdNeuralTanh(src, size, &slope, dst);
-        }
-#endif
     }
 
     template <class T> class UnaryOperationLayer : public Synet::Layer<T>
@@ -96,16 +71,16 @@ namespace Synet
                 _func = Detail::CpuAbs;
                 break;
             case UnaryOperationTypeExp:
-                _func = Detail::CpuExp;
+                _func = CpuExp;
                 break;
             case UnaryOperationTypeRsqrt:
-                _func = Detail::CpuRsqrt;
+                _func = CpuRsqrt;
                 break;
             case UnaryOperationTypeSqrt:
                 _func = Detail::CpuSqrt;
                 break;
             case UnaryOperationTypeTanh:
-                _func = Detail::CpuTanh;
+                _func = CpuTanh;
                 break;
             case UnaryOperationTypeZero:
                 _func = Detail::CpuZero;
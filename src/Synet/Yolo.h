@@ -26,6 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Params.h"
+#include "Synet/Container.h"
 
 #if defined(SYNET_YOLO_ENABLE)
 
@@ -88,6 +89,9 @@ namespace Synet
 
             ::free_network(net);
 
+            if (dstWeightPath.empty())
+                return SaveContainer(holder, weight, dstModelPath);
+
             if (!holder.Save(dstModelPath, false))
                 return false;
 
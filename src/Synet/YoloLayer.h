@@ -26,6 +26,8 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Math.h"
+#include "Synet/Parallel.h"
 
 namespace Synet
 {
@@ -40,6 +42,8 @@ namespace Synet
 
         YoloLayer(const LayerParam & param)
             : Base(param)
+            , _decode(false)
+            , _threshold(0)
         {
         }
 
@@ -64,31 +68,56 @@ namespace Synet
             dst[0]->Reshape(dstShape);
         }
 
+        // Switches Forward to decoding mode: class sigmoids are computed only for cells whose
+        // objectness is above threshold and are zero in the output for the rest. GetRegions then
+        // must be called with the same or a higher threshold.
+        void SetThreshold(Type threshold)
+        {
+            _decode = true;
+            _threshold = threshold;
+        }
+
         void GetRegions(const TensorPtrs & src, size_t netW, size_t netH, Type threshold, Regions & dst) const
         {
             SYNET_PERF_FUNC();
             dst.clear();
-            size_t b = 0;
-            size_t layerW = src[0]->Axis(2);
-            size_t layerH = src[0]->Axis(3);
-            for (size_t y = 0; y < layerH; ++y)
+            if (_decode)
             {
-                for (size_t x = 0; x < layerW; ++x)
+                assert(threshold >= _threshold);
+                for (size_t i = 0; i < _regions.size(); ++i)
                 {
-                    for (size_t n = 0; n < _num; ++n)
+                    if (_regions[i].prob > threshold)
                     {
-                        Type objectness = src[0]->CpuData({ b, n*(_classes + 5) + 4, y, x })[0];
+                        dst.push_back(_regions[i]);
+                        dst.back().w /= netW;
+                        dst.back().h /= netH;
+                    }
+                }
+                return;
+            }
+            size_t layerW = src[0]->Axis(3);
+            size_t layerH = src[0]->Axis(2);
+            size_t area = layerW * layerH;
+            for (size_t n = 0; n < _num; ++n)
+            {
+                const Type * pSrc = src[0]->CpuData() + n * (_classes + 5) * area;
+                for (size_t y = 0; y < layerH; ++y)
+                {
+                    for (size_t x = 0; x < layerW; ++x)
+                    {
+                        size_t offset = y * layerW + x;
+                        Type objectness = pSrc[4 * area + offset];
                         if (objectness > threshold)
                         {
                             Region region;
-                            region.x = (x + src[0]->CpuData({ b, n*(_classes + 5) + 0, y, x })[0]) / layerW;
-                            region.y = (y + src[0]->CpuData({ b, n*(_classes + 5) + 1, y, x })[0]) / layerH;
-                            region.w = ::exp(src[0]->CpuData({ b, n*(_classes + 5) + 2, y, x })[0])*_anchors[2*_mask[n] + 0] / netW;
-                            region.h = ::exp(src[0]->CpuData({ b, n*(_classes + 5) + 3, y, x })[0])*_anchors[2*_mask[n] + 1] / netH;
+                            region.x = (x + pSrc[0 * area + offset]) / layerW;
+                            region.y = (y + pSrc[1 * area + offset]) / layerH;
+                            region.w = ::exp(pSrc[2 * area + offset])*_anchors[2*_mask[n] + 0] / netW;
+                            region.h = ::exp(pSrc[3 * area + offset])*_anchors[2*_mask[n] + 1] / netH;
                             for (size_t i = 0; i < _classes; ++i)
                             {
                                 region.id = i;
-                                region.prob = objectness*src[0]->CpuData({ b, n*(_classes + 5) + 5 + i, y, x })[0];
+                                region.prob = objectness*pSrc[(5 + i) * area + offset];
                                 if (region.prob > threshold)
                                     dst.push_back(region);
                             }
@@ -103,18 +132,68 @@ namespace Synet
         {
             SYNET_PERF_FUNC();
             size_t batch = src[0]->Axis(0);
-            size_t area = src[0]->Axis(2)*src[0]->Axis(3);
-            Index index(4, 0);
-            for (index[0] = 0; index[0] < batch; ++index[0])
+            size_t height = src[0]->Axis(2), width = src[0]->Axis(3);
+            size_t size = batch * _num * height;
+            size_t threads = dst[0]->Size() < 0x10000 ? 1 : GetThreadNumber();
+            _buffers.resize(threads);
+            for (size_t t = 0; t < threads; ++t)
+                _buffers[t].clear();
+            const Type * pSrc = src[0]->CpuData();
+            Type * pDst = dst[0]->CpuData();
+            Parallel(0, size, [&](size_t thread, size_t begin, size_t end)
             {
-                for (size_t n = 0; n < _num; ++n)
+                for (size_t i = begin; i < end;)
                 {
-                    index[1] = n*(_classes + 4 + 1);
-                    CpuSigmoid(src[0]->CpuData(index), 2 * area, dst[0]->CpuData(index));
-                    index[1] += 2;
-                    CpuCopy(src[0]->CpuData(index), 2 * area, dst[0]->CpuData(index));
-                    index[1] += 2;
-                    CpuSigmoid(src[0]->CpuData(index), (_classes + 1) * area, dst[0]->CpuData(index));
+                    size_t plane = i / height, y = i % height, rows = std::min(height - y, end - i);
+                    size_t b = plane / _num, n = plane % _num, offset = plane * (_classes + 5) * height * width + y * width;
+                    ForwardRows(pSrc + offset, height, width, y, rows, n, b == 0, pDst + offset, _buffers[thread]);
+                    i += rows;
+                }
+            }, threads);
+            _regions.clear();
+            for (size_t t = 0; t < threads; ++t)
+                _regions.insert(_regions.end(), _buffers[t].begin(), _buffers[t].end());
+        }
+
+        void ForwardRows(const Type * src, size_t height, size_t width, size_t y, size_t rows, size_t n, bool emit, Type * dst, Regions & regions)
+        {
+            size_t area = height * width, size = rows * width;
+            CpuSigmoid(src + 0 * area, size, dst + 0 * area);
+            CpuSigmoid(src + 1 * area, size, dst + 1 * area);
+            CpuCopy(src + 2 * area, size, dst + 2 * area);
+            CpuCopy(src + 3 * area, size, dst + 3 * area);
+            if (!_decode)
+            {
+                for (size_t c = 4; c < _classes + 5; ++c)
+                    CpuSigmoid(src + c * area, size, dst + c * area);
+                return;
+            }
+            CpuSigmoid(src + 4 * area, size, dst + 4 * area);
+            for (size_t c = 5; c < _classes + 5; ++c)
+                CpuSet(size, Type(0), dst + c * area);
+            Region region;
+            for (size_t i = 0; i < size; ++i)
+            {
+                Type objectness = dst[4 * area + i];
+                if (objectness <= _threshold)
+                    continue;
+                if (emit)
+                {
+                    region.x = (i % width + dst[0 * area + i]) / width;
+                    region.y = (y + i / width + dst[1 * area + i]) / height;
+                    region.w = ::exp(dst[2 * area + i]) * _anchors[2 * _mask[n] + 0];
+                    region.h = ::exp(dst[3 * area + i]) * _anchors[2 * _mask[n] + 1];
+                }
+                for (size_t c = 0; c < _classes; ++c)
+                {
+                    Type prob = CpuSigmoid(src[(5 + c) * area + i]);
+                    dst[(5 + c) * area + i] = prob;
+                    region.prob = objectness * prob;
+                    if (emit && region.prob > _threshold)
+                    {
+                        region.id = c;
+                        regions.push_back(region);
+                    }
                 }
             }
         }
@@ -126,5 +205,9 @@ namespace Synet
         size_t _total, _num, _classes;
         VectorF _anchors;
         VectorI _mask;
+        bool _decode;
+        Type _threshold;
+        Regions _regions;
+        std::vector<Regions> _buffers;
     };
 }
\ No newline at end of file
@@ -26,8 +26,17 @@
 
 int main(int argc, char* argv[])
 {
-    //Test::TestParam();
-    Test::TestParams();
+    bool result = true;
+    //result = Test::TestParam() && result;
+    result = Test::TestParams() && result;
+    result = Test::TestMath() && result;
+    result = Test::TestTensor() && result;
+    result = Test::TestHalf() && result;
+    result = Test::TestPermute() && result;
+    result = Test::TestPooling() && result;
+    result = Test::TestDetectionOutput() && result;
+    result = Test::TestImage() && result;
+    result = Test::TestNetwork() && result;
 
 
     //Synet::NetworkParam netParam;
@@ -36,6 +45,7 @@ int main(int argc, char* argv[])
 
 
 
-    return 0;
+    std::cout << (result ? "All tests passed." : "Some tests failed!") << std::endl;
+    return result ? 0 : 1;
 }
 
@@ -30,7 +30,25 @@ namespace Test
 {
     typedef Synet::String String;
 
+    inline String ToString(const Synet::Shape & shape)
+    {
+        std::stringstream ss;
+        ss << "{";
+        for (size_t i = 0; i < shape.size(); ++i)
+            ss << (i ? " " : "") << shape[i];
+        ss << "}";
+        return ss.str();
+    }
+
     bool TestParam();
     bool TestParams();
+    bool TestMath();
+    bool TestTensor();
+    bool TestHalf();
+    bool TestPermute();
+    bool TestPooling();
+    bool TestDetectionOutput();
+    bool TestImage();
+    bool TestNetwork();
 }
 
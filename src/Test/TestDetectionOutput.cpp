@@ -0,0 +1,68 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    bool TestDetectionOutput()
+    {
+        const size_t priors = 6;
+        const float box[priors][4] = {
+            { 1.1f, 0.2f, 1.3f, 0.4f }, { 1.2f, 0.2f, 1.4f, 0.4f }, { 0.1f, -0.3f, 0.2f, -0.1f },
+            { 1.1f, 0.2f, 1.3f, 0.4f }, { 0.3f, 0.3f, 0.6f, 0.6f }, { 0.31f, 0.3f, 0.61f, 0.6f } };
+        const float score[priors] = { 0.9f, 0.8f, 0.7f, 0.6f, 0.85f, 0.75f };
+
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypeDetectionOutput;
+        param.detectionOutput().numClasses() = 2;
+        param.detectionOutput().clip() = true;
+        param.detectionOutput().confidenceThreshold() = 0.01f;
+        param.detectionOutput().nms().nmsThreshold() = 0.45f;
+        Synet::DetectionOutputLayer<float> layer(param);
+
+        Synet::Tensor<float> loc(Synet::Shape({ 1, priors * 4 }), 0.0f), conf(Synet::Shape({ 1, priors * 2 })),
+            prior(Synet::Shape({ 1, 2, priors * 4 }), 0.1f), dst;
+        for (size_t p = 0; p < priors; ++p)
+        {
+            conf.CpuData()[p * 2 + 0] = 1.0f - score[p];
+            conf.CpuData()[p * 2 + 1] = score[p];
+            for (size_t k = 0; k < 4; ++k)
+                prior.CpuData()[p * 4 + k] = box[p][k];
+        }
+        Synet::Layer<float>::TensorPtrs s({ &loc, &conf, &prior }), b, d(1, &dst);
+        layer.Setup(s, b, d);
+        layer.Reshape(s, b, d);
+        layer.Forward(s, b, d);
+
+        // Boxes clipped to a zero-area edge never overlap, so all four of them are kept;
+        // of the two real boxes the weaker one is suppressed.
+        const float expected[] = { 0.9f, 0.85f, 0.8f, 0.7f, 0.6f };
+        bool result = dst.Axis(2) == 5;
+        for (size_t i = 0; i < 5 && result; ++i)
+            result = dst.CpuData()[i * 7 + 2] == expected[i];
+        std::cout << "DetectionOutput test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+}
@@ -0,0 +1,191 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    typedef Synet::Layer<float> Layer;
+    typedef Synet::Tensor<float> Tensor;
+
+    static bool TestHalfValue(float value, Synet::TensorType type, uint16_t control, const String & name)
+    {
+        uint16_t half;
+        Synet::CpuFloatToHalf(&value, 1, type, &half);
+        if (half != control)
+            std::cout << name << " " << value << ": " << std::hex << half << " instead of " << control << std::dec << std::endl;
+        return half == control;
+    }
+
+    static bool TestHalfRoundTrip(Synet::TensorType type, const String & name)
+    {
+        uint16_t src[0x10000], dst[0x10000];
+        float tmp[0x10000];
+        for (size_t i = 0; i < 0x10000; ++i)
+            src[i] = uint16_t(i);
+        Synet::CpuHalfToFloat(src, 0x10000, type, tmp);
+        Synet::CpuFloatToHalf(tmp, 0x10000, type, dst);
+        for (size_t i = 0; i < 0x10000; ++i)
+        {
+            if (tmp[i] != tmp[i] ? dst[i] == src[i] || (dst[i] & 0x7FFF) > (type == Synet::TensorType16f ? 0x7C00 : 0x7F80) : dst[i] == src[i])
+                continue;
+            std::cout << name << " round trip of " << std::hex << src[i] << " gives " << dst[i] << std::dec << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool TestHalfLayer(const Synet::LayerParam & param, const Synet::Shape & shape, const String & name)
+    {
+        Synet::LayerParam packed = param;
+        packed.weight()[0].type() = Synet::TensorType16f;
+        std::vector<uint8_t> fp32, fp16;
+        for (size_t i = 0; i < param.weight().size(); ++i)
+        {
+            size_t size = 1;
+            for (size_t j = 0; j < param.weight()[i].dim().size(); ++j)
+                size *= param.weight()[i].dim()[j];
+            Synet::Floats value(size);
+            for (size_t j = 0; j < size; ++j)
+                value[j] = float(int(j * 7 % 17) - 8) / 16.0f;
+            fp32.insert(fp32.end(), (uint8_t*)value.data(), (uint8_t*)(value.data() + size));
+            if (i == 0)
+            {
+                Synet::Halfs half(size);
+                Synet::CpuFloatToHalf(value.data(), size, Synet::TensorType16f, half.data());
+                fp16.insert(fp16.end(), (uint8_t*)half.data(), (uint8_t*)(half.data() + size));
+            }
+            else
+                fp16.insert(fp16.end(), (uint8_t*)value.data(), (uint8_t*)(value.data() + size));
+        }
+        Tensor src(shape), dst[3], buf[3][2];
+        for (size_t i = 0; i < src.Size(); ++i)
+            src.CpuData()[i] = float(int(i * 5 % 13) - 6) / 8.0f;
+        std::shared_ptr<Layer> layers[3];
+        if (param.type() == Synet::LayerTypeConvolution)
+        {
+            layers[0].reset(new Synet::ConvolutionLayer<float>(param));
+            layers[1].reset(new Synet::ConvolutionLayer<float>(packed));
+            layers[2].reset(new Synet::ConvolutionLayer<float>(packed));
+        }
+        else
+        {
+            layers[0].reset(new Synet::InnerProductLayer<float>(param));
+            layers[1].reset(new Synet::InnerProductLayer<float>(packed));
+            layers[2].reset(new Synet::InnerProductLayer<float>(packed));
+        }
+        for (size_t l = 0; l < 2; ++l)
+        {
+            const void * data = l ? fp16.data() : fp32.data();
+            size_t size = l ? fp16.size() : fp32.size();
+            Layer::TensorPtrs s(1, &src), b({ &buf[l][0], &buf[l][1] }), d(1, &dst[l]);
+            if (!layers[l]->Load(data, size) || size != 0)
+                return false;
+            layers[l]->Setup(s, b, d);
+            layers[l]->Reshape(s, b, d);
+            layers[l]->Forward(s, b, d);
+        }
+        {
+            Layer::TensorPtrs s(1, &src), b({ &buf[2][0], &buf[2][1] }), d(1, &dst[2]);
+            layers[2]->ShareWeight(*layers[1]);
+            layers[2]->Setup(s, b, d);
+            layers[2]->Reshape(s, b, d);
+            layers[2]->Forward(s, b, d);
+        }
+        if (dst[2].Shape() != dst[1].Shape() || memcmp(dst[2].CpuData(), dst[1].CpuData(), dst[1].Size() * sizeof(float)) != 0)
+        {
+            std::cout << name << ": layer with shared weights gives another result!" << std::endl;
+            return false;
+        }
+        double error = 0;
+        for (size_t i = 0; i < dst[0].Size(); ++i)
+            error = std::max(error, ::fabs(double(dst[0].CpuData()[i]) - dst[1].CpuData()[i]) / std::max(::fabs(double(dst[0].CpuData()[i])), 1.0));
+        std::cout << name << " error: " << error << std::endl;
+        return dst[0].Shape() == dst[1].Shape() && error <= 1.0e-6;
+    }
+
+    static Synet::LayerParam Convolution(size_t srcC, size_t dstC, size_t kernel, size_t group)
+    {
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypeConvolution;
+        param.convolution().outputNum() = (uint32_t)dstC;
+        param.convolution().kernel() = Synet::Shape({ kernel, kernel });
+        param.convolution().pad() = Synet::Shape({ kernel / 2 });
+        param.convolution().group() = (uint32_t)group;
+        param.weight().resize(2);
+        param.weight()[0].dim() = Synet::Shape({ dstC, srcC / group, kernel, kernel });
+        param.weight()[1].dim() = Synet::Shape({ dstC });
+        return param;
+    }
+
+    static Synet::LayerParam InnerProduct(size_t K, size_t N, bool transposeB)
+    {
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypeInnerProduct;
+        param.innerProduct().outputNum() = (uint32_t)N;
+        param.innerProduct().transposeB() = transposeB;
+        param.weight().resize(2);
+        param.weight()[0].dim() = transposeB ? Synet::Shape({ K, N }) : Synet::Shape({ N, K });
+        param.weight()[1].dim() = Synet::Shape({ N });
+        return param;
+    }
+
+    bool TestHalf()
+    {
+        const Synet::TensorType f16 = Synet::TensorType16f, b16 = Synet::TensorType16b;
+        const float inf = std::numeric_limits<float>::infinity(), nan = std::numeric_limits<float>::quiet_NaN();
+        bool result = true;
+        result = result && TestHalfValue(1.0f, f16, 0x3C00, "Fp16");
+        result = result && TestHalfValue(-2.0f, f16, 0xC000, "Fp16");
+        result = result && TestHalfValue(-0.0f, f16, 0x8000, "Fp16");
+        result = result && TestHalfValue(65504.0f, f16, 0x7BFF, "Fp16");
+        result = result && TestHalfValue(65520.0f, f16, 0x7C00, "Fp16");
+        result = result && TestHalfValue(1.0e6f, f16, 0x7C00, "Fp16");
+        result = result && TestHalfValue(inf, f16, 0x7C00, "Fp16");
+        result = result && TestHalfValue(-inf, f16, 0xFC00, "Fp16");
+        result = result && TestHalfValue(nan, f16, 0x7E00, "Fp16");
+        result = result && TestHalfValue(1.0f + ::ldexpf(1.0f, -11), f16, 0x3C00, "Fp16");
+        result = result && TestHalfValue(1.0f + ::ldexpf(3.0f, -11), f16, 0x3C02, "Fp16");
+        result = result && TestHalfValue(::ldexpf(1.0f, -14), f16, 0x0400, "Fp16");
+        result = result && TestHalfValue(::ldexpf(1.0f, -15), f16, 0x0200, "Fp16");
+        result = result && TestHalfValue(::ldexpf(1.0f, -24), f16, 0x0001, "Fp16");
+        result = result && TestHalfValue(::ldexpf(1.0f, -25), f16, 0x0000, "Fp16");
+        result = result && TestHalfValue(::ldexpf(3.0f, -25), f16, 0x0002, "Fp16");
+        result = result && TestHalfValue(1.0f, b16, 0x3F80, "Bf16");
+        result = result && TestHalfValue(1.0f + ::ldexpf(1.0f, -8), b16, 0x3F80, "Bf16");
+        result = result && TestHalfValue(1.0f + ::ldexpf(3.0f, -8), b16, 0x3F82, "Bf16");
+        result = result && TestHalfValue(inf, b16, 0x7F80, "Bf16");
+        result = result && TestHalfValue(-inf, b16, 0xFF80, "Bf16");
+        result = result && TestHalfValue(::ldexpf(1.0f, -133), b16, 0x0001, "Bf16");
+        result = result && TestHalfRoundTrip(f16, "Fp16");
+        result = result && TestHalfRoundTrip(b16, "Bf16");
+        result = result && TestHalfLayer(Convolution(64, 64, 3, 1), Synet::Shape({ 2, 64, 12, 12 }), "Fp16 convolution");
+        result = result && TestHalfLayer(Convolution(64, 48, 3, 2), Synet::Shape({ 1, 64, 9, 7 }), "Fp16 group convolution");
+        result = result && TestHalfLayer(InnerProduct(4096, 10, false), Synet::Shape({ 3, 4096 }), "Fp16 inner product");
+        result = result && TestHalfLayer(InnerProduct(4096, 10, true), Synet::Shape({ 3, 4096 }), "Fp16 transposed inner product");
+        result = result && TestHalfLayer(InnerProduct(4096, 10, false), Synet::Shape({ 1, 4096 }), "Fp16 vector inner product");
+        return result;
+    }
+}
@@ -0,0 +1,194 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    struct ImageAxis
+    {
+        size_t i0, i1;
+        float alpha;
+
+        ImageAxis(size_t i, size_t srcSize, size_t dstSize)
+        {
+            float pos = std::max((i + 0.5f) * srcSize / dstSize - 0.5f, 0.0f);
+            i0 = std::min(size_t(pos), srcSize - 1);
+            i1 = std::min(i0 + 1, srcSize - 1);
+            alpha = std::min(pos - i0, 1.0f);
+        }
+    };
+
+    static void ImagePixel(const std::vector<uint8_t> & image, size_t width, size_t height, size_t stride,
+        Synet::ImageFormatType format, size_t x, size_t y, size_t cx, float * yuv)
+    {
+        const uint8_t * row = image.data() + y * stride;
+        switch (format)
+        {
+        case Synet::ImageFormatTypeGray:
+            yuv[0] = yuv[1] = yuv[2] = row[x];
+            break;
+        case Synet::ImageFormatTypeBgr:
+        case Synet::ImageFormatTypeRgb:
+            for (size_t c = 0; c < 3; ++c)
+                yuv[c] = row[x * 3 + c];
+            break;
+        case Synet::ImageFormatTypeBgra:
+            for (size_t c = 0; c < 3; ++c)
+                yuv[c] = row[x * 4 + c];
+            break;
+        case Synet::ImageFormatTypeNv12:
+            yuv[0] = row[x];
+            yuv[1] = image[(height + y / 2) * stride + (cx & ~size_t(1)) + 0];
+            yuv[2] = image[(height + y / 2) * stride + (cx & ~size_t(1)) + 1];
+            break;
+        default:
+            assert(0);
+        }
+    }
+
+    static void ImageToBgr(Synet::ImageFormatType format, const float * src, float * bgr)
+    {
+        if (format == Synet::ImageFormatTypeRgb)
+        {
+            bgr[0] = src[2], bgr[1] = src[1], bgr[2] = src[0];
+        }
+        else if (format == Synet::ImageFormatTypeNv12)
+        {
+            float y = 1.164f * (src[0] - 16.0f), u = src[1] - 128.0f, v = src[2] - 128.0f;
+            bgr[0] = y + 2.018f * u;
+            bgr[1] = y - 0.391f * u - 0.813f * v;
+            bgr[2] = y + 1.596f * v;
+        }
+        else
+        {
+            bgr[0] = src[0], bgr[1] = src[1], bgr[2] = src[2];
+        }
+    }
+
+    static float ImageFromBgr(const Synet::InputParam & param, const float * bgr, size_t c)
+    {
+        float value;
+        switch (param.format())
+        {
+        case Synet::ImageFormatTypeGray: value = 0.114f * bgr[0] + 0.587f * bgr[1] + 0.299f * bgr[2]; break;
+        case Synet::ImageFormatTypeRgb: value = bgr[2 - c]; break;
+        default: value = bgr[c];
+        }
+        float mean = param.mean().empty() ? 0.0f : param.mean()[std::min(c, param.mean().size() - 1)];
+        float scale = param.scale().empty() ? 1.0f : param.scale()[std::min(c, param.scale().size() - 1)];
+        return (value - mean) * scale;
+    }
+
+    static bool TestImage(const Synet::InputParam & param, Synet::ImageFormatType format, size_t srcW, size_t srcH,
+        size_t dstW, size_t dstH, Synet::ImageConverter & converter)
+    {
+        size_t channels = param.format() == Synet::ImageFormatTypeGray ? 1 : 3;
+        size_t bytes = format == Synet::ImageFormatTypeBgra ? 4 : (format == Synet::ImageFormatTypeBgr || format == Synet::ImageFormatTypeRgb ? 3 : 1);
+        size_t stride = srcW * bytes + std::rand() % 5;
+        std::vector<uint8_t> image(stride * (format == Synet::ImageFormatTypeNv12 ? srcH * 3 / 2 : srcH));
+        for (size_t i = 0; i < image.size(); ++i)
+            image[i] = uint8_t(std::rand());
+        Synet::Floats dst(channels * dstH * dstW);
+        if (!converter.Init(param, srcW, srcH, format, channels, dstH, dstW))
+        {
+            std::cout << "Image converter can't init " << srcW << "x" << srcH << " to " << dstW << "x" << dstH << " !" << std::endl;
+            return false;
+        }
+        converter.Convert(image.data(), stride, dst.data());
+
+        size_t w = dstW, h = dstH, x0 = 0, y0 = 0;
+        if (param.letterbox())
+        {
+            float scale = std::min(float(dstW) / srcW, float(dstH) / srcH);
+            w = std::max<size_t>(std::min<size_t>(size_t(srcW * scale + 0.5f), dstW), 1);
+            h = std::max<size_t>(std::min<size_t>(size_t(srcH * scale + 0.5f), dstH), 1);
+            x0 = (dstW - w) / 2;
+            y0 = (dstH - h) / 2;
+        }
+        for (size_t y = 0; y < dstH; ++y)
+        {
+            for (size_t x = 0; x < dstW; ++x)
+            {
+                float value[3] = { 128.0f, 128.0f, 128.0f }, bgr[3];
+                if (y >= y0 && y < y0 + h && x >= x0 && x < x0 + w)
+                {
+                    ImageAxis ax(x - x0, srcW, w), ay(y - y0, srcH, h);
+                    float p00[3], p01[3], p10[3], p11[3];
+                    ImagePixel(image, srcW, srcH, stride, format, ax.i0, ay.i0, ax.i0, p00);
+                    ImagePixel(image, srcW, srcH, stride, format, ax.i1, ay.i0, ax.i0, p01);
+                    ImagePixel(image, srcW, srcH, stride, format, ax.i0, ay.i1, ax.i0, p10);
+                    ImagePixel(image, srcW, srcH, stride, format, ax.i1, ay.i1, ax.i0, p11);
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        float top = p00[c] + (p01[c] - p00[c]) * ax.alpha;
+                        float bottom = p10[c] + (p11[c] - p10[c]) * ax.alpha;
+                        value[c] = top + (bottom - top) * ay.alpha;
+                    }
+                }
+                ImageToBgr(format, value, bgr);
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    float expected = ImageFromBgr(param, bgr, c), actual = dst[(c * dstH + y) * dstW + x];
+                    if (::fabs(actual - expected) > 0.001f * std::max(::fabs(expected), 1.0f))
+                    {
+                        std::cout << "Image " << Synet::ValueToString(format) << " " << srcW << "x" << srcH << " to "
+                            << Synet::ValueToString(param.format()) << " " << dstW << "x" << dstH << (param.letterbox() ? " letterbox" : "")
+                            << " error at [" << c << ", " << y << ", " << x << "]: " << actual << " instead of " << expected << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool TestImage()
+    {
+        const Synet::ImageFormatType srcFormats[] = { Synet::ImageFormatTypeGray, Synet::ImageFormatTypeBgr,
+            Synet::ImageFormatTypeBgra, Synet::ImageFormatTypeRgb, Synet::ImageFormatTypeNv12 };
+        const Synet::ImageFormatType dstFormats[] = { Synet::ImageFormatTypeGray, Synet::ImageFormatTypeBgr, Synet::ImageFormatTypeRgb };
+        std::srand(0);
+        Synet::ImageConverter converter;
+        bool result = true;
+        for (size_t n = 0; n < 300 && result; ++n)
+        {
+            Synet::InputParam param;
+            param.format() = dstFormats[std::rand() % 3];
+            param.letterbox() = n % 2 == 1;
+            if (n % 3)
+            {
+                param.mean() = Synet::Floats({ 104.0f, 117.0f, 123.0f });
+                param.scale() = Synet::Floats(1, 1.0f / 58.0f);
+            }
+            Synet::ImageFormatType format = srcFormats[std::rand() % 5];
+            size_t limit = n % 16 == 0 ? 200 : 40;
+            size_t srcW = 2 + 2 * (std::rand() % (limit / 2)), srcH = 2 + 2 * (std::rand() % (limit / 2));
+            size_t dstW = 1 + std::rand() % limit, dstH = 1 + std::rand() % limit;
+            result = TestImage(param, format, srcW, srcH, dstW, dstH, converter);
+        }
+        std::cout << "Image test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+}
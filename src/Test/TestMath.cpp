@@ -0,0 +1,102 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    typedef void(*MathFuncPtr)(const float * src, size_t size, float * dst);
+
+    static bool TestMathFunc(MathFuncPtr func, double(*control)(double), float lo, float hi, double threshold, const String & name)
+    {
+        const size_t size = 1 << 16;
+        std::vector<float> src(size), dst(size);
+        for (size_t i = 0; i < size; ++i)
+            src[i] = lo + (hi - lo) * float(i) / float(size - 1);
+        func(src.data(), size, dst.data());
+        double error = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            double value = control(src[i]);
+            error = std::max(error, ::fabs(dst[i] - value) / std::max(::fabs(value), 1.0e-3));
+        }
+        std::cout << name << " error: " << error << std::endl;
+        return error <= threshold;
+    }
+
+    static double Rsqrt(double value) { return 1.0 / ::sqrt(value); }
+    static double Sigmoid(double value) { return 1.0 / (1.0 + ::exp(-value)); }
+    static double Pow(double value) { return ::pow(value, -0.75); }
+    static void CpuPow(const float * src, size_t size, float * dst) { Synet::CpuPow<float>(src, size, -0.75f, dst); }
+    static double Square(double value) { return value * value; }
+    static void CpuSquare(const float * src, size_t size, float * dst) { Synet::CpuPow<float>(src, size, 2.0f, dst); }
+    static double Cube(double value) { return ::pow(value, -3.0); }
+    static void CpuCube(const float * src, size_t size, float * dst) { Synet::CpuPow<float>(src, size, -3.0f, dst); }
+
+    static bool TestMathValue(float value, float control, const String & name)
+    {
+        bool equal = value == control || (value != value && control != control) || ::fabs(value - control) <= ::fabs(control) * 1.0e-6f;
+        if (!equal)
+            std::cout << name << ": " << value << " instead of " << control << std::endl;
+        return equal;
+    }
+
+    static bool TestMathSpecial()
+    {
+        const float inf = std::numeric_limits<float>::infinity(), nan = std::numeric_limits<float>::quiet_NaN();
+        float exp[6] = { nan, 100.0f, 88.5f, -100.0f, inf, -inf }, pow[5] = { -2.0f, -0.5f, 0.0f, 3.0f, -0.0f }, dst[6];
+        bool result = true;
+        Synet::CpuExp<float>(exp, 6, dst);
+        for (size_t i = 0; i < 6; ++i)
+            result = TestMathValue(dst[i], ::expf(exp[i]), "Exp special") && result;
+        float exponents[5] = { 2.0f, 3.0f, -1.0f, 0.5f, 0.0f };
+        for (size_t e = 0; e < 5; ++e)
+        {
+            Synet::CpuPow<float>(pow, 5, exponents[e], dst);
+            for (size_t i = 0; i < 5; ++i)
+                result = TestMathValue(dst[i], ::powf(pow[i], exponents[e]), "Pow special") && result;
+        }
+        return result;
+    }
+
+    bool TestMath()
+    {
+#ifdef SYNET_FAST_MATH_ENABLE
+        const double threshold = 1.0e-4;
+#else
+        const double threshold = 1.0e-6;
+#endif
+        bool result = true;
+        result = result && TestMathFunc(Synet::CpuExp<float>, ::exp, -80.0f, 80.0f, threshold, "Exp");
+        result = result && TestMathFunc(Synet::CpuSigmoid<float>, Sigmoid, -20.0f, 20.0f, threshold, "Sigmoid");
+        result = result && TestMathFunc(Synet::CpuTanh<float>, ::tanh, -10.0f, 10.0f, threshold, "Tanh");
+        result = result && TestMathFunc(Synet::CpuRsqrt<float>, Rsqrt, 0.001f, 1000.0f, threshold, "Rsqrt");
+        result = result && TestMathFunc(CpuPow, Pow, 0.01f, 100.0f, threshold * 4, "Pow");
+        result = result && TestMathFunc(CpuSquare, Square, -100.0f, 100.0f, threshold, "Pow 2");
+        result = result && TestMathFunc(CpuCube, Cube, -10.0f, -0.1f, threshold * 8, "Pow -3");
+        result = result && TestMathSpecial();
+        return result;
+    }
+}
@@ -0,0 +1,864 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    typedef Synet::Network<float> Network;
+    typedef std::vector<Synet::Tensor<float>> Tensors;
+
+    static Synet::LayerParam & AddLayer(Synet::NetworkParamHolder & holder, Synet::LayerType type, const String & name, const Synet::Strings & src)
+    {
+        holder().layers().push_back(Synet::LayerParam());
+        Synet::LayerParam & layer = holder().layers().back();
+        layer.type() = type;
+        layer.name() = name;
+        layer.src() = src;
+        layer.dst() = Synet::Strings(1, name);
+        return layer;
+    }
+
+    static void AddInput(Synet::NetworkParamHolder & holder, const String & name, const Synet::Shape & shape)
+    {
+        Synet::LayerParam & layer = AddLayer(holder, Synet::LayerTypeInput, name, Synet::Strings());
+        layer.input().shape().resize(1);
+        layer.input().shape()[0].dim() = shape;
+    }
+
+    static void AddConvolution(Synet::NetworkParamHolder & holder, const String & name, const String & src,
+        size_t srcC, size_t dstC, size_t kernel, size_t stride, Tensors & weight)
+    {
+        Synet::LayerParam & layer = AddLayer(holder, Synet::LayerTypeConvolution, name, Synet::Strings(1, src));
+        layer.convolution().outputNum() = (uint32_t)dstC;
+        layer.convolution().kernel() = Synet::Shape({ kernel });
+        layer.convolution().pad() = Synet::Shape({ kernel / 2 });
+        layer.convolution().stride() = Synet::Shape({ stride });
+        layer.weight().resize(2);
+        layer.weight()[0].dim() = Synet::Shape({ dstC, srcC, kernel, kernel });
+        layer.weight()[1].dim() = Synet::Shape({ dstC });
+        for (size_t i = 0; i < 2; ++i)
+        {
+            weight.push_back(Synet::Tensor<float>(layer.weight()[i].dim()));
+            for (size_t j = 0; j < weight.back().Size(); ++j)
+                weight.back().CpuData()[j] = float(std::rand() % 201 - 100) / 400.0f;
+        }
+    }
+
+    static bool SaveModel(const Synet::NetworkParamHolder & holder, const Tensors & weight, const String & param, const String & bin)
+    {
+        if (!holder.Save(param, false))
+            return false;
+        std::ofstream ofs(bin.c_str(), std::ofstream::binary);
+        for (size_t i = 0; i < weight.size(); ++i)
+            ofs.write((const char*)weight[i].CpuData(), weight[i].Size() * sizeof(float));
+        return (bool)ofs;
+    }
+
+    static void SetInput(Network & network, size_t seed)
+    {
+        std::srand((unsigned)seed);
+        for (size_t i = 0; i < network.Src().size(); ++i)
+        {
+            Synet::Tensor<float> & src = *network.Src()[i];
+            for (size_t j = 0; j < src.Size(); ++j)
+                src.CpuData()[j] = float(std::rand() % 201 - 100) / 100.0f;
+        }
+    }
+
+    static bool Compare(const Synet::Tensor<float> & a, const Synet::Tensor<float> & b, float threshold, const String & name)
+    {
+        if (a.Shape() != b.Shape())
+        {
+            std::cout << name << ": output shapes differ!" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < a.Size(); ++i)
+        {
+            if (::fabs(a.CpuData()[i] - b.CpuData()[i]) > threshold * std::max(::fabs(b.CpuData()[i]), 1.0f))
+            {
+                std::cout << name << " error at " << i << ": " << a.CpuData()[i] << " instead of " << b.CpuData()[i] << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //---------------------------------------------------------------------
+
+    static bool TestContainer()
+    {
+        std::srand(0);
+        Synet::NetworkParamHolder holder;
+        Tensors weight;
+        AddInput(holder, "data", Synet::Shape({ 1, 3, 16, 16 }));
+        AddConvolution(holder, "conv1", "data", 3, 8, 3, 1, weight);
+        AddLayer(holder, Synet::LayerTypeRelu, "relu1", Synet::Strings(1, "conv1"));
+        AddConvolution(holder, "conv2", "relu1", 8, 4, 1, 2, weight);
+        if (!SaveModel(holder, weight, "_test_container.xml", "_test_container.bin") ||
+            !Synet::SaveContainer(holder, weight, "_test_container.synet"))
+            return false;
+
+        Network original, container, mapped;
+        bool result = original.Load("_test_container.xml", "_test_container.bin") &&
+            container.Load("_test_container.synet", String(), false) && mapped.Load("_test_container.synet");
+        if (result)
+        {
+            SetInput(original, 1);
+            SetInput(container, 1);
+            SetInput(mapped, 1);
+            original.Forward();
+            container.Forward();
+            mapped.Forward();
+            result = Compare(*container.Dst()[0], *original.Dst()[0], 0.0f, "Container") &&
+                Compare(*mapped.Dst()[0], *original.Dst()[0], 0.0f, "Mapped container");
+        }
+
+        std::ifstream ifs("_test_container.synet", std::ifstream::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        ifs.close();
+        Synet::ContainerReader reader;
+        result = result && reader.Open(data.data(), data.size());
+        Synet::Detail::ContainerHeader * header = (Synet::Detail::ContainerHeader*)data.data();
+        Synet::Detail::ContainerSection * section = (Synet::Detail::ContainerSection*)(data.data() + header->tocOffset);
+        section[1].offset = uint64_t(-64);
+        result = result && !reader.Open(data.data(), data.size());
+        section[1].offset = 0;
+        header->tocSize = uint64_t(-1) / sizeof(Synet::Detail::ContainerSection) + 2;
+        result = result && !reader.Open(data.data(), data.size());
+
+        std::remove("_test_container.xml");
+        std::remove("_test_container.bin");
+        std::remove("_test_container.synet");
+        std::cout << "Container test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static bool TestCacheForward(const String & cache, const Tensors & weight, const Synet::Tensor<float> & control, const String & name)
+    {
+        Synet::NetworkParamHolder holder;
+        Tensors unused;
+        AddInput(holder, "data", Synet::Shape({ 1, 16, 8, 8 }));
+        AddConvolution(holder, "conv", "data", 16, 16, 1, 1, unused);
+        if (!SaveModel(holder, weight, "_test_cache.xml", "_test_cache.bin"))
+            return false;
+        Network network;
+        network.SetCache(cache);
+        if (!network.Load("_test_cache.xml", "_test_cache.bin"))
+            return false;
+        SetInput(network, 1);
+        network.Forward();
+        return Compare(*network.Dst()[0], control, 1.0e-6f, name);
+    }
+
+    static bool TestCacheReplace()
+    {
+        const Synet::PreparedCache::Key key = Synet::PreparedCache::MakeKey(1, 2);
+        Synet::PreparedCache::Records first(1, Synet::PreparedCache::Record(3, String(1000, 'a')));
+        Synet::PreparedCache::Records second(1, Synet::PreparedCache::Record(3, String(2000, 'b')));
+        Synet::PreparedCache mapped, fresh;
+        size_t size = 0;
+        const uint8_t * data = NULL;
+        bool result = Synet::PreparedCache::Save("_test_cache.cache", key, first) && mapped.Load("_test_cache.cache", key) &&
+            Synet::PreparedCache::Save("_test_cache.cache", key, second) && (data = mapped.Find(3, size)) != NULL &&
+            String((const char*)data, size) == first[0].second && fresh.Load("_test_cache.cache", key) &&
+            (data = fresh.Find(3, size)) != NULL && String((const char*)data, size) == second[0].second;
+        if (!result)
+            std::cout << "Prepared cache: saving over a mapped cache failed!" << std::endl;
+        mapped.Close();
+        fresh.Close();
+        return result;
+    }
+
+    static bool LoadSparse(const String & state, const size_t * patch, uint32_t value)
+    {
+        String data = state;
+        if (patch)
+            memcpy(&data[patch[0]], &value, sizeof(value));
+        Synet::SparseMatrix<float> sparse;
+        const uint8_t * ptr = (const uint8_t*)data.data();
+        size_t size = data.size();
+        return sparse.Load(ptr, size) && size == 0;
+    }
+
+    static bool TestCacheState()
+    {
+        const size_t rows = 4, cols = 8;
+        Synet::Tensor<float> weight(Synet::Shape({ rows, cols, 1, 1 }));
+        for (size_t i = 0; i < rows; ++i)
+            weight.CpuData()[i * cols + (i * 3) % cols] = float(i + 1);
+        Synet::SparseMatrix<float> sparse;
+        sparse.Init(weight.CpuData(), rows, cols);
+        std::stringstream ss;
+        sparse.Save(ss);
+        String state = ss.str();
+        const size_t offsets = 16, indices = offsets + (rows + 1) * 4;
+        const size_t first[1] = { offsets }, middle[1] = { offsets + 8 }, index[1] = { indices + 4 }, wide[1] = { 8 };
+        bool result = sparse.Enable() && LoadSparse(state, NULL, 0) && !LoadSparse(state, first, 1) &&
+            !LoadSparse(state, middle, 5) && !LoadSparse(state, index, cols) && !LoadSparse(state, wide, 0);
+
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypeConvolution;
+        param.convolution().outputNum() = rows;
+        param.convolution().kernel() = Synet::Shape(1, 1);
+        param.convolution().biasTerm() = false;
+        param.weight().resize(1);
+        param.weight()[0].dim() = Synet::Shape({ rows + 1, cols, 1, 1 });
+        Synet::ConvolutionLayer<float> layer(param);
+        Synet::Tensor<float> other(param.weight()[0].dim());
+        const void * ptr = other.CpuData();
+        size_t size = other.Size() * sizeof(float);
+        result = result && layer.Load(ptr, size) && !layer.LoadState((const uint8_t*)state.data(), state.size());
+        if (!result)
+            std::cout << "Prepared cache: a corrupt sparse state is accepted!" << std::endl;
+        return result;
+    }
+
+    static bool TestCache()
+    {
+        bool result = TestCacheReplace() && TestCacheState();
+        for (size_t w = 0; w < 2 && result; ++w)
+        {
+            std::srand(unsigned(w));
+            Synet::NetworkParamHolder holder;
+            Tensors weight;
+            AddInput(holder, "data", Synet::Shape({ 1, 16, 8, 8 }));
+            AddConvolution(holder, "conv", "data", 16, 16, 1, 1, weight);
+            for (size_t i = 0; i < weight[0].Size(); ++i)
+                if (std::rand() % 10)
+                    weight[0].CpuData()[i] = 0;
+            Network reference;
+            result = SaveModel(holder, weight, "_test_cache.xml", "_test_cache.bin") && reference.Load("_test_cache.xml", "_test_cache.bin");
+            if (result)
+            {
+                SetInput(reference, 1);
+                reference.Forward();
+                result = TestCacheForward("_test_cache.cache", weight, *reference.Dst()[0], "Cold cache") &&
+                    TestCacheForward("_test_cache.cache", weight, *reference.Dst()[0], "Warm cache");
+            }
+        }
+        std::remove("_test_cache.xml");
+        std::remove("_test_cache.bin");
+        std::remove("_test_cache.cache");
+        std::cout << "Prepared cache test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static bool TestOptimizerLoad(const String & param, const String & weight, int level, size_t layers, const Synet::Tensor<float> & control, const String & name)
+    {
+        Network network;
+        if (!network.Load(param, weight, false, level))
+        {
+            std::cout << name << ": can't load model!" << std::endl;
+            return false;
+        }
+        if (network.Param().layers().size() != layers)
+        {
+            std::cout << name << ": " << network.Param().layers().size() << " layers instead of " << layers << std::endl;
+            return false;
+        }
+        SetInput(network, 1);
+        network.Forward();
+        return Compare(*network.Dst()[0], control, 0.0f, name);
+    }
+
+    static bool TestOptimizer()
+    {
+        std::srand(0);
+        Synet::NetworkParamHolder holder;
+        Tensors weight;
+        AddInput(holder, "data", Synet::Shape({ 1, 4, 8, 8 }));
+        AddConvolution(holder, "conv1", "data", 4, 8, 3, 1, weight);
+        AddLayer(holder, Synet::LayerTypeStub, "stub", Synet::Strings(1, "conv1"));
+        Synet::LayerParam & identity = AddLayer(holder, Synet::LayerTypeReshape, "identity", Synet::Strings(1, "stub"));
+        identity.reshape().shape() = Synet::Shape({ 0, 0, 0, 0 });
+        identity.reshape().numAxes() = 4;
+        AddLayer(holder, Synet::LayerTypeDropout, "dropout", Synet::Strings(1, "identity"));
+        AddConvolution(holder, "dead", "conv1", 8, 2, 1, 1, weight);
+        AddConvolution(holder, "conv2", "dropout", 8, 4, 1, 1, weight);
+        AddLayer(holder, Synet::LayerTypeReshape, "flat", Synet::Strings(1, "conv2")).reshape().shape() = Synet::Shape({ 1, 256 });
+        AddLayer(holder, Synet::LayerTypeReshape, "output", Synet::Strings(1, "flat")).reshape().shape() = Synet::Shape({ 1, 16, 16 });
+        holder().dst() = Synet::Strings(1, "output");
+        if (!SaveModel(holder, weight, "_test_optimizer.xml", "_test_optimizer.bin") ||
+            !Synet::SaveContainer(holder, weight, "_test_optimizer.synet"))
+            return false;
+
+        Network reference;
+        bool result = reference.Load("_test_optimizer.xml", "_test_optimizer.bin");
+        if (result)
+        {
+            SetInput(reference, 1);
+            reference.Forward();
+            const Synet::Tensor<float> & control = *reference.Dst()[0];
+            result = control.Shape() == Synet::Shape({ 1, 16, 16 }) &&
+                TestOptimizerLoad("_test_optimizer.xml", "_test_optimizer.bin", 1, 4, control, "Optimizer level 1") &&
+                TestOptimizerLoad("_test_optimizer.synet", String(), 2, 4, control, "Optimizer container") &&
+                Synet::OptimizeModel("_test_optimizer.xml", "_test_optimizer.bin", "_test_optimized.xml", "_test_optimized.bin") &&
+                TestOptimizerLoad("_test_optimized.xml", "_test_optimized.bin", 0, 4, control, "OptimizeModel") &&
+                Synet::OptimizeModel("_test_optimizer.synet", String(), "_test_optimized.synet", String()) &&
+                TestOptimizerLoad("_test_optimized.synet", String(), 0, 4, control, "OptimizeModel container");
+        }
+
+        std::remove("_test_optimizer.xml");
+        std::remove("_test_optimizer.bin");
+        std::remove("_test_optimizer.synet");
+        std::remove("_test_optimized.xml");
+        std::remove("_test_optimized.bin");
+        std::remove("_test_optimized.synet");
+        std::cout << "Optimizer test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static void AddPooling(Synet::NetworkParamHolder & holder, const String & name, const String & src,
+        Synet::PoolingMethodType method, size_t kernel, size_t stride, size_t pad)
+    {
+        Synet::PoolingParam & pooling = AddLayer(holder, Synet::LayerTypePooling, name, Synet::Strings(1, src)).pooling();
+        pooling.method() = method;
+        pooling.kernel() = Synet::Shape({ kernel });
+        pooling.stride() = Synet::Shape({ stride });
+        pooling.pad() = Synet::Shape({ pad });
+    }
+
+    static bool TestShapeInference(const Synet::NetworkParamHolder & holder, const Tensors & weight, const String & name)
+    {
+        Network network;
+        bool result = SaveModel(holder, weight, "_test_inference.xml", "_test_inference.bin") &&
+            network.Load("_test_inference.xml", "_test_inference.bin") && network.Inference().Error().empty();
+        Synet::Strings names;
+        for (size_t i = 0; i < holder().layers().size(); ++i)
+            if (holder().layers()[i].type() != Synet::LayerTypeInput)
+                names.push_back(holder().layers()[i].name());
+        result = result && network.Reshape(Synet::Strings(), Synet::Shapes(), names) && network.Dst().size() == names.size();
+        for (size_t i = 0; i < names.size() && result; ++i)
+        {
+            const Synet::ShapeInference::Entry & entry = network.Inference().Get(names[i]);
+            if (!Synet::ShapeInference::Known(entry) || Synet::ShapeInference::ToShape(entry) != network.Dst()[i]->Shape())
+            {
+                std::cout << name << ": inferred shape of '" << names[i] << "' is " << ToString(Synet::ShapeInference::ToShape(entry))
+                    << " instead of " << ToString(network.Dst()[i]->Shape()) << std::endl;
+                result = false;
+            }
+        }
+        std::remove("_test_inference.xml");
+        std::remove("_test_inference.bin");
+        return result;
+    }
+
+    static bool TestShapeInference()
+    {
+        std::srand(0);
+        bool result = true;
+        {
+            Synet::NetworkParamHolder holder;
+            Tensors weight;
+            AddInput(holder, "data", Synet::Shape({ 1, 3, 17, 23 }));
+            AddConvolution(holder, "conv1", "data", 3, 8, 3, 2, weight);
+            AddLayer(holder, Synet::LayerTypeRelu, "relu1", Synet::Strings(1, "conv1"));
+            AddPooling(holder, "pool1", "relu1", Synet::PoolingMethodTypeMax, 3, 2, 0);
+            AddPooling(holder, "pool2", "pool1", Synet::PoolingMethodTypeAverage, 3, 1, 1);
+            AddConvolution(holder, "conv2", "pool2", 8, 4, 1, 1, weight);
+            AddLayer(holder, Synet::LayerTypeConcat, "concat", Synet::Strings({ "pool2", "conv2" }));
+            AddLayer(holder, Synet::LayerTypePermute, "permute", Synet::Strings(1, "concat")).permute().order() = Synet::Shape({ 0, 2, 3, 1 });
+            AddLayer(holder, Synet::LayerTypeFlatten, "flatten", Synet::Strings(1, "permute"));
+            Synet::LayerParam & fc = AddLayer(holder, Synet::LayerTypeInnerProduct, "fc", Synet::Strings(1, "flatten"));
+            fc.innerProduct().outputNum() = 10;
+            fc.weight().resize(2);
+            fc.weight()[0].dim() = Synet::Shape({ 10, 288 });
+            fc.weight()[1].dim() = Synet::Shape({ 10 });
+            weight.push_back(Synet::Tensor<float>(fc.weight()[0].dim(), 0.01f));
+            weight.push_back(Synet::Tensor<float>(fc.weight()[1].dim(), 0.0f));
+            AddLayer(holder, Synet::LayerTypeSoftmax, "prob", Synet::Strings(1, "fc"));
+            result = TestShapeInference(holder, weight, "Classifier inference") && result;
+        }
+        {
+            Synet::NetworkParamHolder holder;
+            Tensors weight;
+            AddInput(holder, "data", Synet::Shape({ 2, 4, 10, 14 }));
+            AddConvolution(holder, "down", "data", 4, 8, 3, 2, weight);
+            AddLayer(holder, Synet::LayerTypeUpsample, "up", Synet::Strings(1, "down"));
+            AddConvolution(holder, "lateral", "data", 4, 8, 1, 1, weight);
+            AddLayer(holder, Synet::LayerTypeEltwise, "sum", Synet::Strings({ "up", "lateral" }));
+            AddLayer(holder, Synet::LayerTypeReshape, "reshape", Synet::Strings(1, "sum")).reshape().shape() = Synet::Shape({ 2, 8, 140 });
+            AddLayer(holder, Synet::LayerTypeSoftmax, "softmax", Synet::Strings(1, "reshape")).softmax().axis() = 2;
+            result = TestShapeInference(holder, weight, "Feature pyramid inference") && result;
+        }
+        {
+            Synet::NetworkParamHolder holder;
+            Tensors weight;
+            AddInput(holder, "data", Synet::Shape({ 1, 3, 8, 8 }));
+            AddConvolution(holder, "conv", "data", 3, 4, 3, 1, weight);
+            AddLayer(holder, Synet::LayerTypeUnknown, "unknown", Synet::Strings(1, "data"));
+            Network network;
+            result = SaveModel(holder, weight, "_test_inference.xml", "_test_inference.bin") &&
+                network.Load("_test_inference.xml", "_test_inference.bin") && !network.Inference().Error().empty() && result;
+            std::remove("_test_inference.xml");
+            std::remove("_test_inference.bin");
+        }
+        std::cout << "Shape inference test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static void SetInput(Network & network, size_t index, float value)
+    {
+        Synet::Tensor<float> & src = *network.Src()[index];
+        for (size_t i = 0; i < src.Size(); ++i)
+            src.CpuData()[i] = value + float(i);
+    }
+
+    static bool TestPartialForward(Network & network, float a, float b, size_t modified, const String & name)
+    {
+        Network control;
+        if (!control.Load("_test_partial.xml", "_test_partial.bin"))
+            return false;
+        SetInput(control, 0, a);
+        SetInput(control, 1, b);
+        control.Forward();
+        SetInput(network, 0, a);
+        SetInput(network, 1, b);
+        network.SetModified(modified);
+        network.Forward();
+        bool result = network.Dst().size() == control.Dst().size();
+        for (size_t i = 0; i < control.Dst().size() && result; ++i)
+            result = Compare(*network.Dst()[i], *control.Dst()[i], 0.0f, name);
+        return result;
+    }
+
+    static bool TestPartialForward()
+    {
+        std::srand(0);
+        Synet::NetworkParamHolder holder;
+        Tensors weight;
+        AddInput(holder, "a", Synet::Shape({ 1, 1, 2, 2 }));
+        AddInput(holder, "b", Synet::Shape({ 1, 1, 2, 2 }));
+        AddConvolution(holder, "ca", "a", 1, 1, 1, 1, weight);
+        AddConvolution(holder, "cb", "b", 1, 1, 1, 1, weight);
+        for (size_t i = 0; i < weight.size(); ++i)
+            weight[i].CpuData()[0] = i % 2 ? 0.0f : 1.0f;
+        AddLayer(holder, Synet::LayerTypeEltwise, "sum", Synet::Strings({ "ca", "cb" })).dst() = Synet::Strings(1, "ca");
+        AddConvolution(holder, "cc", "cb", 1, 2, 1, 1, weight);
+        Network network;
+        bool result = SaveModel(holder, weight, "_test_partial.xml", "_test_partial.bin") &&
+            network.Load("_test_partial.xml", "_test_partial.bin");
+        result = result && TestPartialForward(network, 2.0f, 3.0f, 0, "Full forward");
+        result = result && TestPartialForward(network, 2.0f, 4.0f, 1, "In-place partial forward");
+        result = result && TestPartialForward(network, 5.0f, 4.0f, 0, "Partial forward");
+        result = result && TestPartialForward(network, 5.0f, 6.0f, 1, "Repeated in-place partial forward");
+        std::remove("_test_partial.xml");
+        std::remove("_test_partial.bin");
+        std::cout << "Partial forward test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static bool TestSelect()
+    {
+        std::srand(0);
+        Synet::NetworkParamHolder holder;
+        Tensors weight;
+        AddInput(holder, "data", Synet::Shape({ 1, 3, 8, 8 }));
+        AddConvolution(holder, "trunk", "data", 3, 8, 3, 1, weight);
+        AddConvolution(holder, "head1", "trunk", 8, 4, 1, 1, weight);
+        AddConvolution(holder, "head2", "trunk", 8, 2, 3, 2, weight);
+        Network network, control;
+        bool result = SaveModel(holder, weight, "_test_select.xml", "_test_select.bin") &&
+            network.Load("_test_select.xml", "_test_select.bin") && control.Load("_test_select.xml", "_test_select.bin") &&
+            network.Dst().size() == 2 && control.Dst().size() == 2;
+        if (result)
+        {
+            SetInput(network, 1);
+            network.Forward();
+            Synet::Tensor<float> * head2 = network.Dst()[network.Back()[0]->Param().name() == "head2" ? 0 : 1];
+            Synet::Tensor<float> stale;
+            stale.Clone(*head2);
+
+            result = network.Reshape(Synet::Strings(), Synet::Shapes(), Synet::Strings(1, "head1")) &&
+                network.Dst().size() == 1 && network.Back().size() == 1 && network.Back()[0]->Param().name() == "head1";
+            SetInput(network, 2);
+            network.Forward();
+            SetInput(control, 2);
+            control.Forward();
+            size_t head1 = control.Back()[0]->Param().name() == "head1" ? 0 : 1;
+            result = result && Compare(*network.Dst()[0], *control.Dst()[head1], 0.0f, "Selected output") &&
+                Compare(*head2, stale, 0.0f, "Skipped output");
+
+            result = result && network.Reshape(Synet::Strings(), Synet::Shapes(), Synet::Strings({ "head1", "head2" })) && network.Dst().size() == 2;
+            network.Forward();
+            result = result && Compare(*network.Dst()[0], *control.Dst()[head1], 0.0f, "Reselected output") &&
+                Compare(*network.Dst()[1], *control.Dst()[1 - head1], 0.0f, "Reselected output");
+        }
+        std::remove("_test_select.xml");
+        std::remove("_test_select.bin");
+        std::cout << "Select test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static Synet::LayerParam & AddMeta(Synet::NetworkParamHolder & holder, Synet::MetaType type, const String & name, const Synet::Strings & src)
+    {
+        Synet::LayerParam & layer = AddLayer(holder, Synet::LayerTypeMeta, name, src);
+        layer.meta().type() = type;
+        return layer;
+    }
+
+    static bool CheckMeta(const Synet::Tensor<float> & tensor, const Synet::Ints & expected, const String & name)
+    {
+        const Synet::Tensor<int32_t> & i32 = ((Synet::Tensor<float>&)tensor).As32i();
+        bool result = i32.Size() == expected.size();
+        for (size_t i = 0; i < expected.size() && result; ++i)
+            result = i32.CpuData()[i] == expected[i];
+        if (!result)
+            std::cout << "Meta program: wrong " << name << " output!" << std::endl;
+        return result;
+    }
+
+    static bool TestMetaProgram()
+    {
+        Synet::NetworkParamHolder holder;
+        AddMeta(holder, Synet::MetaTypeInput, "dims", Synet::Strings());
+        Synet::LayerParam & index = AddMeta(holder, Synet::MetaTypeConst, "index", Synet::Strings());
+        index.meta().alpha().type() = Synet::TensorType32i;
+        index.meta().alpha().shape() = Synet::Shape(1, 1);
+        index.meta().alpha().i32() = Synet::Ints(1, 0);
+        AddMeta(holder, Synet::MetaTypeCast, "copy", Synet::Strings(1, "dims")).meta().alpha().type() = Synet::TensorType32i;
+        AddMeta(holder, Synet::MetaTypeGather, "first", Synet::Strings({ "dims", "index" }));
+        AddMeta(holder, Synet::MetaTypePack, "pair", Synet::Strings({ "first", "first" }));
+
+        Network network;
+        bool result = SaveModel(holder, Tensors(), "_test_meta.xml", "_test_meta.bin") && network.Load("_test_meta.xml", "_test_meta.bin");
+        for (size_t size = 3; size <= 13 && result; size += 10)
+        {
+            Synet::Shape dims;
+            Synet::Ints values;
+            for (size_t i = 0; i < size; ++i)
+            {
+                dims.push_back(i + 2);
+                values.push_back(int(i + 2));
+            }
+            network.Reshape(Synet::Strings(1, "dims"), Synet::Shapes(1, dims));
+            result = network.Dst().size() == 2 && CheckMeta(*network.Dst()[0], values, "copy") &&
+                CheckMeta(*network.Dst()[1], Synet::Ints(2, 2), "pair");
+        }
+
+        Synet::NetworkParamHolder rank;
+        AddInput(rank, "data", Synet::Shape(SYNET_META_REGISTER_SIZE + 2, 1));
+        AddMeta(rank, Synet::MetaTypeShape, "shape", Synet::Strings(1, "data"));
+        Network shape;
+        result = result && SaveModel(rank, Tensors(), "_test_meta.xml", "_test_meta.bin") && shape.Load("_test_meta.xml", "_test_meta.bin") &&
+            CheckMeta(*shape.Dst()[0], Synet::Ints(SYNET_META_REGISTER_SIZE + 2, 1), "shape");
+
+        std::remove("_test_meta.xml");
+        std::remove("_test_meta.bin");
+        std::cout << "Meta program test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    static Synet::Layer<float> * CreateTiledLayer(const Synet::LayerParam & param)
+    {
+        switch (param.type())
+        {
+        case Synet::LayerTypeConvolution: return new Synet::ConvolutionLayer<float>(param);
+        case Synet::LayerTypePooling: return new Synet::PoolingLayer<float>(param);
+        case Synet::LayerTypeRelu: return new Synet::ReluLayer<float>(param);
+        default: return NULL;
+        }
+    }
+
+    static Synet::NetworkParamHolder TiledChain(Tensors & weight)
+    {
+        Synet::NetworkParamHolder holder;
+        AddInput(holder, "data", Synet::Shape({ 1, 8, 64, 48 }));
+        AddConvolution(holder, "conv1", "data", 8, 16, 3, 1, weight);
+        AddLayer(holder, Synet::LayerTypeRelu, "relu1", Synet::Strings(1, "conv1")).dst() = Synet::Strings(1, "conv1");
+        AddConvolution(holder, "conv2", "conv1", 16, 16, 3, 1, weight);
+        AddPooling(holder, "pool", "conv2", Synet::PoolingMethodTypeMax, 3, 2, 1);
+        AddConvolution(holder, "conv3", "pool", 16, 8, 3, 2, weight);
+        return holder;
+    }
+
+    static bool TestTiledLayer()
+    {
+        std::srand(0);
+        Tensors weight;
+        Synet::NetworkParamHolder holder = TiledChain(weight);
+        const std::vector<Synet::LayerParam> & params = holder().layers();
+        std::vector<std::shared_ptr<Synet::Layer<float>>> layers;
+        Synet::TiledLayer<float>::LayerPtrs chain;
+        Tensors tensors(params.size()), buf(2);
+        Synet::TiledLayer<float>::TensorPtrs bufs({ &buf[0], &buf[1] }), chained(1, &tensors[0]);
+        tensors[0].Reshape(params[0].input().shape()[0].dim());
+        std::srand(1);
+        for (size_t i = 0; i < tensors[0].Size(); ++i)
+            tensors[0].CpuData()[i] = float(std::rand() % 201 - 100) / 100.0f;
+        for (size_t l = 1, w = 0; l < params.size(); ++l)
+        {
+            layers.push_back(std::shared_ptr<Synet::Layer<float>>(CreateTiledLayer(params[l])));
+            std::vector<float> data;
+            for (size_t i = 0; i < params[l].weight().size(); ++i, ++w)
+                data.insert(data.end(), weight[w].CpuData(), weight[w].CpuData() + weight[w].Size());
+            const void * ptr = data.data();
+            size_t size = data.size() * sizeof(float);
+            if (!layers.back()->Load(ptr, size) || size != 0)
+                return false;
+            Synet::Layer<float> * layer = layers.back().get();
+            Synet::Layer<float>::TensorPtrs s(1, chained.back()), d(1, params[l].dst()[0] == params[l].src()[0] ? chained.back() : &tensors[l]);
+            layer->Setup(s, bufs, d);
+            layer->Reshape(s, bufs, d);
+            layer->Forward(s, bufs, d);
+            chain.push_back(layer);
+            chained.push_back(d[0]);
+        }
+
+        Synet::TiledLayer<float> tiled;
+        Synet::Tensor<float> dst(chained.back()->Shape());
+        Synet::TiledLayer<float>::TensorPtrs s(1, &tensors[0]), d(1, &dst);
+        bool result = tiled.Init(chain, chained, bufs, 0x8000, CreateTiledLayer) && tiled.Bands() > 1;
+        if (result)
+        {
+            tiled.Forward(s, bufs, d);
+            result = Compare(dst, *chained.back(), 1.0e-5f, "Tiled layer");
+        }
+
+        Network network, control;
+        result = result && SaveModel(holder, weight, "_test_tiled.xml", "_test_tiled.bin") &&
+            network.Load("_test_tiled.xml", "_test_tiled.bin") && control.Load("_test_tiled.xml", "_test_tiled.bin");
+        if (result)
+        {
+            network.SetTiling(0x8000);
+            SetInput(network, 1);
+            SetInput(control, 1);
+            network.Forward();
+            control.Forward();
+            result = Compare(*network.Dst()[0], *control.Dst()[0], 1.0e-5f, "Tiled network");
+        }
+        std::remove("_test_tiled.xml");
+        std::remove("_test_tiled.bin");
+        std::cout << "Tiled layer test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    static Synet::NetworkParamHolder SegmentationHead(Tensors & weight)
+    {
+        Synet::NetworkParamHolder holder;
+        AddInput(holder, "data", Synet::Shape({ 1, 4, 64, 48 }));
+        AddConvolution(holder, "conv1", "data", 4, 8, 3, 2, weight);
+        AddLayer(holder, Synet::LayerTypeRelu, "relu1", Synet::Strings(1, "conv1"));
+        AddConvolution(holder, "conv2", "relu1", 8, 8, 3, 2, weight);
+        AddLayer(holder, Synet::LayerTypeUpsample, "up2", Synet::Strings(1, "conv2"));
+        AddLayer(holder, Synet::LayerTypeUpsample, "up1", Synet::Strings(1, "up2"));
+        AddConvolution(holder, "conv3", "up1", 8, 3, 3, 1, weight);
+        AddLayer(holder, Synet::LayerTypeSigmoid, "sigmoid", Synet::Strings(1, "conv3"));
+        AddLayer(holder, Synet::LayerTypeSoftmax, "prob", Synet::Strings(1, "sigmoid"));
+        return holder;
+    }
+
+    static bool TestTiledNetwork(const Synet::NetworkParamHolder & holder, const Tensors & weight, size_t height, size_t width, const String & name)
+    {
+        Network reference, network, context;
+        bool result = SaveModel(holder, weight, "_test_stitch.xml", "_test_stitch.bin") && reference.Load("_test_stitch.xml", "_test_stitch.bin") &&
+            network.Load("_test_stitch.xml", "_test_stitch.bin") && context.Load("_test_stitch.xml", "_test_stitch.bin");
+        if (result)
+        {
+            SetInput(reference, 1);
+            reference.Forward();
+            Synet::TiledNetwork<float> tiled(network, height, width);
+            tiled.AddContext(context);
+            Synet::Tensor<float> dst;
+            result = tiled.Forward(*reference.Src()[0], dst) && tiled.Tiles() > 1 &&
+                Compare(dst, *reference.Dst()[0], 1.0e-5f, name + " stitching");
+            if (!result && tiled.Error().size())
+                std::cout << name << ": " << tiled.Error() << std::endl;
+            tiled.SetTile(64, 48);
+            result = result && tiled.Forward(*reference.Src()[0], dst) && tiled.Tiles() == 1 &&
+                Compare(dst, *reference.Dst()[0], 1.0e-5f, name + " single tile");
+        }
+        std::remove("_test_stitch.xml");
+        std::remove("_test_stitch.bin");
+        return result;
+    }
+
+    static bool TestTiledNetwork()
+    {
+        std::srand(0);
+        Tensors chain, head;
+        bool result = TestTiledNetwork(TiledChain(chain), chain, 24, 20, "Tiled network");
+        Synet::NetworkParamHolder holder = SegmentationHead(head);
+        result = result && TestTiledNetwork(holder, head, 23, 19, "Tiled upsampling head");
+
+        holder().layers()[4].type() = Synet::LayerTypeInterp;
+        holder().layers()[4].interp().zoomFactor() = 2;
+        Network network;
+        Synet::Tensor<float> src(Synet::Shape({ 1, 4, 64, 48 })), dst;
+        result = result && SaveModel(holder, head, "_test_stitch.xml", "_test_stitch.bin") && network.Load("_test_stitch.xml", "_test_stitch.bin");
+        if (result)
+        {
+            Synet::TiledNetwork<float> tiled(network, 24, 20);
+            result = !tiled.Forward(src, dst) && tiled.Error().find("Interp") != String::npos;
+        }
+        std::remove("_test_stitch.xml");
+        std::remove("_test_stitch.bin");
+        std::cout << "Tiled network test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    static bool EqualRegions(const Network::Regions & a, const Network::Regions & b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].w != b[i].w || a[i].h != b[i].h || a[i].prob != b[i].prob || a[i].id != b[i].id)
+                return false;
+        return true;
+    }
+
+    static Synet::NetworkParamHolder YoloNet(Tensors & weight)
+    {
+        Synet::NetworkParamHolder holder;
+        AddInput(holder, "data", Synet::Shape({ 1, 3, 16, 16 }));
+        holder().layers().back().input().scale() = Synet::Floats(1, 1.0f / 255.0f);
+        AddConvolution(holder, "conv", "data", 3, 7, 3, 1, weight);
+        Synet::LayerParam & yolo = AddLayer(holder, Synet::LayerTypeYolo, "yolo", Synet::Strings(1, "conv"));
+        yolo.yolo().classes() = 2;
+        yolo.yolo().mask() = Synet::Index(1, 0);
+        yolo.yolo().anchors() = Synet::Floats({ 4.0f, 4.0f });
+        return holder;
+    }
+
+    static bool TestRegions()
+    {
+        std::srand(0);
+        Tensors weight;
+        Synet::NetworkParamHolder holder = YoloNet(weight);
+        Network network;
+        bool result = SaveModel(holder, weight, "_test_regions.xml", "_test_regions.bin") &&
+            network.Load("_test_regions.xml", "_test_regions.bin");
+        if (result)
+        {
+            SetInput(network, 1);
+            network.Forward();
+            Network::RegionScratch scratch;
+            Network::Regions regions, expected;
+            network.GetRegions(24, 20, 0.3f, 0.5f, expected);
+            network.GetRegions(24, 20, 0.3f, 0.5f, scratch, regions);
+            const Network::Region * data = regions.data(), * candidats = scratch.candidats.data();
+            size_t capacity = regions.capacity(), candidatsCapacity = scratch.candidats.capacity();
+            result = expected.size() > 0 && EqualRegions(regions, expected);
+            for (size_t i = 0; i < 10 && result; ++i)
+            {
+                network.GetRegions(24, 20, 0.3f, 0.5f, scratch, regions);
+                result = EqualRegions(regions, expected) && regions.data() == data && regions.capacity() == capacity &&
+                    scratch.candidats.data() == candidats && scratch.candidats.capacity() == candidatsCapacity;
+            }
+        }
+        std::remove("_test_regions.xml");
+        std::remove("_test_regions.bin");
+        std::cout << "Regions test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    static bool TestPipeline()
+    {
+        std::srand(0);
+        Tensors weight;
+        Synet::NetworkParamHolder holder = YoloNet(weight);
+
+        const size_t width = 24, height = 20, frames = 7;
+        const float threshold = 0.3f, overlap = 0.5f;
+        std::vector<uint8_t> video(width * height * 3 * frames);
+        for (size_t i = 0; i < video.size(); ++i)
+            video[i] = uint8_t(std::rand());
+        std::ofstream ofs("_test_pipeline.raw", std::ofstream::binary);
+        ofs.write((const char*)video.data(), video.size());
+        ofs.close();
+
+        Network network, control;
+        bool result = SaveModel(holder, weight, "_test_pipeline.xml", "_test_pipeline.bin") &&
+            network.Load("_test_pipeline.xml", "_test_pipeline.bin") && control.Load("_test_pipeline.xml", "_test_pipeline.bin");
+        std::vector<Network::Regions> expected(frames);
+        size_t found = 0;
+        for (size_t f = 0; f < frames && result; ++f)
+        {
+            result = control.SetInput(video.data() + f * width * height * 3, width, height, width * 3, Synet::ImageFormatTypeBgr);
+            control.Forward();
+            control.GetRegions(width, height, threshold, overlap, expected[f]);
+            found += expected[f].size();
+        }
+        result = result && found > 0;
+        for (size_t depth = 1; depth <= 3 && result; depth += 2)
+        {
+            Synet::RawFrameSource source;
+            Synet::Pipeline<float> pipeline(network, depth);
+            std::vector<Network::Regions> actual;
+            bool ordered = true;
+            result = source.Open("_test_pipeline.raw", width, height, Synet::ImageFormatTypeBgr) &&
+                pipeline.Run(source, threshold, overlap, [&](size_t frame, const Network::Regions & regions)
+                {
+                    ordered = ordered && frame == actual.size();
+                    actual.push_back(regions);
+                });
+            result = result && ordered && actual.size() == frames && pipeline.GetStatistic().frames == frames;
+            for (size_t f = 0; f < frames && result; ++f)
+            {
+                result = EqualRegions(actual[f], expected[f]);
+                if (!result)
+                    std::cout << "Pipeline depth " << depth << ": regions of frame " << f << " differ!" << std::endl;
+            }
+        }
+        std::remove("_test_pipeline.raw");
+        std::remove("_test_pipeline.xml");
+        std::remove("_test_pipeline.bin");
+        std::cout << "Pipeline test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+
+    //---------------------------------------------------------------------
+
+    bool TestNetwork()
+    {
+        bool result = true;
+        result = TestContainer() && result;
+        result = TestCache() && result;
+        result = TestOptimizer() && result;
+        result = TestShapeInference() && result;
+        result = TestSelect() && result;
+        result = TestPartialForward() && result;
+        result = TestMetaProgram() && result;
+        result = TestTiledLayer() && result;
+        result = TestTiledNetwork() && result;
+        result = TestRegions() && result;
+        result = TestPipeline() && result;
+        return result;
+    }
+}
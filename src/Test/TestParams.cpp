@@ -46,6 +46,12 @@ namespace Test
         //std::cout << std::endl << "Saved (full):" << std::endl;
         //holder.Save(std::cout, true);
 
-        return true;
+        std::stringstream binary, src, dst;
+        Synet::NetworkParamHolder loaded;
+        if (!holder.Save(binary, false, true) || !loaded.Load(binary))
+            return false;
+        holder.Save(src, true);
+        loaded.Save(dst, true);
+        return src.str() == dst.str();
     }
 }
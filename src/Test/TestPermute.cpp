@@ -0,0 +1,87 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    static bool TestPermute(const Synet::Shape & shape, const Synet::Shape & order)
+    {
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypePermute;
+        param.permute().order() = order;
+        Synet::PermuteLayer<float> layer(param);
+
+        Synet::Tensor<float> src(shape), dst;
+        for (size_t i = 0; i < src.Size(); ++i)
+            src.CpuData()[i] = float(i);
+        Synet::Layer<float>::TensorPtrs s(1, &src), b, d(1, &dst);
+        layer.Setup(s, b, d);
+        layer.Reshape(s, b, d);
+        layer.Forward(s, b, d);
+
+        Synet::Shape srcStride(shape.size(), 1), index(shape.size(), 0);
+        for (ptrdiff_t i = shape.size() - 2; i >= 0; --i)
+            srcStride[i] = srcStride[i + 1] * shape[i + 1];
+        for (size_t i = 0; i < dst.Size(); ++i)
+        {
+            size_t offset = 0;
+            for (size_t j = 0; j < order.size(); ++j)
+                offset += index[j] * srcStride[order[j]];
+            if (dst.CpuData()[i] != src.CpuData()[offset])
+            {
+                std::cout << "Permute " << ToString(shape) << " by " << ToString(order)
+                    << " error at " << i << ": " << dst.CpuData()[i] << " instead of " << src.CpuData()[offset] << std::endl;
+                return false;
+            }
+            for (ptrdiff_t j = order.size() - 1; j >= 0 && ++index[j] == shape[order[j]]; --j)
+                index[j] = 0;
+        }
+        return true;
+    }
+
+    bool TestPermute()
+    {
+        const size_t threads = Synet::GetThreadNumber();
+        std::srand(0);
+        bool result = true;
+        for (size_t n = 0; n < 800 && result; ++n)
+        {
+            size_t count = 1 + std::rand() % 5, limit = n % 8 == 0 ? 48 : 8;
+            Synet::Shape shape, order;
+            for (size_t i = 0; i < count; ++i)
+            {
+                shape.push_back(std::rand() % 5 == 0 ? 1 : 1 + std::rand() % limit);
+                order.push_back(i);
+            }
+            for (size_t i = count - 1; i > 0; --i)
+                std::swap(order[i], order[std::rand() % (i + 1)]);
+            Synet::SetThreadNumber(n % 2 ? 3 : 1);
+            result = TestPermute(shape, order);
+        }
+        Synet::SetThreadNumber(threads);
+        std::cout << "Permute test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+}
@@ -0,0 +1,133 @@
+/*
+* Tests for Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Test/TestCommon.h"
+
+namespace Test
+{
+    static void PoolingReference(const Synet::PoolingParam & param, const Synet::Tensor<float> & src, Synet::Tensor<float> & dst)
+    {
+        const Synet::Shape & pad = param.pad();
+        bool global = param.globalPooling(), max = param.method() == Synet::PoolingMethodTypeMax;
+        ptrdiff_t srcY = src.Axis(2), srcX = src.Axis(3), dstY = dst.Axis(2), dstX = dst.Axis(3);
+        ptrdiff_t kernelY = global ? srcY : param.kernel()[0], kernelX = global ? srcX : param.kernel().back();
+        ptrdiff_t strideY = param.stride().empty() ? 1 : param.stride()[0], strideX = param.stride().empty() ? 1 : param.stride().back();
+        ptrdiff_t padY = pad.empty() ? 0 : pad[0], padX = pad.empty() ? 0 : pad[pad.size() > 1 ? 1 : 0];
+        ptrdiff_t padH = pad.size() == 4 ? pad[2] : padY, padW = pad.size() == 4 ? pad[3] : padX;
+        ptrdiff_t endY = srcY, endX = srcX;
+        if (max && param.yoloCompatible())
+        {
+            endY = dstY * strideY - padY - padH;
+            endX = dstX * strideX - padX - padW;
+        }
+        for (size_t c = 0, planes = src.Axis(0) * src.Axis(1); c < planes; ++c)
+        {
+            const float * s = src.CpuData() + c * srcY * srcX;
+            float * d = dst.CpuData() + c * dstY * dstX;
+            for (ptrdiff_t dy = 0; dy < dstY; ++dy)
+            {
+                ptrdiff_t y0 = std::max<ptrdiff_t>(dy * strideY - padY, 0), y1 = std::min(dy * strideY - padY + kernelY, endY);
+                for (ptrdiff_t dx = 0; dx < dstX; ++dx)
+                {
+                    ptrdiff_t x0 = std::max<ptrdiff_t>(dx * strideX - padX, 0), x1 = std::min(dx * strideX - padX + kernelX, endX);
+                    float value = max ? -FLT_MAX : 0.0f;
+                    for (ptrdiff_t y = y0; y < y1; ++y)
+                        for (ptrdiff_t x = x0; x < x1; ++x)
+                            value = max ? std::max(value, s[y * srcX + x]) : value + s[y * srcX + x];
+                    d[dy * dstX + dx] = max ? value : value / float((y1 - y0) * (x1 - x0));
+                }
+            }
+        }
+    }
+
+    static bool TestPooling(const Synet::PoolingParam & pooling, const Synet::Shape & shape)
+    {
+        Synet::LayerParam param;
+        param.type() = Synet::LayerTypePooling;
+        param.pooling() = pooling;
+        Synet::PoolingLayer<float> layer(param);
+
+        Synet::Tensor<float> src(shape), dst;
+        for (size_t i = 0; i < src.Size(); ++i)
+            src.CpuData()[i] = float(std::rand() % 2001 - 1000) / 100.0f;
+        Synet::Layer<float>::TensorPtrs s(1, &src), b, d(1, &dst);
+        layer.Setup(s, b, d);
+        layer.Reshape(s, b, d);
+        layer.Forward(s, b, d);
+
+        Synet::Tensor<float> control(dst.Shape());
+        PoolingReference(pooling, src, control);
+        for (size_t i = 0; i < dst.Size(); ++i)
+        {
+            float value = dst.CpuData()[i], expected = control.CpuData()[i];
+            if (::fabs(value - expected) > 1.0e-5f * std::max(::fabs(expected), 1.0f))
+            {
+                std::cout << "Pooling " << (pooling.method() == Synet::PoolingMethodTypeMax ? "max" : "average")
+                    << " {" << shape[2] << " " << shape[3] << "} error at " << i << ": " << value << " instead of " << expected << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool TestPooling()
+    {
+        const size_t threads = Synet::GetThreadNumber();
+        std::srand(0);
+        bool result = true;
+        for (size_t n = 0; n < 1200 && result; ++n)
+        {
+            Synet::PoolingParam pooling;
+            bool max = std::rand() % 2 == 0;
+            pooling.method() = max ? Synet::PoolingMethodTypeMax : Synet::PoolingMethodTypeAverage;
+            size_t kernelY = 1 + std::rand() % 4, kernelX = 1 + std::rand() % 4;
+            if (n % 10 == 0)
+                pooling.globalPooling() = true;
+            else
+            {
+                pooling.kernel() = kernelY == kernelX ? Synet::Shape({ kernelY }) : Synet::Shape({ kernelY, kernelX });
+                size_t strideY = 1 + std::rand() % 3, strideX = std::rand() % 2 ? strideY : 1 + std::rand() % 3;
+                pooling.stride() = strideY == strideX ? Synet::Shape({ strideY }) : Synet::Shape({ strideY, strideX });
+                size_t padY = std::rand() % kernelY, padX = std::rand() % kernelX;
+                switch (std::rand() % 4)
+                {
+                case 0: break;
+                case 1: pooling.pad() = Synet::Shape({ std::min(padY, padX) }); break;
+                case 2: pooling.pad() = Synet::Shape({ padY, padX }); break;
+                case 3: pooling.pad() = Synet::Shape({ padY, padX, size_t(std::rand()) % (kernelY - padY), size_t(std::rand()) % (kernelX - padX) }); break;
+                }
+                pooling.yoloCompatible() = max && std::rand() % 4 == 0;
+            }
+            bool big = n % 16 == 0;
+            size_t num = 1 + std::rand() % 2, channels = big ? 64 : 1 + std::rand() % 3;
+            size_t srcY = kernelY + std::rand() % (big ? 32 : 12), srcX = kernelX + std::rand() % (big ? 32 : 12);
+            Synet::Shape shape({ num, channels, srcY, srcX });
+            Synet::SetThreadNumber(n % 2 ? 3 : 1);
+            result = TestPooling(pooling, shape);
+        }
+        Synet::SetThreadNumber(threads);
+        std::cout << "Pooling test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
+    }
+}
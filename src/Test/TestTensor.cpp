@@ -32,6 +32,21 @@ namespace Test
 
         Tensor tensor;
 
-        return true;
+        const float data[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+        Tensor external, shared, reshaped;
+        external.Share(data, Synet::Shape({ 2, 2 }));
+        shared.Share(external);
+        const Tensor & view = shared;
+        reshaped.ShareAs(external, Synet::Shape({ 4 }));
+        bool result = external.External() && shared.External() && reshaped.External() && view.CpuData() == data;
+
+        shared.CpuData()[0] = 5.0f;
+        result = result && data[0] == 1.0f && !external.External() && !reshaped.External();
+        result = result && external.CpuData()[0] == 5.0f && reshaped.CpuData()[0] == 5.0f;
+        external.CpuData()[3] = 6.0f;
+        result = result && view.CpuData() == external.CpuData() && reshaped.CpuData()[3] == 6.0f;
+
+        std::cout << "Tensor external share test " << (result ? "passed." : "failed!") << std::endl;
+        return result;
     }
 }
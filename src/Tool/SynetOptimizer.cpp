@@ -0,0 +1,51 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2018 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "Synet/Optimizer.h"
+
+int main(int argc, char* argv[])
+{
+    Synet::Strings args;
+    int level = 2;
+    for (int i = 1; i < argc; ++i)
+    {
+        Synet::String arg = argv[i];
+        if (arg.find("-l=") == 0)
+            level = atoi(arg.substr(3).c_str());
+        else
+            args.push_back(arg);
+    }
+    bool container = args.size() == 2 && Synet::ContainerReader::IsContainer(args[0]);
+    if (!container && args.size() != 4)
+    {
+        std::cout << "Usage: " << argv[0] << " [-l=level] srcParam srcWeight dstParam dstWeight" << std::endl;
+        std::cout << "       " << argv[0] << " [-l=level] srcContainer dstContainer" << std::endl;
+        return 1;
+    }
+    bool result = container ?
+        Synet::OptimizeModel(args[0], Synet::String(), args[1], Synet::String(), level) :
+        Synet::OptimizeModel(args[0], args[1], args[2], args[3], level);
+    std::cout << "Optimization of " << args[0] << (result ? " is finished." : " is failed!") << std::endl;
+    return result ? 0 : 1;
+}